@@ -24,6 +24,10 @@
 
 namespace ch {
 
+namespace syst {
+class RuntimeSystMap;
+}
+
 // Define some useful CombineHarvester-specific typedefs
 typedef std::vector<std::pair<int, std::string>> Categories;
 
@@ -419,6 +423,16 @@ public:
   void AddSyst(CombineHarvester & target, std::string const& name,
                std::string const& type, Map const& valmap);
 
+  /**
+   * Non-templated AddSyst for maps with runtime-defined keys
+   *
+   * \details Equivalent to the templated version, but each Process is
+   * matched with a single hash lookup. This is the version used by the
+   * python interface.
+   */
+  void AddSyst(CombineHarvester & target, std::string const& name,
+               std::string const& type, ch::syst::RuntimeSystMap const& valmap);
+
   void ExtractShapes(std::string const& file, std::string const& rule,
                      std::string const& syst_rule);
   void ExtractPdfs(CombineHarvester& target, std::string const& ws_name,
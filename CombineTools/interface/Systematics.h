@@ -2,6 +2,9 @@
 #define CombineTools_Systematics_h
 #include <vector>
 #include <string>
+#include <set>
+#include <map>
+#include <unordered_map>
 #include "CombineHarvester/CombineTools/interface/Process.h"
 #include "CombineHarvester/CombineTools/interface/Logging.h"
 
@@ -265,6 +268,66 @@ namespace syst {
       }
     }
   };
+
+  /**
+   * Non-templated alternative to SystMap, SystMapAsymm and SystMapFunc
+   *
+   * \details The process properties used as keys are chosen at runtime by
+   * name ("bin", "analysis", "era", "channel", "mass", "process" and
+   * "bin_id"), and all key values are given as strings. This makes it usable
+   * from the python interface, where it is passed to the corresponding
+   * CombineHarvester::AddSyst overload so that the whole matching and
+   * insertion runs in C++. Unlike the templated maps, each entry can
+   * independently be symmetric, asymmetric or a formula, and a later entry
+   * for the same key replaces the earlier one (as in the python SystMap).
+   */
+  class RuntimeSystMap {
+   public:
+    struct Entry {
+      bool asymm = false;
+      double val_u = 0.;
+      double val_d = 0.;
+      std::string formula;
+      std::string args;
+    };
+
+    explicit RuntimeSystMap(std::vector<std::string> const& fields);
+
+    RuntimeSystMap& operator()(std::vector<std::vector<std::string>> const& input,
+                               double val);
+    RuntimeSystMap& operator()(std::vector<std::vector<std::string>> const& input,
+                               double val_d, double val_u);
+    RuntimeSystMap& operator()(std::vector<std::vector<std::string>> const& input,
+                               std::string const& formula,
+                               std::string const& args);
+
+    std::vector<std::string> const& Fields() const { return fields_; }
+
+    /**
+     * Returns the entry matching this process, or a null pointer
+     */
+    Entry const* Find(ch::Process const* p) const;
+
+    bool Contains(ch::Process const* p) const { return Find(p) != nullptr; }
+
+    std::vector<std::string> GetTuple(ch::Process const* p) const;
+
+    std::set<std::vector<std::string>> GetTupleSet() const;
+
+    std::string Key(ch::Process const* p) const;
+
+   private:
+    typedef std::string (*Getter)(ch::Process const*);
+
+    std::vector<std::string> fields_;
+    std::vector<Getter> getters_;
+    std::unordered_map<std::string, Entry> tmap_;
+
+    void Insert(std::vector<std::vector<std::string>> const& input,
+                Entry const& entry);
+    static std::string JoinKey(std::vector<std::string> const& tuple);
+    static std::vector<std::string> SplitKey(std::string const& key);
+  };
 }
 }
 
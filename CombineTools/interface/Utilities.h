@@ -219,6 +219,18 @@ std::string Tuple2String(const std::tuple<Args...> &t) {
   return str.str();
 }
 
+/**
+ * Format a tuple whose fields are only known at runtime, as a string of the
+ * same form as the std::tuple version
+ */
+inline std::string Tuple2String(const std::vector<std::string> &t) {
+  std::stringstream str;
+  str << "(";
+  for (unsigned i = 0; i < t.size(); ++i) str << (i ? ", " : "") << t[i];
+  str << ")";
+  return str.str();
+}
+
 // ---------------------------------------------------------------------------
 // Filesystem Additions
 // ---------------------------------------------------------------------------
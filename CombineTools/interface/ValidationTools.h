@@ -38,7 +38,9 @@ void CheckSmallSignals(CombineHarvester& cb, double minSigFrac, json& jsobj);
 void CheckSmallSignals(CombineHarvester& cb, double minSigFrac);
 void ValidateShapeTemplates(CombineHarvester& cb, json &jsobj);
 void ValidateShapeTemplates(CombineHarvester& cb);
-void ValidateCards(CombineHarvester& cb, std::string const& filename, double maxNormEff, double minSigFrac);
+// Runs all the checks above and writes the report to a json file; the template comparisons are
+// spread over the given number of threads (0: one per core)
+void ValidateCards(CombineHarvester& cb, std::string const& filename, double maxNormEff, double minSigFrac, unsigned threads = 0);
 
 }
 
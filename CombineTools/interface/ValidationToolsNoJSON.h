@@ -22,7 +22,7 @@ void CheckNormEff(CombineHarvester& cb, double maxNormEff);
 void CheckSizeOfShapeEffect(CombineHarvester& cb);
 void CheckSmallSignals(CombineHarvester& cb, double minSigFrac);
 void ValidateShapeTemplates(CombineHarvester& cb);
-void ValidateCards(CombineHarvester& cb, std::string const& filename, double maxNormEff, double minSigFrac);
+void ValidateCards(CombineHarvester& cb, std::string const& filename, double maxNormEff, double minSigFrac, unsigned threads = 0);
 
 }
 
@@ -3,11 +3,13 @@
 # this module below, then attach a few functions that could not easily be wrapped from the
 # C++, but instead are re-implemented in python in terms of other wrapped functions. The
 # most notable example is the AddSyst method. The C++ version relies heavily on templates
-# which is not readily adaptable to python. Instead we write the functionality entirely in a
-# python function, then "attach" this function to the CombineHarvester class.
+# which is not readily adaptable to python. Instead the python SystMap fills a non-templated
+# ch::syst::RuntimeSystMap, and the AddSyst function we "attach" to the CombineHarvester class
+# passes it to the matching C++ overload.
 from __future__ import absolute_import
 from __future__ import print_function
 import itertools
+import numbers
 from os import environ
 import sys
 
@@ -43,6 +45,7 @@ Parameter = cppyy.gbl.ch.Parameter
 ParseCombineWorkspace = cppyy.gbl.ch.ParseCombineWorkspace
 PrintSystematic = cppyy.gbl.ch.PrintSystematic
 Process = cppyy.gbl.ch.Process
+RuntimeSystMap = cppyy.gbl.ch.syst.RuntimeSystMap
 SetStandardBinNames = cppyy.gbl.ch.SetStandardBinNames
 SplitSyst = cppyy.gbl.ch.SplitSyst
 Systematic = cppyy.gbl.ch.Systematic
@@ -262,25 +265,141 @@ def syst_type_set(self):
     return list(self.__syst_type_set__())
 
 
+# Zero-copy numpy views of bin contents. Histograms and FastTemplates keep
+# their bins in one contiguous buffer, so instead of copying (ShapeAsTH1F,
+# GetBinContent loops) we wrap that buffer directly. The returned arrays are
+# read-only views, that follow later changes of the C++ object. Each array
+# keeps a reference to the object that owns the memory, but is invalidated if
+# the owner reallocates its storage (e.g. set_shape, Rebin or Resize).
+
+class _BinBuffer(object):
+    def __init__(self, owner, flat, shape):
+        self._owner = owner
+        self._flat = flat
+        interface = dict(flat.__array_interface__)
+        interface['shape'] = shape
+        self.__array_interface__ = interface
+
+
+def _wrap_buffer(owner, ptr, size, dtype, shape=None):
+    import numpy as np
+    ptr.reshape((size,))
+    flat = np.frombuffer(ptr, dtype=dtype, count=size)
+    arr = np.asarray(_BinBuffer(owner, flat, shape if shape is not None else (size,)))
+    arr.flags.writeable = False
+    return arr
+
+
+def _element_dtype(obj, ptr):
+    """
+    numpy type of the elements pointed to by ptr, as returned by data(). If the
+    view does not report it, it is the first template argument of the class,
+    e.g. float for FastHisto_t<float,double>
+    """
+    import numpy as np
+    try:
+        fmt = memoryview(ptr).format
+    except (TypeError, ValueError):
+        fmt = None
+    if fmt in ('f', 'd'):
+        return np.float32 if fmt == 'f' else np.float64
+    name = type(obj).__cpp_name__.replace(' ', '')
+    return np.float32 if '<float' in name else np.float64
+
+
+def AsArray(obj, flow=False):
+    """
+    Return a read-only numpy view of the bin contents of a TH1F/TH1D (or their 2D/3D
+    versions) or of a CombinedLimit FastTemplate/FastHisto, without copying.
+    Multi-dimensional histograms are returned with shape (nz, ny, nx). Unless
+    flow is True, the under- and overflow bins of a histogram are sliced out.
+    """
+    import numpy as np
+    # e.g. the shape_u() of a Systematic without shapes is a null pointer, not None
+    if obj is None or cppyy.addressof(obj) == 0:
+        raise RuntimeError('Cannot make an array view of a null object')
+    if hasattr(obj, 'fullsize'):
+        # FastTemplate, FastHisto and the templated FastTemplate_t<T> family
+        ptr = obj.data()
+        ptr.reshape((obj.fullsize(),))
+        return _wrap_buffer(obj, ptr, obj.fullsize(), _element_dtype(obj, ptr))
+    if isinstance(obj, cppyy.gbl.TArrayF):
+        dtype = np.float32
+    elif isinstance(obj, cppyy.gbl.TArrayD):
+        dtype = np.float64
+    else:
+        raise RuntimeError('Only TH1F/TH1D based histograms can be viewed without a copy')
+    dims = [obj.GetNbinsZ() + 2, obj.GetNbinsY() + 2, obj.GetNbinsX() + 2][3 - obj.GetDimension():]
+    arr = _wrap_buffer(obj, obj.GetArray(), obj.GetNcells(), dtype, tuple(dims))
+    if not flow:
+        arr = arr[(slice(1, -1),) * len(dims)]
+    return arr
+
+
+def _ProcessShapeArray(self, flow=False):
+    return AsArray(self.shape(), flow)
+
+
+def _SystematicShapeUArray(self, flow=False):
+    return AsArray(self.shape_u(), flow)
+
+
+def _SystematicShapeDArray(self, flow=False):
+    return AsArray(self.shape_d(), flow)
+
+
+Process.ShapeArray = _ProcessShapeArray
+Systematic.ShapeUArray = _SystematicShapeUArray
+Systematic.ShapeDArray = _SystematicShapeDArray
+
+
 class SystMap:
     """
     Similar to the C++ implementation. Instead of templating on
     proxy objects that call the correct Process member functions
-    just pass the function names as strings.
+    just pass the function names as strings. When the getters and
+    all the keys and values are supported, the entries are also
+    stored in a C++ ch::syst::RuntimeSystMap, so that AddSyst can
+    do all the matching in C++; otherwise AddSyst falls back to the
+    matching in python.
     """
 
+    # the Process getters known to ch::syst::RuntimeSystMap, with the type of their keys
+    runtime_getters = {'bin': str, 'analysis': str, 'era': str, 'channel': str, 'mass': str, 'process': str, 'bin_id': int}
+
     def __init__(self, *args):
         self.methodcallers = []
         self.tmap = dict()
         for k in args:
             self.methodcallers.append(getattr(Process, k))
+        self.key_types = [self.runtime_getters.get(k) for k in args]
+        self.runtime_map = RuntimeSystMap(list(args)) if None not in self.key_types else None
 
     def __call__(self, *args):
         assert len(args) == len(self.methodcallers) + 1
+        val = args[-1]
+        if self.runtime_map is not None:
+            self._AddRuntime(args[:-1], val)
         for element in itertools.product(*(args[:-1])):
-            self.tmap[element] = args[-1]
+            self.tmap[element] = val
         return self
 
+    def _AddRuntime(self, keys, val):
+        # the keys are passed as strings, which is exact only for strings and integers
+        for key_type, arg in zip(self.key_types, keys):
+            if not all(isinstance(x, key_type) and not isinstance(x, bool) for x in arg):
+                self.runtime_map = None
+                return
+        keys = [[str(x) for x in arg] for arg in keys]
+        if _IsReal(val):
+            self.runtime_map(keys, float(val))
+        elif len(val) == 2 and _IsReal(val[0]) and _IsReal(val[1]):
+            self.runtime_map(keys, float(val[0]), float(val[1]))
+        elif len(val) == 2 and isinstance(val[0], str) and isinstance(val[1], str):
+            self.runtime_map(keys, val[0], val[1])
+        else:
+            raise RuntimeError('Systematic value not recognised')
+
     def GetTuple(self, process):
         return tuple(x(process) for x in self.methodcallers)
 
@@ -294,8 +413,17 @@ class SystMap:
         return set(self.tmap.keys())
 
 
+def _IsReal(val):
+    return isinstance(val, numbers.Real) and not isinstance(val, bool)
+
+
 @patch(CombineHarvester)
 def AddSyst(self, target, name, type, valmap):
+    if isinstance(valmap, SystMap) and valmap.runtime_map is not None:
+        valmap = valmap.runtime_map
+    if isinstance(valmap, RuntimeSystMap):
+        # a single call, the matching to each Process is done in C++
+        return self.__AddSyst__(target, name, type, valmap)
     procs = []
     not_added_procs = []
     added_procs = []
@@ -315,12 +443,12 @@ def AddSyst(self, target, name, type, valmap):
         formula = ''
         args = ''
         is_asymm = False
-        if isinstance(val, float):
-            val_u = val
-        elif len(val) == 2 and isinstance(val[0], float) and isinstance(val[1], float):
+        if _IsReal(val):
+            val_u = float(val)
+        elif len(val) == 2 and _IsReal(val[0]) and _IsReal(val[1]):
             is_asymm = True
-            val_d = val[0]
-            val_u = val[1]
+            val_d = float(val[0])
+            val_u = float(val[1])
         elif len(val) == 2 and isinstance(val[0], str) and isinstance(val[1], str):
             formula = val[0]
             args = val[1]
@@ -339,4 +467,4 @@ def AddSyst(self, target, name, type, valmap):
             print(proc)
         print('>> Process entries that did get a Systematic:')
         for proc in added_procs:
-            print(proc)
\ No newline at end of file
+            print(proc)
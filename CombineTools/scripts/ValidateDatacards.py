@@ -31,6 +31,8 @@ parser.add_argument('--jsonFile', default='validation.json',
                     help='Path to the json file to read/write results from (default:validation.json)')
 parser.add_argument('--mass', default='*',
                     help='Signal mass to use (default:*)')
+parser.add_argument('--threads', '-j', default=0, type=int,
+                    help='Number of threads used to compare the templates (default:0, one per core)')
 
 args = parser.parse_args()
 
@@ -109,7 +111,7 @@ cb.SetFlag('workspaces-use-clone', True)
 if not args.readOnly:
     cb.ParseDatacard(args.cards,"","",mass=args.mass)
 
-    ch.ValidateCards(cb,args.jsonFile,args.checkUncertOver,args.reportSigUnder)
+    ch.ValidateCards(cb,args.jsonFile,args.checkUncertOver,args.reportSigUnder,args.threads)
 
 if args.printLevel > 0:
     print("================================")
@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+# Checks that ch.AsArray reads the combine FastTemplate family with the type of their storage,
+# including FastHisto_t<float,double> (FastHisto_f), whose bins are float and axis double, that
+# the views are read-only, and that a null object (the shape_u() of an lnN systematic) is an error.
+import ROOT
+import numpy as np
+
+import CombineHarvester.CombineTools.ch as ch
+
+ROOT.gSystem.Load("libHiggsAnalysisCombinedLimit")
+
+contents = np.array([1.5, 2.25, 0.0, 7.125, 3.0])
+h = ROOT.TH1D("h", "h", len(contents), 0.0, 5.0)
+for i, val in enumerate(contents):
+    h.SetBinContent(i + 1, val)
+
+for cls, dtype in [(ROOT.FastHisto_f, np.float32), (ROOT.FastHisto_d, np.float64), (ROOT.FastHisto, np.float64)]:
+    fh = cls(h)
+    arr = ch.AsArray(fh)
+    assert arr.dtype == dtype, "%s: dtype %s, expected %s" % (type(fh).__cpp_name__, arr.dtype, np.dtype(dtype))
+    assert arr.shape == (fh.fullsize(),), "%s: shape %s" % (type(fh).__cpp_name__, arr.shape)
+    assert np.array_equal(arr[: len(contents)], contents.astype(dtype)), "%s: %s" % (type(fh).__cpp_name__, arr)
+    # the view is read-only, and shared with the C++ object
+    assert not arr.flags.writeable
+    try:
+        arr[1] = 4.5
+        assert False, "%s: the view is writeable" % type(fh).__cpp_name__
+    except ValueError:
+        pass
+    fh.Scale(2.0)
+    assert arr[1] == 2 * contents[1]
+
+# the histogram of a FastHistoFunc_f is a FastHisto_t<float,double> as well
+x = ROOT.RooRealVar("x", "x", 0.0, 5.0)
+obs = ROOT.RooArgList(x)
+tpl = ROOT.FastHisto_f(h)
+func = ROOT.FastHistoFunc_f("func", "func", obs, tpl)
+hist = func.getHistogram()
+arr = ch.AsArray(hist)
+assert arr.dtype == np.float32
+assert np.array_equal(arr[: len(contents)], contents.astype(np.float32))
+
+# a systematic without shapes has null shape_u()/shape_d(), which cppyy returns as a null TH1
+syst = ch.Systematic()
+for getter in (syst.ShapeUArray, syst.ShapeDArray):
+    try:
+        getter()
+        assert False, "no error for a null shape"
+    except RuntimeError:
+        pass
+
+print("AsArray: all checks passed")
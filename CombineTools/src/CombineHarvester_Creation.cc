@@ -15,6 +15,7 @@
 #include "CombineHarvester/CombineTools/interface/Utilities.h"
 #include "CombineHarvester/CombineTools/interface/Logging.h"
 #include "CombineHarvester/CombineTools/interface/BinByBin.h"
+#include "CombineHarvester/CombineTools/interface/Systematics.h"
 
 namespace ch {
 void CombineHarvester::AddObservations(
@@ -75,6 +76,49 @@ void CombineHarvester::AddProcesses(
   }
 }
 
+void CombineHarvester::AddSyst(CombineHarvester& target,
+                               std::string const& name, std::string const& type,
+                               ch::syst::RuntimeSystMap const& valmap) {
+  std::vector<ch::Process *> not_added_procs;
+  std::vector<ch::Process *> added_procs;
+  // Same book-keeping as the templated version, but we only need the set of
+  // unused tuples if it's going to be printed
+  std::set<std::vector<std::string>> tuples;
+  if (verbosity_ >= 1) {
+    tuples = valmap.GetTupleSet();
+    log() << (name + ":" + type) << "\n";
+  }
+  for (unsigned i = 0; i < procs_.size(); ++i) {
+    ch::syst::RuntimeSystMap::Entry const* entry = valmap.Find(procs_[i].get());
+    if (!entry) {
+      not_added_procs.push_back(procs_[i].get());
+      continue;
+    }
+    if (verbosity_ >= 1) tuples.erase(valmap.GetTuple(procs_[i].get()));
+    added_procs.push_back(procs_[i].get());
+    target.AddSystFromProc(*(procs_[i]), name, type, entry->asymm,
+                           entry->val_u, entry->val_d, entry->formula,
+                           entry->args);
+  }
+  if (tuples.size() && verbosity_ >= 1) {
+    log() << ">> Map keys that were not used to create a Systematic:\n";
+    for (auto const& tuple : tuples) {
+      log() << ch::Tuple2String(tuple) << "\n";
+    }
+  }
+  if (verbosity_ >= 2) {
+    Process::PrintHeader(log());
+    log() << ">> Process entries that did not get a Systematic:\n";
+    for (auto p : not_added_procs) {
+      log() << *p << "\n";
+    }
+    log() << ">> Process entries that did get a Systematic:\n";
+    for (auto p : added_procs) {
+      log() << *p << "\n";
+    }
+  }
+}
+
 void CombineHarvester::AddSystFromProc(Process const& proc,
                                        std::string const& name,
                                        std::string const& type, bool asymm,
@@ -0,0 +1,154 @@
+#include "CombineHarvester/CombineTools/interface/Systematics.h"
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "CombineHarvester/CombineTools/interface/Logging.h"
+
+namespace ch {
+namespace syst {
+
+namespace {
+  // Separator for the fields in a hash key, should never appear in a property
+  char const kKeySep = '\x1f';
+
+  std::string GetBin(ch::Process const* p) { return p->bin(); }
+  std::string GetAnalysis(ch::Process const* p) { return p->analysis(); }
+  std::string GetEra(ch::Process const* p) { return p->era(); }
+  std::string GetChannel(ch::Process const* p) { return p->channel(); }
+  std::string GetMass(ch::Process const* p) { return p->mass(); }
+  std::string GetProcess(ch::Process const* p) { return p->process(); }
+  std::string GetBinId(ch::Process const* p) { return std::to_string(p->bin_id()); }
+}
+
+RuntimeSystMap::RuntimeSystMap(std::vector<std::string> const& fields)
+    : fields_(fields) {
+  for (auto const& f : fields_) {
+    if (f == "bin") {
+      getters_.push_back(&GetBin);
+    } else if (f == "analysis") {
+      getters_.push_back(&GetAnalysis);
+    } else if (f == "era") {
+      getters_.push_back(&GetEra);
+    } else if (f == "channel") {
+      getters_.push_back(&GetChannel);
+    } else if (f == "mass") {
+      getters_.push_back(&GetMass);
+    } else if (f == "process") {
+      getters_.push_back(&GetProcess);
+    } else if (f == "bin_id") {
+      getters_.push_back(&GetBinId);
+    } else {
+      throw std::runtime_error(FNERROR("Unknown process property: " + f));
+    }
+  }
+}
+
+RuntimeSystMap& RuntimeSystMap::operator()(
+    std::vector<std::vector<std::string>> const& input, double val) {
+  Entry entry;
+  entry.val_u = val;
+  Insert(input, entry);
+  return *this;
+}
+
+RuntimeSystMap& RuntimeSystMap::operator()(
+    std::vector<std::vector<std::string>> const& input, double val_d,
+    double val_u) {
+  Entry entry;
+  entry.asymm = true;
+  entry.val_d = val_d;
+  entry.val_u = val_u;
+  Insert(input, entry);
+  return *this;
+}
+
+RuntimeSystMap& RuntimeSystMap::operator()(
+    std::vector<std::vector<std::string>> const& input,
+    std::string const& formula, std::string const& args) {
+  Entry entry;
+  entry.formula = formula;
+  entry.args = args;
+  Insert(input, entry);
+  return *this;
+}
+
+void RuntimeSystMap::Insert(std::vector<std::vector<std::string>> const& input,
+                            Entry const& entry) {
+  if (input.size() != fields_.size()) {
+    throw std::runtime_error(FNERROR(
+        "Expected " + std::to_string(fields_.size()) + " lists of keys, got " +
+        std::to_string(input.size())));
+  }
+  // Build the cross product of the input lists, as syst::detail::cross does
+  std::vector<std::string> tuple(input.size());
+  std::function<void(unsigned)> cross = [&](unsigned i) {
+    if (i == input.size()) {
+      // Later entries replace earlier ones, as in the python SystMap
+      tmap_[JoinKey(tuple)] = entry;
+      return;
+    }
+    for (auto const& val : input[i]) {
+      tuple[i] = val;
+      cross(i + 1);
+    }
+  };
+  cross(0);
+}
+
+std::string RuntimeSystMap::Key(ch::Process const* p) const {
+  std::string key;
+  for (unsigned i = 0; i < getters_.size(); ++i) {
+    if (i > 0) key += kKeySep;
+    key += getters_[i](p);
+  }
+  return key;
+}
+
+RuntimeSystMap::Entry const* RuntimeSystMap::Find(ch::Process const* p) const {
+  if (!p) return nullptr;
+  auto it = tmap_.find(Key(p));
+  return it != tmap_.end() ? &(it->second) : nullptr;
+}
+
+std::vector<std::string> RuntimeSystMap::GetTuple(ch::Process const* p) const {
+  if (!p) throw std::runtime_error(FNERROR("Supplied pointer is null"));
+  std::vector<std::string> res;
+  for (auto const& getter : getters_) res.push_back(getter(p));
+  return res;
+}
+
+std::set<std::vector<std::string>> RuntimeSystMap::GetTupleSet() const {
+  std::set<std::vector<std::string>> res;
+  // With a single field the key is the value itself, which may be empty
+  for (auto const& x : tmap_) {
+    res.insert(getters_.size() == 1 ? std::vector<std::string>{x.first}
+                                    : SplitKey(x.first));
+  }
+  return res;
+}
+
+std::string RuntimeSystMap::JoinKey(std::vector<std::string> const& tuple) {
+  std::string key;
+  for (unsigned i = 0; i < tuple.size(); ++i) {
+    if (i > 0) key += kKeySep;
+    key += tuple[i];
+  }
+  return key;
+}
+
+std::vector<std::string> RuntimeSystMap::SplitKey(std::string const& key) {
+  // A map with no key fields has the empty key, and an empty tuple
+  if (key.empty()) return {};
+  std::vector<std::string> res(1);
+  for (char c : key) {
+    if (c == kKeySep) {
+      res.emplace_back();
+    } else {
+      res.back() += c;
+    }
+  }
+  return res;
+}
+}
+}
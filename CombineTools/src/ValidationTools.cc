@@ -5,6 +5,9 @@
 #include <string>
 #include <fstream>
 #include <map>
+#include <atomic>
+#include <thread>
+#include <tuple>
 #include "boost/format.hpp"
 #include "RooFitResult.h"
 #include "RooRealVar.h"
@@ -293,25 +296,145 @@ void CheckSmallSignals(CombineHarvester& cb, double minSigFrac, json& jsobj){
 }
   
 
-void ValidateCards(CombineHarvester& cb, std::string const& filename, double maxNormEff, double minSigFrac){
- json output_js; 
+namespace {
+// the fields compared by MatchingProcess
+typedef std::tuple<std::string, std::string, bool, std::string, std::string, std::string, int, std::string> ProcKey;
+
+template<class T>
+ProcKey MakeProcKey(T const& obj) {
+  return ProcKey(obj.bin(), obj.process(), obj.signal(), obj.analysis(), obj.era(), obj.channel(), obj.bin_id(), obj.mass());
+}
+
+// summed relative difference per bin between two templates, as in CheckSizeOfShapeEffect
+double SummedRelDiff(TH1 const& hist, TH1 const& ref) {
+  double diff = 0;
+  for(int i=1;i<=hist.GetNbinsX();i++){
+    if(fabs(hist.GetBinContent(i))+fabs(ref.GetBinContent(i))>0){
+      diff+=2*double(fabs(hist.GetBinContent(i)-ref.GetBinContent(i)))/(fabs(hist.GetBinContent(i))+fabs(ref.GetBinContent(i)));
+    }
+  }
+  return diff;
+}
+
+// same test as ValidateShapeTemplates
+bool SameTemplates(TH1 const& hist_u, TH1 const& hist_d) {
+  for(int i=1;i<=hist_u.GetNbinsX();i++){
+    if(fabs(hist_u.GetBinContent(i))+fabs(hist_d.GetBinContent(i))>0){
+      if(2*double(fabs(hist_u.GetBinContent(i)-hist_d.GetBinContent(i)))/(fabs(hist_u.GetBinContent(i))+fabs(hist_d.GetBinContent(i)))>0.001) return false;
+    }
+  }
+  return true;
+}
+
+struct ShapeCheck {
+  ch::Systematic *sys;
+  TH1F const* nominal;
+  bool templ_same = false;
+  double diff_u = 0, diff_d = 0;
+};
+}
+
+void ValidateCards(CombineHarvester& cb, std::string const& filename, double maxNormEff, double minSigFrac, unsigned threads){
+ // Makes the same report as calling each check in turn, visiting the processes and systematics once
+ json output_js;
  bool is_shape_card=1;
+ std::set<ProcKey> empty_procs;
  cb.ForEachProc([&](ch::Process *proc){
    if(proc->pdf()||!(proc->shape())){
      is_shape_card=0;
-    }
+   }
+   if(proc->rate()==0.){
+     empty_procs.insert(MakeProcKey(*proc));
+     if (output_js["emptyProcessShape"][proc->bin()] !=NULL){
+       output_js["emptyProcessShape"][proc->bin()].push_back(proc->process());
+     } else {
+       output_js["emptyProcessShape"][proc->bin()] = {proc->process()};
+     }
+   }
  });
- if(is_shape_card){     
-   ValidateShapeUncertaintyDirection(cb, output_js);      
-   CheckSizeOfShapeEffect(cb, output_js);
-   ValidateShapeTemplates(cb,output_js);
-   CheckEmptyBins(cb,output_js);
- } else {
+ if(!is_shape_card){
    std::cout<<"Not a shape-based datacard / shape-based datacard using RooDataHist. Skipping checks on systematic shapes."<<std::endl;
  }
- CheckEmptyShapes(cb, output_js);      
- CheckNormEff(cb, maxNormEff, output_js);
- CheckSmallSignals(cb,minSigFrac, output_js);
+
+ // the nominal templates are only made once per bin and process, and the
+ // per-bin totals for the empty bin and small signal checks at the same time
+ std::map<std::pair<std::string, std::string>, TH1F> nominals;
+ for(auto b : cb.bin_set()){
+   auto cb_bin = cb.cp().bin({b});
+   if(is_shape_card){
+     TH1F tothist = cb_bin.cp().backgrounds().GetShape();
+     for(int i=1;i<=tothist.GetNbinsX();i++){
+       if(tothist.GetBinContent(i)<=0){
+         if (output_js["emptyBkgBin"][b] !=NULL){
+           output_js["emptyBkgBin"][b].push_back(i);
+         } else {
+           output_js["emptyBkgBin"][b] = {i};
+         }
+       }
+     }
+     for(auto p : cb_bin.process_set()){
+       TH1F hist_nom = cb_bin.cp().process({p}).GetShape();
+       hist_nom.Scale(1./hist_nom.Integral());
+       nominals[std::make_pair(b, p)] = hist_nom;
+     }
+   }
+   auto cb_bin_signals = cb_bin.cp().signals();
+   double sigrate = cb_bin_signals.GetRate();
+   for(auto p : cb_bin_signals.process_set()){
+     double procrate = cb_bin_signals.cp().process({p}).GetRate();
+     if(procrate < minSigFrac*sigrate){
+       output_js["smallSignalProc"][b][p]={{"sigrate_tot",sigrate},{"procrate",procrate}};
+     }
+   }
+ }
+
+ std::vector<ShapeCheck> shape_checks;
+ cb.ForEachSyst([&](ch::Systematic *sys){
+   bool no_check = empty_procs.count(MakeProcKey(*sys));
+   if(is_shape_card && sys->type()=="shape"){
+     if((sys->value_u() > 1. && sys->value_d() > 1.) || (sys->value_u() < 1. && sys->value_d() < 1.)){
+       output_js["uncertVarySameDirect"][sys->name()][sys->bin()][sys->process()]={{"value_u",sys->value_u()},{"value_d",sys->value_d()}};
+     }
+     ShapeCheck check;
+     check.sys = sys;
+     check.nominal = &nominals[std::make_pair(sys->bin(), sys->process())];
+     shape_checks.push_back(check);
+   }
+   if(!no_check && sys->type()=="shape" && (sys->value_u()==0. || sys->value_d()==0.)){
+     output_js["emptySystematicShape"][sys->name()][sys->bin()][sys->process()]={{"value_u",sys->value_u()},{"value_d",sys->value_d()}};
+   }
+   if(!no_check && ((sys->type()=="shape" &&  (std::abs(sys->value_u()-1) > maxNormEff || std::abs(sys->value_d()-1)>maxNormEff)) || (sys->type()=="lnN" && (std::abs(sys->value_u()-1) > maxNormEff) ))){
+     output_js["largeNormEff"][sys->name()][sys->bin()][sys->process()]={{"value_u",sys->value_u()},{"value_d",sys->value_d()}};
+   }
+ });
+
+ // the comparisons of the templates only read the histograms, so they are spread over threads
+ if(threads==0) threads = std::max(1u, std::thread::hardware_concurrency());
+ threads = std::min<size_t>(threads, std::max<size_t>(1, shape_checks.size()));
+ std::atomic<size_t> next(0);
+ auto worker = [&](){
+   for(size_t i = next++; i < shape_checks.size(); i = next++){
+     ShapeCheck &check = shape_checks[i];
+     const TH1* hist_u = check.sys->shape_u();
+     const TH1* hist_d = check.sys->shape_d();
+     if(fabs(check.sys->value_u() - check.sys->value_d()) < 0.0000001) check.templ_same = SameTemplates(*hist_u, *hist_d);
+     check.diff_u = SummedRelDiff(*hist_u, *check.nominal);
+     check.diff_d = SummedRelDiff(*hist_d, *check.nominal);
+   }
+ };
+ std::vector<std::thread> pool;
+ for(unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+ worker();
+ for(auto &t : pool) t.join();
+
+ double diff_lim=0.001;
+ for(auto const& check : shape_checks){
+   ch::Systematic *sys = check.sys;
+   if(check.diff_u<diff_lim && check.diff_d<diff_lim) output_js["smallShapeEff"][sys->name()][sys->bin()][sys->process()]={{"diff_u",check.diff_u},{"diff_d",check.diff_d}};
+   if(check.templ_same){
+     output_js["uncertTemplSame"][sys->name()][sys->bin()][sys->process()]={{"value_u",sys->value_u()},{"value_d",sys->value_d()}};
+   }
+ }
  std::ofstream outfile(filename);
  outfile <<std::setw(4)<<output_js<<std::endl;
 }
@@ -2,15 +2,406 @@
 #include "TFile.h"
 #include "TROOT.h"
 #include "TEnv.h"
+#include "TH1D.h"
+#include "TRandom3.h"
+#include "TStopwatch.h"
 #include "RooAbsPdf.h"
+#include "RooAddPdf.h"
+#include "RooCategory.h"
+#include "RooConstVar.h"
+#include "RooDataSet.h"
+#include "RooProdPdf.h"
+#include "RooRealSumPdf.h"
+#include "RooRealVar.h"
 #include "RooMsgService.h"
 #include <dlfcn.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
 #include <RooStats/ModelConfig.h>
 #include "../interface/CachingNLL.h"
+#include "../interface/CascadeMinimizer.h"
+#include "../interface/CloseCoutSentry.h"
+#include "../interface/CMSHistFunc.h"
+#include "../interface/CMSHistSum.h"
+#include "../interface/Combine.h"
+#include "../interface/ProcessNormalization.h"
 #include "../interface/ProfilingTools.h"
+#include "../interface/RooSimultaneousOpt.h"
+#include "../interface/SimpleGaussianConstraint.h"
+#include "../interface/SimplePoissonConstraint.h"
+#include "../interface/ToyMCSamplerOpt.h"
+#include "../interface/VerticalInterpHistPdf.h"
+
+namespace po = boost::program_options;
 
 void (*dump_)(const char *);
 
+// Memory profile of loading a workspace and building its NLL, with igprof
+int profileWorkspace(const char *file, const char *workspace) {
+	if (void *sym = dlsym(0, "igprof_dump_now")) {
+	  dump_ = __extension__ (void(*)(const char *)) sym;
+	} else {
+	  dump_=0;
+	  std::cout << "Heap profile requested but application is not"
+	            << " currently being profiled with igprof" << std::endl;
+	}
+
+	gROOT->GetName();
+
+	TFile f(file);
+	if(dump_) {
+		dump_("profdump_file.out.gz");
+	}
+
+	RooWorkspace *w = (RooWorkspace*)gDirectory->Get(workspace);
+	auto allfuncs = w->allFunctions();
+	for (auto *a: allfuncs){
+		auto rrv = dynamic_cast<RooAbsReal*>(a);
+		if (rrv) {
+			rrv->getVal();
+		}
+	}
+	if(dump_) {
+		dump_("profdump_wsp.out.gz");
+	}
+
+        RooStats::ModelConfig* mc_s = dynamic_cast<RooStats::ModelConfig *>(w->genobj("ModelConfig"));
+        RooAbsPdf &pdf = *mc_s->GetPdf();
+        RooAbsData *dobs = w->data("data_obs");
+        const RooCmdArg &constrainCmdArg = RooFit::Constrain(*mc_s->GetNuisanceParameters());
+        std::unique_ptr<RooAbsReal> nll;
+        nll.reset(pdf.createNLL(*dobs, constrainCmdArg, RooFit::Offset(true))); // make a new nll
+        nll->getVal();
+	if(dump_) {
+		dump_("profdump_nll.out.gz");
+	}
+
+	return 0;
+}
+
+struct SyntheticConfig {
+	int channels, bins, processes, lnN, shapes;
+	bool autoMCStats;
+	std::string backend;
+	int seed;
+};
+
+// A binned model built in memory the same way text2workspace.py builds it: in each channel, one template
+// per process morphed by the shape nuisances, normalized by a ProcessNormalization with the lnN nuisances,
+// the first process being the signal scaled by r. The templates are summed by a CMSHistSum (with optional
+// autoMCStats bin-by-bin parameters) or by a RooAddPdf of FastVerticalInterpHistPdf2, and multiplied by
+// the constraint terms of the nuisances.
+class SyntheticModel {
+	public:
+		SyntheticModel(const SyntheticConfig &cfg) ;
+		~SyntheticModel() ;
+		RooSimultaneousOpt &pdf() { return *pdf_; }
+		RooRealVar &poi() { return *r_; }
+		const RooArgSet &observables() const { return observables_; }
+		const RooArgSet &nuisances() const { return nuisances_; }
+		RooDataSet &data() { return *data_; }
+	private:
+		template<typename T> T *own(T *arg) { owned_.emplace_back(arg); return arg; }
+		std::unique_ptr<TH1D> makeTemplate(TRandom3 &rnd, const char *name) const ;
+		std::unique_ptr<TH1D> varyTemplate(const TH1D &nominal, const char *name, double slope) const ;
+		void addConstraint(RooRealVar &nuis, RooArgList &constraints, double nominal = 0, bool poisson = false) ;
+
+		SyntheticConfig cfg_;
+		// deleted in reverse order of creation, i.e. clients before their servers,
+		// then the bin-by-bin parameters that are created by the CMSHistSum using them
+		std::vector<std::unique_ptr<RooAbsArg>> owned_, binPars_;
+		RooRealVar *x_, *r_, *weight_;
+		RooCategory *cat_;
+		RooConstVar *one_;
+		RooSimultaneousOpt *pdf_;
+		RooArgSet observables_, nuisances_;
+		std::unique_ptr<RooDataSet> data_;
+};
+
+std::unique_ptr<TH1D> SyntheticModel::makeTemplate(TRandom3 &rnd, const char *name) const {
+	std::unique_ptr<TH1D> h(new TH1D(name, "", cfg_.bins, 0, cfg_.bins));
+	h->SetDirectory(0);
+	for (int b = 1; b <= cfg_.bins; ++b) {
+		double mc = 20 + rnd.Exp(200) * exp(-3. * (b - 1) / cfg_.bins); // falling spectrum, from a finite MC sample
+		h->SetBinContent(b, mc);
+		h->SetBinError(b, sqrt(mc));
+	}
+	h->Scale(1.0 / h->Integral());
+	return h;
+}
+
+std::unique_ptr<TH1D> SyntheticModel::varyTemplate(const TH1D &nominal, const char *name, double slope) const {
+	std::unique_ptr<TH1D> h(static_cast<TH1D *>(nominal.Clone(name)));
+	h->SetDirectory(0);
+	for (int b = 1; b <= cfg_.bins; ++b) {
+		h->SetBinContent(b, nominal.GetBinContent(b) * (1 + slope * (b - 0.5 * cfg_.bins) / cfg_.bins));
+	}
+	h->Scale(1.0 / h->Integral());
+	return h;
+}
+
+void SyntheticModel::addConstraint(RooRealVar &nuis, RooArgList &constraints, double nominal, bool poisson) {
+	RooRealVar *glob = own(new RooRealVar(TString::Format("%s_In", nuis.GetName()), "", nominal, -7, poisson ? 10 * nominal + 10 : 7));
+	glob->setConstant(true);
+	if (poisson) {
+		constraints.add(*own(new SimplePoissonConstraint(TString::Format("%s_Pdf", nuis.GetName()), "", *glob, nuis)));
+	} else {
+		constraints.add(*own(new SimpleGaussianConstraint(TString::Format("%s_Pdf", nuis.GetName()), "", nuis, *glob, *one_)));
+	}
+	nuisances_.add(nuis);
+}
+
+SyntheticModel::SyntheticModel(const SyntheticConfig &cfg) : cfg_(cfg) {
+	TRandom3 rnd(cfg.seed);
+	x_ = own(new RooRealVar("CMS_th1x", "", 0, cfg.bins));
+	x_->setBins(cfg.bins);
+	cat_ = own(new RooCategory("CMS_channel", ""));
+	for (int c = 0; c < cfg.channels; ++c) cat_->defineType(TString::Format("ch%d", c), c);
+	r_ = own(new RooRealVar("r", "", 1, -5, 10));
+	one_ = own(new RooConstVar("ONE", "", 1.0));
+	weight_ = own(new RooRealVar("_weight_", "", 1.0));
+	observables_.add(*x_);
+	observables_.add(*cat_);
+
+	std::vector<RooRealVar *> lnN, shapes;
+	RooArgList nuisPdfs;
+	for (int k = 0; k < cfg.lnN; ++k) {
+		lnN.push_back(own(new RooRealVar(TString::Format("lnN%d", k), "", 0, -4, 4)));
+		addConstraint(*lnN.back(), nuisPdfs);
+	}
+	for (int k = 0; k < cfg.shapes; ++k) {
+		shapes.push_back(own(new RooRealVar(TString::Format("shape%d", k), "", 0, -4, 4)));
+		addConstraint(*shapes.back(), nuisPdfs);
+	}
+	RooArgList shapeList;
+	for (RooRealVar *s : shapes) shapeList.add(*s);
+
+	pdf_ = own(new RooSimultaneousOpt("model_s", "", *cat_));
+	data_.reset(new RooDataSet("data_obs", "", RooArgSet(*x_, *cat_, *weight_), RooFit::WeightVar(*weight_)));
+	for (int c = 0; c < cfg.channels; ++c) {
+		std::vector<double> expected(cfg.bins, 0.);
+		RooArgList funcs, coeffs, binConstraints;
+		for (int p = 0; p < cfg.processes; ++p) {
+			TString name = TString::Format("ch%d_proc%d", c, p);
+			double yield = (p == 0 ? 10. : 50.) * rnd.Uniform(0.5, 2.0) * cfg.bins;
+			ProcessNormalization *norm = own(new ProcessNormalization("n_exp_bin" + name, "", yield));
+			for (RooRealVar *theta : lnN) {
+				if (rnd.Uniform() < 0.5) norm->addLogNormal(rnd.Uniform(1.01, 1.2), *theta);
+			}
+			if (p == 0) norm->addOtherFactor(*r_);
+			coeffs.add(*norm);
+
+			// nominal, then up and down for each shape nuisance
+			std::vector<std::unique_ptr<TH1D>> templates;
+			templates.push_back(makeTemplate(rnd, "shape_" + name));
+			for (int s = 0; s < cfg.shapes; ++s) {
+				double slope = rnd.Uniform(0.05, 0.3);
+				templates.push_back(varyTemplate(*templates[0], TString::Format("shape_%s_shape%dUp", name.Data(), s), slope));
+				templates.push_back(varyTemplate(*templates[0], TString::Format("shape_%s_shape%dDown", name.Data(), s), -slope));
+			}
+			for (int b = 0; b < cfg.bins; ++b) expected[b] += yield * templates[0]->GetBinContent(b + 1);
+
+			if (cfg.backend == "histsum") {
+				CMSHistFunc *func = own(new CMSHistFunc("shape_" + name + "_morph", "", *x_, *templates[0]));
+				func->setStringAttribute("combine.process", TString::Format("proc%d", p));
+				func->setVerticalMorphs(shapeList);
+				func->setVerticalType(CMSHistFunc::QuadLinear);
+				func->setVerticalSmoothRegion(1.0);
+				func->prepareStorage();
+				func->setShape(0, 0, 0, 0, *templates[0]);
+				for (int s = 0; s < cfg.shapes; ++s) {
+					func->setShape(0, 0, s + 1, 0, *templates[2 + 2 * s]);
+					func->setShape(0, 0, s + 1, 1, *templates[1 + 2 * s]);
+				}
+				funcs.add(*func);
+			} else {
+				TList list;
+				for (auto &t : templates) list.Add(t.get());
+				funcs.add(*own(new FastVerticalInterpHistPdf2("shape_" + name + "_morph", "", *x_, list, shapeList, 1.0, 1)));
+			}
+		}
+
+		RooAbsPdf *sum;
+		if (cfg.backend == "histsum") {
+			CMSHistSum *prop = own(new CMSHistSum(TString::Format("prop_binch%d", c), "", *x_, funcs, coeffs));
+			prop->setAttribute("CachingPdf_NoClone", true);
+			prop->setAttribute("CachingPdf_Direct", true);
+			if (cfg.autoMCStats) {
+				std::unique_ptr<RooArgList> binPars(prop->setupBinPars(10.));
+				binPars->releaseOwnership();
+				for (RooAbsArg *arg : *binPars) {
+					RooRealVar *par = static_cast<RooRealVar *>(arg);
+					binPars_.emplace_back(par);
+					addConstraint(*par, binConstraints, par->getVal(), par->getAttribute("createPoissonConstraint"));
+				}
+			}
+			sum = own(new RooRealSumPdf(TString::Format("pdf_binch%d_sum", c), "", RooArgList(*prop), RooArgList(*one_), true));
+		} else {
+			sum = own(new RooAddPdf(TString::Format("pdf_binch%d_sum", c), "", funcs, coeffs));
+		}
+		RooArgList factors(nuisPdfs);
+		factors.add(*sum);
+		if (binConstraints.getSize()) factors.add(*own(new RooProdPdf(TString::Format("pdfbins_binch%d", c), "", binConstraints)));
+		pdf_->addPdf(*own(new RooProdPdf(TString::Format("pdf_binch%d", c), "", factors)), TString::Format("ch%d", c));
+
+		cat_->setIndex(c);
+		for (int b = 0; b < cfg.bins; ++b) {
+			x_->setVal(b + 0.5);
+			data_->add(RooArgSet(*x_, *cat_), rnd.Poisson(expected[b]));
+		}
+	}
+}
+
+SyntheticModel::~SyntheticModel() {
+	data_.reset();
+	while (!owned_.empty()) owned_.pop_back();
+	binPars_.clear();
+}
+
+struct Measurement {
+	std::string name;
+	double realTime, cpuTime;
+	long evaluations;  // number of NLL evaluations, when known
+	double peakRSS;    // MB, since the start of the job
+};
+
+double peakRSS() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss / 1024.; // kB on Linux
+}
+
+int runSynthetic(const SyntheticConfig &cfg, const std::vector<std::string> &tests, int nllEvals, int scanPoints, const std::string &output, int verbosity) {
+	std::vector<Measurement> results;
+	TStopwatch timer;
+	auto record = [&](const std::string &name, long evaluations) {
+		timer.Stop();
+		results.push_back({name, timer.RealTime(), timer.CpuTime(), evaluations, peakRSS()});
+		const Measurement &m = results.back();
+		printf("%-16s %12.4f s real %12.4f s cpu", m.name.c_str(), m.realTime, m.cpuTime);
+		if (m.evaluations > 0) printf(" %12.1f evals/s", m.evaluations / m.realTime);
+		printf(" %10.1f MB peak RSS\n", m.peakRSS);
+		fflush(stdout);
+	};
+	auto wanted = [&](const char *name) { return std::find(tests.begin(), tests.end(), name) != tests.end(); };
+
+	timer.Start();
+	SyntheticModel model(cfg);
+	record("build", 0);
+
+	RooRealVar &r = model.poi();
+	CascadeMinimizerGlobalConfigs::O().parametersOfInterest = RooArgList();
+	CascadeMinimizerGlobalConfigs::O().parametersOfInterest.add(r);
+	CascadeMinimizerGlobalConfigs::O().nuisanceParameters = RooArgList();
+	CascadeMinimizerGlobalConfigs::O().nuisanceParameters.add(model.nuisances());
+	CascadeMinimizerGlobalConfigs::O().allFloatingParameters = RooArgList();
+	CascadeMinimizerGlobalConfigs::O().allFloatingParameters.add(model.nuisances());
+	CascadeMinimizerGlobalConfigs::O().allFloatingParameters.add(r);
+
+	timer.Start();
+	std::unique_ptr<RooAbsReal> nll = combineCreateNLL(model.pdf(), model.data(), &model.nuisances(), false);
+	nll->getVal();
+	record("setup", 0);
+	std::unique_ptr<RooArgSet> nllParams(nll->getParameters((const RooArgSet *)0));
+	std::unique_ptr<RooArgSet> prefit(static_cast<RooArgSet *>(nllParams->snapshot()));
+
+	if (wanted("nll")) {
+		// change one parameter at a time, as the minimizer does when computing the gradient
+		std::vector<RooRealVar *> params;
+		params.push_back(&r);
+		for (RooAbsArg *a : model.nuisances()) params.push_back(static_cast<RooRealVar *>(a));
+		std::vector<double> start;
+		for (RooRealVar *p : params) start.push_back(p->getVal());
+		timer.Start();
+		for (int i = 0; i < nllEvals; ++i) {
+			unsigned int k = i % params.size();
+			params[k]->setVal(start[k] + ((i / params.size()) % 2 ? 1e-3 : -1e-3));
+			profiler::doNotOptimize(nll->getVal());
+			params[k]->setVal(start[k]);
+		}
+		record("nll", nllEvals);
+	}
+
+	std::unique_ptr<RooArgSet> snapshot;
+	CascadeMinimizer minim(*nll, CascadeMinimizer::Constrained, &r);
+	minim.setStrategy(1);
+	if (wanted("fit") || wanted("hesse") || wanted("scan")) {
+		CloseCoutSentry sentry(verbosity < 2);
+		timer.Start();
+		minim.minimize(verbosity);
+		sentry.clear();
+		record("fit", 0);
+		snapshot.reset(static_cast<RooArgSet *>(nllParams->snapshot()));
+	}
+
+	if (wanted("hesse")) {
+		CloseCoutSentry sentry(verbosity < 2);
+		timer.Start();
+		minim.hesse(verbosity);
+		sentry.clear();
+		record("hesse", 0);
+	}
+
+	if (wanted("scan") && scanPoints > 0) {
+		CloseCoutSentry sentry(verbosity < 2);
+		double rmin = std::max(r.getMin(), r.getVal() - 2 * std::max(r.getError(), 0.1));
+		double rmax = std::min(r.getMax(), r.getVal() + 2 * std::max(r.getError(), 0.1));
+		r.setConstant(true);
+		timer.Start();
+		for (int i = 0; i < scanPoints; ++i) {
+			r.setVal(rmin + (i + 0.5) * (rmax - rmin) / scanPoints);
+			minim.minimize(verbosity);
+		}
+		sentry.clear();
+		record("scan", 0);
+		r.setConstant(false);
+		*nllParams = *snapshot;
+	}
+
+	if (wanted("asimov")) {
+		// the nominal Asimov dataset: nuisances at their pre-fit values, r = 1
+		*nllParams = *prefit;
+		r.setVal(1.0);
+		timer.Start();
+		toymcoptutils::SimPdfGenInfo genInfo(model.pdf(), model.observables(), false);
+		RooRealVar *weightVar = 0;
+		std::unique_ptr<RooAbsData> asimov(genInfo.generateAsimov(weightVar, verbosity));
+		delete weightVar;
+		record("asimov_generate", 0);
+
+		CloseCoutSentry sentry(verbosity < 2);
+		timer.Start();
+		std::unique_ptr<RooAbsReal> nllA = combineCreateNLL(model.pdf(), *asimov, &model.nuisances(), false);
+		CascadeMinimizer minimA(*nllA, CascadeMinimizer::Constrained, &r);
+		minimA.setStrategy(1);
+		minimA.minimize(verbosity);
+		sentry.clear();
+		record("asimov_fit", 0);
+	}
+
+	if (!output.empty()) {
+		FILE *out = fopen(output.c_str(), "w");
+		if (!out) { std::cerr << "ERROR: could not open " << output << " for writing" << std::endl; return 2; }
+		fprintf(out, "{\n  \"root_version\": \"%s\",\n", gROOT->GetVersion());
+		fprintf(out, "  \"model\": {\"backend\": \"%s\", \"channels\": %d, \"bins\": %d, \"processes\": %d, \"lnN\": %d, \"shapes\": %d, \"autoMCStats\": %s, \"seed\": %d, \"parameters\": %d},\n",
+				cfg.backend.c_str(), cfg.channels, cfg.bins, cfg.processes, cfg.lnN, cfg.shapes, cfg.autoMCStats ? "true" : "false", cfg.seed, model.nuisances().getSize() + 1);
+		fprintf(out, "  \"results\": [\n");
+		for (unsigned int i = 0; i < results.size(); ++i) {
+			const Measurement &m = results[i];
+			fprintf(out, "    {\"name\": \"%s\", \"real_s\": %.6g, \"cpu_s\": %.6g, \"evaluations\": %ld, \"evals_per_s\": %.6g, \"peak_rss_mb\": %.1f}%s\n",
+					m.name.c_str(), m.realTime, m.cpuTime, m.evaluations, m.evaluations > 0 ? m.evaluations / m.realTime : 0., m.peakRSS, i + 1 < results.size() ? "," : "");
+		}
+		fprintf(out, "  ]\n}\n");
+		fclose(out);
+	}
+	return 0;
+}
 
 int main(int argc, char *argv[]) {
 	bool doCombineRuntimes = true;
@@ -33,6 +424,9 @@ int main(int argc, char *argv[]) {
 		runtimedef::set("ADDNLL_HFNLL",1);
 		runtimedef::set("ADDNLL_HISTFUNCNLL",1);
 		runtimedef::set("ADDNLL_ROOREALSUM_CHEAPPROD",1);
+		runtimedef::set("ADDNLL_BATCHNLL",1);
+		runtimedef::set("ADDNLL_NORMBANK",1);
+		runtimedef::set("FAST_VERTICAL_MORPH_MATRIX",1);
 	}
 	runtimedef::set("ADDNLL_VERBOSE_CACHING", 0);
 	runtimedef::set("fullCloneFunc_VERBOSE", 1);
@@ -41,45 +435,83 @@ int main(int argc, char *argv[]) {
 	// Uncomment below for more info
 	// RooMsgService::instance().addStream(RooFit::INFO);
 
-	if (void *sym = dlsym(0, "igprof_dump_now")) {
-	  dump_ = __extension__ (void(*)(const char *)) sym;
-	} else {
-	  dump_=0;
-	  std::cout << "Heap profile requested but application is not"
-	            << " currently being profiled with igprof" << std::endl;
+	SyntheticConfig cfg;
+	std::string tests, output, profile;
+	int nllEvals, scanPoints, verbosity;
+	std::vector<std::string> inputs, runtimeDefines;
+	po::options_description desc("Usage:\n  PerfTest file.root workspace    (memory profile with igprof)\n  PerfTest --synthetic [options]  (benchmark on a model built in memory)\nOptions");
+	CascadeMinimizer::initOptions();
+	desc.add_options()
+		("help,h", "Produce help message")
+		("synthetic", "Run the benchmarks on a synthetic model built in memory")
+		("channels", po::value<int>(&cfg.channels)->default_value(10), "Number of channels")
+		("bins", po::value<int>(&cfg.bins)->default_value(20), "Number of bins per channel")
+		("processes", po::value<int>(&cfg.processes)->default_value(5), "Number of processes per channel, the first one being the signal")
+		("lnN", po::value<int>(&cfg.lnN)->default_value(20), "Number of lnN nuisances, each affecting about half of the processes")
+		("shapes", po::value<int>(&cfg.shapes)->default_value(5), "Number of shape nuisances, affecting all the processes")
+		("autoMCStats", po::value<bool>(&cfg.autoMCStats)->default_value(true), "Add the bin-by-bin statistical uncertainties of the templates (histsum backend only)")
+		("backend", po::value<std::string>(&cfg.backend)->default_value("histsum"), "Templates as CMSHistFunc summed by a CMSHistSum (histsum), or FastVerticalInterpHistPdf2 summed by a RooAddPdf (vertical)")
+		("seed", po::value<int>(&cfg.seed)->default_value(123456), "Seed used to build the templates and the pseudo-data")
+		("tests", po::value<std::string>(&tests)->default_value("nll,fit,hesse,scan,asimov"), "Comma-separated list of measurements to run, among nll, fit, hesse, scan, asimov")
+		("nllEvals", po::value<int>(&nllEvals)->default_value(2000), "Number of NLL evaluations for the nll measurement")
+		("scanPoints", po::value<int>(&scanPoints)->default_value(10), "Number of points of the profile likelihood scan of r")
+		("output,o", po::value<std::string>(&output)->default_value("perftest.json"), "Write the results to this JSON file (empty to disable)")
+		("profile", po::value<std::string>(&profile)->default_value(""), "Also record a hierarchical profile, written to <name>.trace.json and <name>.folded")
+		("verbose,v", po::value<int>(&verbosity)->default_value(0), "Verbosity level")
+		("X-rtd", po::value<std::vector<std::string> >(&runtimeDefines), "Define some constants to be used at runtime, with the syntax identifier[=value]")
+		("input", po::value<std::vector<std::string> >(&inputs), "Input file and workspace name")
+		;
+	desc.add(CascadeMinimizer::options());
+	po::positional_options_description p;
+	p.add("input", 2);
+	po::variables_map vm;
+	try {
+		po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+		po::notify(vm);
+	} catch (std::exception &ex) {
+		std::cerr << "Invalid options: " << ex.what() << std::endl;
+		std::cout << desc << std::endl;
+		return 1;
 	}
-
-	gROOT->GetName();
-
-	if (argc < 3) return 1;
-
-	TFile f(argv[1]);
-	if(dump_) {
-		dump_("profdump_file.out.gz");
+	if (vm.count("help") || (!vm.count("synthetic") && inputs.size() != 2)) {
+		std::cout << desc << std::endl;
+		return vm.count("help") ? 0 : 1;
 	}
+	if (!vm.count("synthetic")) return profileWorkspace(inputs[0].c_str(), inputs[1].c_str());
 
-	RooWorkspace *w = (RooWorkspace*)gDirectory->Get(argv[2]);
-	auto allfuncs = w->allFunctions();
-	for (auto *a: allfuncs){
-		auto rrv = dynamic_cast<RooAbsReal*>(a);
-		if (rrv) {
-			rrv->getVal();
-		}
+	CascadeMinimizer::applyOptions(vm);
+	for (const std::string &rtd : runtimeDefines) {
+		std::string::size_type idx = rtd.find('=');
+		if (idx == std::string::npos) runtimedef::set(rtd, 1);
+		else runtimedef::set(rtd.substr(0, idx), atoi(rtd.substr(idx + 1).c_str()));
 	}
-	if(dump_) {
-		dump_("profdump_wsp.out.gz");
+	if (cfg.backend != "histsum" && cfg.backend != "vertical") {
+		std::cerr << "ERROR: unknown backend '" << cfg.backend << "', use histsum or vertical" << std::endl;
+		return 1;
 	}
-
-        RooStats::ModelConfig* mc_s = dynamic_cast<RooStats::ModelConfig *>(w->genobj("ModelConfig")); 
-        RooAbsPdf &pdf = *mc_s->GetPdf();
-        RooAbsData *dobs = w->data("data_obs");
-        const RooCmdArg &constrainCmdArg = RooFit::Constrain(*mc_s->GetNuisanceParameters());
-        std::unique_ptr<RooAbsReal> nll;
-        nll.reset(pdf.createNLL(*dobs, constrainCmdArg, RooFit::Offset(true))); // make a new nll
-        nll->getVal();
-	if(dump_) {
-		dump_("profdump_nll.out.gz");
+	if (cfg.backend == "vertical" && cfg.autoMCStats) {
+		std::cerr << "autoMCStats requires the histsum backend, it will be disabled" << std::endl;
+		cfg.autoMCStats = false;
+	}
+	if (cfg.channels < 1 || cfg.bins < 1 || cfg.processes < 1 || cfg.lnN < 0 || cfg.shapes < 0) {
+		std::cerr << "ERROR: invalid model dimensions" << std::endl;
+		return 1;
+	}
+	std::vector<std::string> testList;
+	for (std::string::size_type start = 0, end; start <= tests.size(); start = end + 1) {
+		end = std::min(tests.find(',', start), tests.size());
+		if (end > start) testList.push_back(tests.substr(start, end - start));
 	}
 
-	return 0;
+	TH1::AddDirectory(false);
+	if (verbosity < 2) RooMsgService::instance().setGlobalKillBelow(RooFit::ERROR);
+	if (!profile.empty()) profiler::enable();
+	int ret = runSynthetic(cfg, testList, nllEvals, scanPoints, output, verbosity);
+	if (!profile.empty()) {
+		profiler::enable(false);
+		if (!profiler::writeChromeTrace(profile + ".trace.json") || !profiler::writeFoldedStacks(profile + ".folded")) {
+			std::cerr << "Failed to write the profile to " << profile << ".trace.json and " << profile << ".folded" << std::endl;
+		}
+	}
+	return ret;
 }
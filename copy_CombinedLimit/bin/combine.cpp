@@ -102,6 +102,7 @@ int main(int argc, char **argv) {
   combiner.miscOptions().add_options()
     ("igpMem", "Setup support for memory profiling using IgProf")
     ("perfCounters", "Dump performance counters at end of job")
+    ("profile", po::value<string>(), "Record a hierarchical profile of the fits and likelihood evaluations, written at the end of the job to <name>.trace.json (Chrome trace format) and <name>.folded (folded stacks for flamegraph.pl)")
     ("LoadLibrary,L", po::value<vector<string> >(&librariesToLoad), "Load library through gSystem->Load(...). Can specify multiple libraries using this option multiple times")
     ("keyword-value",  po::value<vector<string> >(&modelPoints), "Set keyword values with 'WORD=VALUE', will replace $WORD with VALUE in datacards. Filename will also be extended with 'WORDVALUE'. Can specify multiple times")
     ("X-rtd",  po::value<vector<string> >(&runtimeDefines), "Define some constants to be used at runtime (for debugging purposes). The syntax is --X-rtd identifier[=value], where value is an integer and defaults to 1. Can specify multiple times")
@@ -293,6 +294,7 @@ int main(int argc, char **argv) {
   }
 
   if (vm.count("igpMem")) setupIgProfDumpHook();
+  if (vm.count("profile")) profiler::enable();
 
   if (vm.count("X-fpeMask")) gSystem->SetFPEMask(vm["X-fpeMask"].as<int>());
 
@@ -315,6 +317,21 @@ int main(int argc, char **argv) {
   runtimedef::set("ADDNLL_HFNLL",1);
   runtimedef::set("ADDNLL_HISTFUNCNLL",1);
   runtimedef::set("ADDNLL_ROOREALSUM_CHEAPPROD",1);
+  // Batch evaluation of pdfs without a dedicated caching implementation
+  runtimedef::set("ADDNLL_BATCHNLL",1);
+  // Evaluate the ProcessNormalization coefficients of each channel together
+  runtimedef::set("ADDNLL_NORMBANK",1);
+  // GoodnessOfFit KS/AD from the template caches of binned channels
+  runtimedef::set("GOF_KSAD_FROM_CACHE",1);
+  // GoodnessOfFit saturated model in closed form for binned channels
+  runtimedef::set("GOF_SATURATED_ANALYTIC",1);
+  // Vertical template morphing of FastVerticalInterpHistPdf2(D2) in one blocked pass over all morphs
+  runtimedef::set("FAST_VERTICAL_MORPH_MATRIX",1);
+  // Bin integrals of RooParametricShapeBinPdf computed once per change of its parameters
+  runtimedef::set("PARAMETRIC_SHAPE_BIN_CACHE",1);
+  // Asimov datasets reused for the same model, parameters and data, and filled from the CMSHistSum caches
+  runtimedef::set("ASIMOV_CACHE",1);
+  runtimedef::set("TMCSO_ASIMOV_FROM_CACHE",1);
  
 
 
@@ -348,6 +365,13 @@ int main(int argc, char **argv) {
     delete i->second;
 
   if (vm.count("perfCounters")) PerfCounter::printAll();
+  if (vm.count("profile")) {
+    profiler::enable(false);
+    string profileName = vm["profile"].as<string>();
+    if (!profiler::writeChromeTrace(profileName + ".trace.json") || !profiler::writeFoldedStacks(profileName + ".folded")) {
+      cerr << "Failed to write the profile to " << profileName << ".trace.json and " << profileName << ".folded" << endl;
+    }
+  }
 }
 
 
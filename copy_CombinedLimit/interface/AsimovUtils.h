@@ -5,11 +5,20 @@ class RooAbsData;
 class RooAbsCollection;
 namespace RooStats { class ModelConfig; }
 
+#include <string>
+
 namespace asimovutils {
     /// Generate asimov dataset from nominal value of nuisance parameters
     RooAbsData * asimovDatasetNominal(RooStats::ModelConfig *mc, double poiValue=0.0, int verbose=0) ;
     /// Generate asimov dataset from best fit value of nuisance parameters, and fill in snapshot of corresponding global observables
     RooAbsData * asimovDatasetWithFit(RooStats::ModelConfig *mc, RooAbsData &realdata, RooAbsCollection &snapshot, bool needsFit, double poiValue=0.0, int verbose=0) ;
+
+    /// The last dataset made by the two functions above is kept (with --X-rtd ASIMOV_CACHE) with the parameters after the fit
+    /// and the global observables, keyed by a hash of the model, of all its parameters, of the POI value, of the data that
+    /// is fitted and of the minimizer options; a later call with the same key returns a copy instead of fitting and generating again.
+    /// If a directory is set, all of them are also written there and read back by later calls and by other jobs.
+    void setCacheDir(const std::string &dir) ;
+    void clearCache() ;
 }
 
 #endif
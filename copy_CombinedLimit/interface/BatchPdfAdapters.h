@@ -0,0 +1,45 @@
+#ifndef BatchPdfAdapters_h
+#define BatchPdfAdapters_h
+
+#include <RooAbsReal.h>
+#include <RooAbsData.h>
+#include <RooArgSet.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cacheutils {
+/// Evaluate a pdf (or function) over a whole dataset in one call, for the pdf types that
+/// have no dedicated OptimizedCachingPdfT. The values are those of pdf.getVal(obs) for
+/// each entry, in the same order and with the same zero-weight selection used by
+/// CachingPdf::realFill_.
+///
+/// Vectorized adapters are registered per class name. Classes without one can use RooFit's
+/// own batch evaluation (ROOT >= 6.32). The choice can be overridden per class with the
+/// runtime define ADDNLL_BATCH_<ClassName>: -1 for scalar evaluation, 1 to also use the RooFit
+/// fallback, 0 (default) for the registered adapter only. ADDNLL_BATCH_ROOFIT=1 enables the
+/// RooFit fallback for all classes, and ADDNLL_BATCH_CHECK=1 cross-checks every batch fill
+/// against the scalar evaluation.
+class BatchPdfAdapter {
+    public:
+        typedef std::function<BatchPdfAdapter *(const RooAbsReal &pdf, const RooArgSet &obs, const RooAbsData &data, bool includeZeroWeights)> Factory;
+        enum Mode { Scalar = -1, Default = 0, Batch = 1 };
+
+        virtual ~BatchPdfAdapter() {}
+        virtual void fill(std::vector<Double_t> &out) const = 0;
+
+        /// register (or replace) the adapter used for pdfs of class className
+        static void registerAdapter(const std::string &className, Factory factory) ;
+        static Mode mode(const RooAbsReal &pdf) ;
+        /// true if a batch adapter can be tried for this pdf
+        static bool enabled(const RooAbsReal &pdf) ;
+        /// make the adapter for this pdf and dataset; returns 0 if the pdf can't be evaluated
+        /// in batch on this dataset (e.g. the observable isn't the expected one)
+        static BatchPdfAdapter * create(const RooAbsReal &pdf, const RooArgSet &obs, const RooAbsData &data, bool includeZeroWeights) ;
+    private:
+        static std::map<std::string, Factory> & registry() ;
+};
+}
+
+#endif
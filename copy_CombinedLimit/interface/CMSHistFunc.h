@@ -15,6 +15,7 @@
 #include "CMSHistV.h"
 #include "FastTemplate_Old.h"
 #include "SimpleCacheSentry.h"
+#include "HorizontalMorph.h"
 #include "CMSExternalMorph.h"
 
 class CMSHistFuncWrapper;
@@ -39,10 +40,8 @@ class CMSHistFunc : public RooAbsReal {
     FastTemplate cdf;
     double integral = 0.;
 
-    // The interpolation points between this cache and another one
-    std::vector<double> x1;
-    std::vector<double> x2;
-    std::vector<double> y;
+    // The inverse cdf table of the interpolation between this cache and another one
+    HorizontalMorph hmorph;
 
     FastTemplate sum;
     FastTemplate diff;
@@ -212,8 +211,8 @@ class CMSHistFunc : public RooAbsReal {
 
   void prepareInterpCache(Cache& c1, Cache const& c2) const;
 
-  FastTemplate cdfMorph(unsigned idx, double par1, double par2,
-                        double parinterp) const;
+  void cdfMorph(unsigned idx, double par1, double par2, double parinterp,
+                FastTemplate& out) const;
 
   double integrateTemplate(FastTemplate const& t) const;
 
@@ -36,16 +36,22 @@ CMSHistV<T>::CMSHistV(const T& hpdf, const RooAbsData& data,
                       bool includeZeroWeights)
     : hpdf_(hpdf) {
   hpdf.updateCache();
-  std::vector<int> bins;
+  std::vector<double> xvals;
   RooArgSet obs(hpdf.x_.arg());
   const RooRealVar& x = static_cast<const RooRealVar&>(*obs.first());
-  bool aligned = true;
   for (int i = 0, n = data.numEntries(); i < n; ++i) {
     obs = *data.get(i);
     if (data.weight() == 0 && !includeZeroWeights) continue;
-    int idx = hpdf.cache().FindBin(x.getVal());
-    if (!bins.empty() && idx != bins.back() + 1) aligned = false;
-    bins.push_back(idx);
+    xvals.push_back(x.getVal());
+  }
+  std::vector<int> bins(xvals.size());
+  if (!xvals.empty()) hpdf.cache().FindBins(xvals.size(), &xvals[0], &bins[0]);
+  bool aligned = true;
+  for (int i = 1, n = bins.size(); i < n; ++i) {
+    if (bins[i] != bins[i - 1] + 1) {
+      aligned = false;
+      break;
+    }
   }
   if (bins.empty()) {
     // nothing to do.
@@ -7,6 +7,7 @@
 #include <RooAddPdf.h>
 #include <RooProduct.h>
 #include <vector>
+#include <list>
 
 namespace cacheutils {
     class CachingMultiPdf : public CachingPdfBase {
@@ -17,9 +18,28 @@ namespace cacheutils {
             const RooAbsReal *pdf() const override { return pdf_; }
             void  setDataDirty() override ;
             void  setIncludeZeroWeights(bool includeZeroWeights) override ;
+            /// number of alternatives whose cache is currently allocated
+            unsigned int allocated() const ;
         protected:
             const RooMultiPdf * pdf_;
+            const RooArgSet * obs_;
+            bool includeZeroWeights_ = false;
+            /// caches of the alternatives: made when an alternative is first selected, null before that or after eviction
             std::vector<std::unique_ptr<CachingPdfBase>>  cachingPdfs_;
+
+            /// The allocated alternatives of all the CachingMultiPdfs, most recently used first, with an estimate
+            /// of their size. Above the budget set with the runtimedef MULTIPDF_CACHE_BUDGET_MB (0 = no limit)
+            /// the least recently used ones are freed, except those that are the current index of their pdf.
+            struct LRUEntry { CachingMultiPdf *owner; int index; size_t bytes; };
+            typedef std::list<LRUEntry> LRUList;
+            static LRUList lru_;
+            static size_t  lruBytes_;
+            std::vector<LRUList::iterator> lruPos_;
+
+            CachingPdfBase & alternative(int index) ;
+            void touch(int index, size_t bytes) ;
+            void release(int index) ;
+            static void evict(size_t budget) ;
     };
 
     class CachingAddPdf : public CachingPdfBase {
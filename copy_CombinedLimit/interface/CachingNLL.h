@@ -18,6 +18,7 @@
 #include "SimpleGaussianConstraint.h"
 #include "SimplePoissonConstraint.h"
 #include "SimpleConstraintGroup.h"
+#include "ProcessNormalizationBank.h"
 
 class RooMultiPdf;
 
@@ -108,6 +109,21 @@ class OptimizedCachingPdfT : public CachingPdf {
         VPdfT *vpdf_;
 };
 
+class BatchPdfAdapter;
+/// CachingPdf that fills all the values at once through a BatchPdfAdapter (see BatchPdfAdapters.h),
+/// falling back to the per-entry evaluation if no adapter can be made for the dataset
+class CachingBatchPdf : public CachingPdf {
+    public:
+        CachingBatchPdf(RooAbsReal *pdf, const RooArgSet *obs) ;
+        CachingBatchPdf(const CachingBatchPdf &other) ;
+        ~CachingBatchPdf() override ;
+    protected:
+        void realFill_(const RooAbsData &data, std::vector<Double_t> &values) override ;
+        void newData_(const RooAbsData &data) override ;
+        std::unique_ptr<BatchPdfAdapter> adapter_;
+        std::vector<Double_t> scalarValues_;
+};
+
 CachingPdfBase * makeCachingPdf(RooAbsReal *pdf, const RooArgSet *obs) ;
 
 class CachingAddNLL : public RooAbsReal {
@@ -132,6 +148,10 @@ class CachingAddNLL : public RooAbsReal {
         virtual void  setIncludeZeroWeights(bool includeZeroWeights) ;
         RooSetProxy & params() { return params_; }
         RooSetProxy & catParams() { return catParams_; }
+        /// true if this is a binned Poisson likelihood (one data entry per bin of the observable)
+        bool isBinned() const ;
+        /// closed-form NLL of the saturated model for a binned channel, same conventions as evaluate() without the constant zero point
+        double saturatedNLL() const ;
     private:
         void setup_();
         void addPdfs_(RooAddPdf *addpdf, bool recursive, const RooArgList & basecoeffs) ;
@@ -145,10 +165,14 @@ class CachingAddNLL : public RooAbsReal {
         mutable std::vector<std::unique_ptr<CachingPdfBase>>  pdfs_;
         mutable std::vector<std::unique_ptr<RooAbsReal>>  prods_;
         mutable std::vector<RooAbsReal*> integrals_;
+        /// ProcessNormalization coefficients evaluated together; normIndex_[i] is the index of coeffs_[i] in it, or -1
+        mutable std::unique_ptr<ProcessNormalizationBank> normBank_;
+        mutable std::vector<int> normIndex_;
         mutable std::vector<std::pair<const RooMultiPdf*,CachingPdfBase*> > multiPdfs_;
         mutable std::vector<Double_t> partialSum_;
         mutable std::vector<Double_t> workingArea_;
         mutable bool isRooRealSum_, fastExit_;
+        const char *profileName_ = "CachingAddNLL";
         mutable int canBasicIntegrals_, basicIntegrals_;
         double zeroPoint_ = 0;
         double constantZeroPoint_ = 0; // this is arbitrary and kept constant for all the lifetime of the PDF
@@ -182,6 +206,15 @@ class CachingSimNLL  : public RooAbsReal {
         void setHideConstants(bool flag) { hideConstants_ = flag; }
         void setMaskConstraints(bool flag) ;
         void setMaskNonDiscreteChannels(bool mask) ;
+        /// labels of the channels that are binned Poisson likelihoods
+        std::vector<std::string> binnedChannels() const ;
+        /// sum of the closed-form saturated NLL of the given binned channels, skipping masked ones
+        double saturatedNLL(const std::vector<std::string> &channels) const ;
+        /// the NLL is a sum of terms: the channels, followed by the generic, fast gaussian and fast poisson constraints.
+        /// For each of the given parameters, the indices of the terms that depend on it
+        std::vector<std::vector<unsigned int> > termsDependingOn(const RooArgList &params) const ;
+        /// sum of the given terms, skipping masked ones; it differs from getVal() by the sum of the other terms
+        double evaluateTerms(const std::vector<unsigned int> &terms) const ;
         friend class CachingAddNLL;
         // trap this call, since we don't care about propagating it to the sub-components
         void constOptimizeTestStatistic(ConstOpCode opcode, Bool_t doAlsoTrackingOpt=kTRUE) override { }
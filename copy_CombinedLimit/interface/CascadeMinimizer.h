@@ -32,6 +32,8 @@ class CascadeMinimizer {
         static void  initOptions() ;
         static void  applyOptions(const boost::program_options::variables_map &vm) ;
         static const boost::program_options::options_description & options() { return options_; }
+        /// the values of all the options above (after applyOptions), e.g. to tell apart results of fits made with different settings
+        static std::string optionsString() ;
         void trivialMinimize(const RooAbsReal &nll, RooRealVar &r, int points=100) const ;
         //void collectIrrelevantNuisances(RooAbsCollection &irrelevant) const ;
 	bool freezeDiscParams(const bool);
@@ -0,0 +1,83 @@
+#ifndef HiggsAnalysis_CombinedLimit_ChannelBuilder_h
+#define HiggsAnalysis_CombinedLimit_ChannelBuilder_h
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class RooAbsReal;
+class RooRealVar;
+class RooWorkspace;
+class TH1;
+
+//_________________________________________________
+/*
+ * Builds the model of one channel with histogram templates and autoMCStats in C++, for text2workspace
+ * (--X-bulk-channels): the CMSHistFunc of each process, with its shape effects, the ProcessNormalization
+ * with its lnN, shape and other (rateParam, physics model) factors, the CMSHistSum and the constraints of
+ * the autoMCStats bin parameters, all imported in the workspace with a single RooWorkspace::import.
+ *
+ * The nuisance parameters and the other factors must already be in the workspace. The normalization
+ * effects of the shape templates are packed in the ProcessNormalization (as with --X-pack-asympows),
+ * and the templates are copied to the padded binning used by ShapeBuilder::rebinH1.
+ */
+class ChannelBuilder {
+    public:
+        /// prop is the name of the CMSHistSum; the templates are copied to bins [0, bins) of x, or to their own
+        /// number of bins if optimizeBins is false
+        ChannelBuilder(RooWorkspace &w, const std::string &channel, const std::string &prop, RooRealVar &x, int bins, bool optimizeBins = true) ;
+        ~ChannelBuilder() ;
+
+        /// add a process with nominal template; func and norm are the names of its CMSHistFunc and normalization
+        void addProcess(const std::string &process, const std::string &func, const std::string &norm, bool signal, double rate, const TH1 &nominal, bool logVertical = false) ;
+        void addLogNormal(const std::string &process, double kappa, const std::string &theta) ;
+        void addAsymmLogNormal(const std::string &process, double kappaLo, double kappaHi, const std::string &theta) ;
+        /// multiply the normalization by a function or variable in the workspace (e.g. a rateParam)
+        void addFactor(const std::string &process, const std::string &factor) ;
+        /// shape effect of theta (multiplied by scale), with its effect on the normalization
+        void addShape(const std::string &process, const std::string &theta, double scale, const TH1 &up, const TH1 &down) ;
+        /// autoMCStats settings of the channel (no bin parameters are made if threshold is negative)
+        void setAutoMCStats(double threshold, bool includeSignal, int histMode, bool optimizedGaussians = true, bool optimizeBounds = false) ;
+
+        /// make all the objects and import them in the workspace; throws std::runtime_error on inconsistent inputs
+        void build() ;
+        /// names of the autoMCStats bin parameters made by build(); each has a constraint <name>_Pdf on <name>_In
+        /// (for a <var>_prod name, the constrained parameter is <var>)
+        const std::vector<std::string> & binParameters() const { return binParameters_; }
+
+    private:
+        struct Shape {
+            std::string theta;
+            double scale, kappaLo, kappaHi;
+            int originalBins;
+            std::unique_ptr<TH1> up, down;
+        };
+        struct Process {
+            std::string name, func, norm;
+            bool signal, logVertical;
+            double rate, integral;
+            int originalBins;
+            std::unique_ptr<TH1> nominal;
+            std::vector<std::pair<double, std::string>> logNormals;
+            std::vector<std::pair<std::pair<double, double>, std::string>> asymmLogNormals;
+            std::vector<std::string> factors;
+            std::vector<Shape> shapes;
+        };
+
+        RooWorkspace &w_;
+        std::string channel_, prop_;
+        RooRealVar &x_;
+        int bins_;
+        bool optimizeBins_;
+        double threshold_ = -1;
+        bool includeSignal_ = true, optimizedGaussians_ = true, optimizeBounds_ = false;
+        int histMode_ = 1;
+        std::vector<Process> processes_;
+        std::vector<std::string> binParameters_;
+
+        Process & process(const std::string &name) ;
+        RooAbsReal & arg(const std::string &name) const ;
+        std::unique_ptr<TH1> padded(const TH1 &hist) const ;
+};
+
+#endif
@@ -9,6 +9,11 @@
  *
  */
 #include "FitterAlgoBase.h"
+#include <RooArgList.h>
+
+class RooAbsCategoryLValue;
+class RooRealVar;
+class RooSimultaneous;
 
 class ChannelCompatibilityCheck : public FitterAlgoBase {
 public:
@@ -32,6 +37,16 @@ protected:
   static std::map<TString,std::pair<double,double>> groupRanges_;
 
   bool runSpecific(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint) override;
+
+  // the free-form model with one signal strength per channel (or group), made once per job for the model in freeformOf_,
+  // and the two nlls, which are kept between toys and only get the new dataset
+  void buildFreeForm(RooWorkspace *w, RooSimultaneous &sim, RooRealVar &r) ;
+  const RooSimultaneous *freeformOf_ = nullptr;
+  std::unique_ptr<RooAbsCategoryLValue> freeformCat_;
+  std::unique_ptr<RooSimultaneous> freeform_;
+  std::map<std::string,std::string> rs_;
+  RooArgList minosVars_;
+  std::unique_ptr<RooAbsReal> nllNominal_, nllFreeform_;
 };
 
 
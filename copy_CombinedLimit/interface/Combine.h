@@ -1,5 +1,6 @@
 #ifndef HiggsAnalysis_CombinedLimit_Combine_h
 #define HiggsAnalysis_CombinedLimit_Combine_h
+#include <memory>
 #include <TString.h>
 #include <TFile.h>
 #include <boost/program_options.hpp>
@@ -10,6 +11,7 @@
 class TDirectory;
 class TTree;
 class LimitAlgo;
+class ResultStoreWriter;
 class RooWorkspace;
 class RooAbsData;
 namespace RooStats { class ModelConfig; }
@@ -71,6 +73,9 @@ private:
   void addPOI(const RooArgSet *);
   template <class Var>
   void addBranches(const std::string&, RooWorkspace*, std::vector<std::pair<Var*,float>>&, const std::string&);
+  /// (re)define the columns of the result store from the branches of the output tree
+  static void bindResultStore() ;
+  static void closeResultStore() ;
 
   boost::program_options::options_description statOptions_, ioOptions_, miscOptions_;
 
@@ -99,6 +104,8 @@ private:
   bool overrideSnapshotMass_;
   bool validateModel_;
   bool saveToys_;
+  std::string resultStoreFile_;
+  std::string asimovCacheDir_;
   double mass_;
 
   // implementation-related variables
@@ -106,6 +113,7 @@ private:
   bool makeTempDir_;
   bool rebuildSimPdf_;
   bool optSimPdf_;
+  std::string setupCacheDir_;
   bool noMCbonly_;
   bool noDefaultPrior_;
   bool makeToyGenSnapshot_;
@@ -115,6 +123,8 @@ private:
   std::vector<std::string> modelPoints_;
   
   static TTree *tree_;
+  static std::unique_ptr<ResultStoreWriter> resultStore_;
+  static int resultStoreBranches_;
 
   static std::vector<std::pair<RooAbsReal*,float> > trackedParametersMap_;
   static std::vector<std::pair<RooRealVar*,float> > trackedErrorsMap_;
@@ -0,0 +1,39 @@
+#ifndef HiggsAnalysis_CombinedLimit_FactorizationCache_h
+#define HiggsAnalysis_CombinedLimit_FactorizationCache_h
+
+#include <cstdint>
+#include <string>
+
+class RooAbsPdf;
+class RooArgSet;
+class RooArgList;
+
+//_________________________________________________
+/*
+ * On-disk cache of the factorization of the model into observable-dependent terms and constraints.
+ * The answers of utils::factorizePdf to "does this term depend on the observables?" are stored in a
+ * small binary file in the cache directory, keyed by the name of the workspace, a structural hash of
+ * the model (the class and name of each node and the names of its servers) and the observables.
+ * Later jobs on the same model replay the factorization from the file instead of asking each term
+ * whether it depends on the observables, even if the workspace file was made again (e.g. from a text
+ * datacard). Terms that are not in the file are evaluated as usual and added to it.
+ * The result is the same as that of utils::factorizePdf.
+ */
+class FactorizationCache {
+    public:
+        /// enable the cache, storing files in dir; an empty dir disables it
+        static void setDirectory(const std::string &dir) ;
+        /// key the cache also on the name of the workspace
+        static void setWorkspace(const std::string &name) ;
+        static bool enabled() ;
+
+        /// same as utils::factorizePdf(observables, pdf, constraints), using the cache if it is enabled
+        static RooAbsPdf *factorizePdf(const RooArgSet &observables, RooAbsPdf &pdf, RooArgList &constraints) ;
+
+        /// 64-bit FNV-1a hash
+        static uint64_t hash(const void *data, size_t size, uint64_t seed = 14695981039346656037ULL) ;
+        /// hash of the graph of pdf: class and name of each node, and the names of its servers
+        static uint64_t structureHash(const RooAbsPdf &pdf, uint64_t seed = 14695981039346656037ULL) ;
+};
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef HiggsAnalysis_CombinedLimit_FastBinIndex_h
+#define HiggsAnalysis_CombinedLimit_FastBinIndex_h
+
+#include <cmath>
+#include <vector>
+
+/*
+ * Lookup index over the sorted bin edges of an axis, giving the same results as std::upper_bound and
+ * std::lower_bound on the edges (including for NaN and for values outside the axis) without a binary
+ * search over the edge vector:
+ *  - if the binning is uniform, the position is computed from the distance to the first edge, and
+ *    corrected by comparing with the neighbouring edges so that rounding never changes the result;
+ *  - otherwise the edges are stored in Eytzinger (breadth-first) order, which is searched without
+ *    branches on the comparisons and with the top levels of the tree sharing a few cache lines.
+ * The index does not keep track of changes to the edges: the owner must build() it again.
+ */
+template <typename U> class FastBinIndex_t {
+public:
+  FastBinIndex_t() : n_(0), uniform_(false), invWidth_(0) {}
+
+  void build(const U *edges, unsigned int n) {
+    n_ = n;
+    edges_.assign(edges, edges + n);
+    uniform_ = false;
+    eytzinger_.clear();
+    position_.clear();
+    if (n == 0) return;
+    if (n >= 2) {
+      double width = (double(edges[n-1]) - double(edges[0])) / (n - 1);
+      uniform_ = (width > 0 && std::isfinite(width));
+      for (unsigned int i = 1; uniform_ && i < n - 1; ++i) {
+        uniform_ = std::abs(double(edges[i]) - (double(edges[0]) + i * width)) <= 1e-6 * width;
+      }
+      invWidth_ = uniform_ ? 1.0 / width : 0;
+    }
+    if (!uniform_) {
+      eytzinger_.resize(n + 1);
+      position_.resize(n + 1);
+      position_[0] = n;  // past the end
+      unsigned int next = 0;
+      fill(1, next);
+    }
+  }
+  void clear() { n_ = 0; edges_.clear(); eytzinger_.clear(); position_.clear(); uniform_ = false; }
+  bool empty() const { return edges_.empty(); }
+  bool uniform() const { return uniform_; }
+
+  /// std::upper_bound(edges, edges + n, x) - edges
+  unsigned int upperBound(const U &x) const {
+    if (uniform_) {
+      const U *e = &edges_[0];
+      if (x < e[0]) return 0;
+      if (!(x < e[n_-1])) return n_;  // also for NaN
+      unsigned int p = 1 + (unsigned int)((double(x) - double(e[0])) * invWidth_);
+      if (p > n_ - 1) p = n_ - 1;
+      while (!(x < e[p])) ++p;
+      while (x < e[p-1]) --p;
+      return p;
+    }
+    if (n_ == 0) return 0;
+    const U *e = &eytzinger_[0];
+    unsigned int k = 1;
+    while (k <= n_) k = 2 * k + !(x < e[k]);
+    k >>= __builtin_ffs(~k);
+    return position_[k];
+  }
+  /// std::lower_bound(edges, edges + n, x) - edges
+  unsigned int lowerBound(const U &x) const {
+    if (uniform_) {
+      const U *e = &edges_[0];
+      if (!(e[0] < x)) return 0;  // also for NaN
+      if (e[n_-1] < x) return n_;
+      unsigned int p = 1 + (unsigned int)((double(x) - double(e[0])) * invWidth_);
+      if (p > n_ - 1) p = n_ - 1;
+      while (e[p] < x) ++p;
+      while (!(e[p-1] < x)) --p;
+      return p;
+    }
+    if (n_ == 0) return 0;
+    const U *e = &eytzinger_[0];
+    unsigned int k = 1;
+    while (k <= n_) k = 2 * k + (e[k] < x);
+    k >>= __builtin_ffs(~k);
+    return position_[k];
+  }
+  /// upperBound (lowerBound) minus one, for the n values of x; the loops can be unrolled and
+  /// vectorised for uniform binning
+  void upperBins(unsigned int n, const U *x, int *bins) const {
+    for (unsigned int i = 0; i < n; ++i) bins[i] = int(upperBound(x[i])) - 1;
+  }
+  void lowerBins(unsigned int n, const U *x, int *bins) const {
+    for (unsigned int i = 0; i < n; ++i) bins[i] = int(lowerBound(x[i])) - 1;
+  }
+
+private:
+  unsigned int n_;
+  bool uniform_;
+  double invWidth_;
+  std::vector<U> edges_;
+  std::vector<U> eytzinger_;            // 1-based, node k has children 2k and 2k+1
+  std::vector<unsigned int> position_;  // position in edges_ of each node, n_ for node 0
+
+  void fill(unsigned int k, unsigned int &next) {
+    if (k > n_) return;
+    fill(2 * k, next);
+    eytzinger_[k] = edges_[next];
+    position_[k] = next++;
+    fill(2 * k + 1, next);
+  }
+};
+
+#endif
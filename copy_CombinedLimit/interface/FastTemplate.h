@@ -6,11 +6,18 @@
 #include <TH3.h>
 #include <algorithm>
 #include <vector>
+#include "FastBinIndex.h"
 
 
 template <typename U> class FastHistoAxis_t {
 protected:
   std::vector<U> binEdges_;
+  mutable FastBinIndex_t<U> index_; //! built on the first FindBin after the edges are set
+
+  const FastBinIndex_t<U>& index() const {
+    if (index_.empty() && !binEdges_.empty()) index_.build(&binEdges_[0], binEdges_.size());
+    return index_;
+  }
 
 public:
   FastHistoAxis_t() : binEdges_(){}
@@ -26,12 +33,12 @@ public:
   unsigned int size() const { return binEdges_.size(); }
   unsigned int GetNbins() const{ int s=size(); return (unsigned int)std::max(s-1, 0); }
 
-  void resize(unsigned int newsize){ if (newsize != size()) binEdges_.resize(newsize); }
-  void swap(const FastHistoAxis_t<U>& other){ std::swap(binEdges_, other.binEdges_); }
+  void resize(unsigned int newsize){ if (newsize != size()) { binEdges_.resize(newsize); index_.clear(); } }
+  void swap(const FastHistoAxis_t<U>& other){ std::swap(binEdges_, other.binEdges_); index_.clear(); other.index_.clear(); }
 
-  U& operator[](unsigned int i) { return binEdges_.at(i); }
+  U& operator[](unsigned int i) { index_.clear(); return binEdges_.at(i); }
   const U& operator[](unsigned int i) const { return binEdges_.at(i); }
-  FastHistoAxis_t<U>& operator=(const FastHistoAxis_t<U>& other){ binEdges_ = other.binEdges_; return *this; }
+  FastHistoAxis_t<U>& operator=(const FastHistoAxis_t<U>& other){ binEdges_ = other.binEdges_; index_.clear(); return *this; }
   FastHistoAxis_t<U>& operator=(const TAxis& axis){
     FastHistoAxis_t<U> other(axis);
     swap(other);
@@ -39,11 +46,16 @@ public:
   }
 
   int FindBin(const U& x) const{
-    if (x==binEdges_.at(size()-1) && size()>1) return (int)(size()-2);
-    auto bbegin = binEdges_.begin();
-    auto bend = binEdges_.end();
-    auto match = std::upper_bound(bbegin, bend, x);
-    return match - bbegin - 1;
+    if (binEdges_.empty()) return -1;
+    if (x==binEdges_.back() && size()>1) return (int)(size()-2);
+    return (int)index().upperBound(x) - 1;
+  }
+  /// FindBin for n values of x at once
+  void FindBins(unsigned int n, const U* x, int* bins) const{
+    if (binEdges_.empty()) { std::fill(bins, bins+n, -1); return; }
+    index().upperBins(n, x, bins);
+    const U last = binEdges_.back();
+    if (size()>1) { for (unsigned int i=0; i<n; ++i) if (x[i]==last) bins[i] = (int)(size()-2); }
   }
   U GetBinWidth(const unsigned int bin) const{
     if (size()==0) return U(0);
@@ -80,6 +92,10 @@ public:
         void CopyValues(const TH3 &other) ;
         T & operator[](unsigned int i) { return values_[i]; }
         const T & operator[](unsigned int i) const { return values_[i]; }
+        /// return a pointer to the contiguous storage of the full template (fullsize() elements),
+        /// e.g. to wrap it without copying in a numpy array
+        T * data() { return values_.data(); }
+        const T * data() const { return values_.data(); }
         /// return the full size of the template
         const unsigned int fullsize() const { return values_.size(); }
         /// return the active size of the template (can be less than the full size if the SetActiveSize
@@ -153,6 +169,7 @@ public:
         }
 
         int FindBin(const U &x) const { return axis_.FindBin(x); }
+        void FindBins(unsigned int n, const U *x, int *bins) const { axis_.FindBins(n, x, bins); }
         unsigned int GetNbinsX() const { return axis_.GetNbins(); }
         U GetBinWidth(const unsigned int bin) const { if (normX_) return U(1); else return axis_.GetBinWidth(bin); }
         U GetXmin(const int bin=-1) const { return axis_.GetBinLowEdge(bin); }
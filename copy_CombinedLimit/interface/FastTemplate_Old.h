@@ -6,6 +6,7 @@
 #include <TH3.h>
 #include <algorithm>
 #include <vector>
+#include "FastBinIndex.h"
 
 class FastTemplate {
     public:
@@ -47,6 +48,10 @@ class FastTemplate {
         void CopyValues(const TH3 &other) ;
         T & operator[](unsigned int i) { return values_[i]; }
         const T & operator[](unsigned int i) const { return values_[i]; }
+        /// return a pointer to the contiguous storage of the full template (fullsize() elements),
+        /// e.g. to wrap it without copying in a numpy array
+        T * data() { return values_.data(); }
+        const T * data() const { return values_.data(); }
         /// return the full size of the template
         const unsigned int fullsize() const { return values_.size(); }
         /// return the active size of the template (can be less than the full size if the SetActiveSize
@@ -91,6 +96,7 @@ class FastHisto : public FastTemplate {
                 values_    = other.values_;
                 binWidths_ = other.binWidths_;
                 binEdges_  = other.binEdges_;
+                index_.clear();
             } else CopyValues(other); 
             return *this; 
         }
@@ -107,9 +113,12 @@ class FastHisto : public FastTemplate {
             std::swap(values_, other.values_);
             std::swap(binWidths_, other.binWidths_);
             std::swap(binEdges_, other.binEdges_);
+            std::swap(index_, other.index_);
         }
         T GetAt(const T &x) const ;
         int FindBin(const T &x) const ;
+        /// FindBin for n values of x at once
+        void FindBins(unsigned int n, const T *x, int *bins) const ;
         const T & GetBinContent(int bin) const { return values_[bin]; }
         T IntegralWidth() const ;
         void Normalize() {
@@ -127,6 +136,12 @@ class FastHisto : public FastTemplate {
     private:
         AT binEdges_;
         AT binWidths_;
+        mutable FastBinIndex_t<T> index_; //! built on the first FindBin or GetAt
+
+        const FastBinIndex_t<T> & index() const {
+            if (index_.empty() && !binEdges_.empty()) index_.build(&binEdges_[0], binEdges_.size());
+            return index_;
+        }
     
 };
 class FastHisto2D : public FastTemplate {
@@ -40,6 +40,7 @@ protected:
   static bool        makePlots_;
   static float       rebinFactor_;
   static int         numToysForShapes_;
+  static int         numWorkersForShapes_;
   static std::string signalPdfNames_, backgroundPdfNames_;
   static std::string filterString_;
   static bool        saveNormalizations_;
@@ -27,6 +27,11 @@ public:
   virtual bool runKSandAD(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint, bool kolmo);
   void initKSandAD(RooStats::ModelConfig *mc_s);
   double EvaluateADDistance(RooAbsPdf& pdf, RooAbsData& data, RooRealVar& observable, bool kolmo);
+  /// Fill the KS/AD buffers from the bin caches of CMSHistSum/CMSHistErrorPropagator templates.
+  /// Returns false if the channel or the dataset is not suitable, in which case nothing is used.
+  bool fillCdfFromCache(RooAbsPdf& pdf, RooAbsData& data, RooRealVar& observable);
+  /// Compute the KS/AD distance from the (observable, weight, cdf) points stored in the buffers
+  double EvaluateADDistanceFromCdf(RooAbsData& data, RooRealVar& observable, bool kolmo);
  
 protected:
   static std::string algo_;
@@ -50,6 +55,11 @@ protected:
   RooAbsPdf *makeSaturatedPdf(RooAbsData &data);
   mutable std::vector<RooAbsData*> tempData_;
 
+  // Buffers for the KS/AD computation, kept across toys to avoid re-allocations
+  std::vector<double> ksadObs_, ksadWeights_, ksadCdf_;
+  std::vector<double> ksadBinYields_, ksadBinWeights_;
+  std::vector<int>    ksadBinHits_;
+
 };
 
 
@@ -0,0 +1,65 @@
+#ifndef HiggsAnalysis_CombinedLimit_HorizontalMorph_h
+#define HiggsAnalysis_CombinedLimit_HorizontalMorph_h
+
+#include <vector>
+
+//_________________________________________________
+/*
+ * Horizontal (cumulative distribution) interpolation between two binned templates, as described in
+ * Read, A. L., "Linear Interpolation of Histograms", NIM A 425 (1999) 357-360.
+ *
+ * init() precomputes, once for each pair of templates, the inverse-cdf table: the positions (x1, x2) at
+ * which the two cumulative distributions reach each of their common levels y, and for each edge of the
+ * output binning the reference width used in the treatment of empty bins. morph() then only has to take
+ * the weighted average of the two positions, project the resulting cdf onto the output edges with a
+ * single monotonic walk and differentiate it, in buffers allocated by init().
+ *
+ * The two conventions reproduce the projection of CMSHistFunc (integral morphing) and of th1fmorph,
+ * which differ in the treatment of empty bins.
+ */
+class HorizontalMorph {
+    public:
+        enum Convention { HistFunc, Th1fMorph };
+
+        HorizontalMorph() : convention_(HistFunc), nbn_(0) {}
+
+        /// cdf1 (cdf2) are the cumulative distributions, normalised to one, at the nb1+1 (nb2+1) edges1 (edges2)
+        /// of the two templates; the morphed template has the nbn bins delimited by the nbn+1 outEdges
+        void init(int nb1, const double *edges1, const double *cdf1,
+                  int nb2, const double *edges2, const double *cdf2,
+                  int nbn, const double *outEdges, Convention convention = HistFunc) ;
+        bool ready() const { return !y_.empty(); }
+        void clear() ;
+
+        /// morphed template for weights wt1 and wt2 of the two inputs, in nbins() elements of out:
+        /// the fraction of the total in each bin, or the density (fraction / width) if density is true
+        void morph(double wt1, double wt2, double *out, bool density = false) const ;
+
+        unsigned int nbins() const { return nbn_; }
+        /// number of levels of the inverse-cdf table
+        unsigned int levels() const { return y_.size(); }
+
+        /// weights of the two templates at parameters par1 and par2 to interpolate to parinterp;
+        /// returns false if this is an extrapolation
+        static bool weights(double par1, double par2, double parinterp, double &wt1, double &wt2) ;
+
+        /// cdf[0..nb] of the nb bin contents, normalised to one; returns the sum of the contents
+        template<typename T> static double cumulative(int nb, const T *contents, double *cdf) {
+            double total = 0;
+            for (int i = 0; i < nb; ++i) total += contents[i];
+            cdf[0] = 0;
+            for (int i = 0; i < nb; ++i) cdf[i+1] = contents[i]/total + cdf[i];
+            return total;
+        }
+
+    private:
+        Convention convention_;
+        int nbn_;
+        std::vector<double> edges_;   // output edges
+        std::vector<double> widths_;  // output bin widths
+        std::vector<double> dx_;      // reference width at each output edge, for the empty bin treatment
+        std::vector<double> x1_, x2_, y_;  // inverse-cdf table
+        mutable std::vector<double> xdisn_, sigdisf_;  // morphed cdf, and projected onto the output edges
+};
+
+#endif
@@ -36,4 +36,45 @@ class QuantileCalculator {
          
 };
 
+/// Streaming, mergeable estimate of the quantiles of a weighted distribution (merging t-digest).
+/// The memory used is proportional to the compression, independently of the number of entries,
+/// and the quantiles are most accurate in the tails. The entries are dealt in turn to a number of
+/// sections, so that the errors can be estimated by sectioning or jackknife as in QuantileCalculator.
+/// Sketches filled by different jobs can be merged, and stored as a vector of numbers.
+class QuantileSketch {
+    public:
+        QuantileSketch(double compression = 500, unsigned int sections = 5);
+        /// rebuild a sketch from the output of serialize()
+        explicit QuantileSketch(const std::vector<double> &serialized);
+
+        void add(double x, double w = 1.0) ;
+        /// add the entries of another sketch, with the same number of sections
+        void merge(const QuantileSketch &other) ;
+
+        double quantile(double quantile) const ;
+        std::pair<double,double> quantileAndError(double quantile, QuantileCalculator::Method method) const ;
+        double sumOfWeights() const ;
+        /// number of centroids kept, i.e. the size of the sketch
+        unsigned int size() const ;
+
+        std::vector<double> serialize() const ;
+    private:
+        struct Digest {
+            std::vector<std::pair<double,double> > centroids;  // (mean, weight), sorted by mean
+            std::vector<std::pair<double,double> > buffer;     // entries not yet merged into the centroids
+            double sumw = 0, min = 0, max = 0;
+            void add(double x, double w, double compression) ;
+            void absorb(const Digest &other, double compression) ;
+            void flush(double compression) ;
+            double quantile(double q) const ;
+        };
+        double compression_;
+        unsigned int next_;
+        // flushed before reading, so that the sketch can be queried from const methods
+        mutable std::vector<Digest> sections_;
+
+        void flush() const ;
+        Digest mergedExcept(int skip) const ;
+};
+
 #endif
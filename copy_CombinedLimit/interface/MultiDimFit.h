@@ -69,6 +69,7 @@ protected:
   static std::string robustHesseSave_;
 
   static int pointsRandProf_;
+  static int pointsRandProfWorkers_;
   static std::string setParameterRandomInitialValueRanges_;
   static int randPointsSeed_;
 
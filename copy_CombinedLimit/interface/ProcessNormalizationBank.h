@@ -0,0 +1,60 @@
+#ifndef HiggsAnalysis_CombinedLimit_ProcessNormalizationBank_h
+#define HiggsAnalysis_CombinedLimit_ProcessNormalizationBank_h
+
+#include <unordered_map>
+#include <vector>
+#include <RooAbsReal.h>
+#include "SimpleCacheSentry.h"
+
+class ProcessNormalization;
+
+//_________________________________________________
+/*
+ * Evaluates many ProcessNormalization objects together, e.g. all the process yields of one channel.
+ * The nuisances and other factors are gathered once per evaluation even when they are shared by
+ * many processes, and the log-normal terms are stored as a sparse (CSR) matrix of logKappa values.
+ * When some inputs change, only the normalizations that depend on them are recomputed.
+ * The values are the same as those of ProcessNormalization::getVal().
+ */
+class ProcessNormalizationBank {
+    public:
+        ProcessNormalizationBank() ;
+        ProcessNormalizationBank(const ProcessNormalizationBank &other) = delete;
+        ProcessNormalizationBank & operator=(const ProcessNormalizationBank &other) = delete;
+
+        /// add a normalization to the bank and return its index
+        unsigned int add(const ProcessNormalization &norm) ;
+        unsigned int size() const { return values_.size(); }
+        /// number of distinct nuisances and factors used by the normalizations
+        unsigned int inputs() const { return args_.size(); }
+
+        /// recompute the normalizations whose inputs have changed since the last call
+        void update() ;
+        double value(unsigned int i) const { return values_[i]; }
+
+    private:
+        unsigned int column(const RooAbsReal &arg) ;
+        void evaluateRow(unsigned int row) ;
+
+        // distinct inputs, their last value, and the rows using each of them (CSC)
+        std::vector<const RooAbsReal *> args_;
+        std::unordered_map<const RooAbsReal *, unsigned int> argIndex_;
+        std::vector<double> argVals_;
+        std::vector<std::vector<unsigned int>> argRows_;
+        SimpleCacheSentry sentry_;
+        bool first_;
+
+        // one row per normalization
+        std::vector<double> nominal_;
+        std::vector<unsigned int> symStart_, symCol_;
+        std::vector<double> symLogKappa_;
+        std::vector<unsigned int> asymStart_, asymCol_;
+        std::vector<double> asymLogKappaLo_, asymLogKappaHi_;
+        std::vector<unsigned int> otherStart_, otherCol_;
+
+        std::vector<double> values_;
+        std::vector<char> dirty_;
+        std::vector<unsigned int> dirtyRows_;
+};
+
+#endif
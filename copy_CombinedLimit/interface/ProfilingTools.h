@@ -1,5 +1,6 @@
 #ifndef HiggsAnalysis_CombinedLimit_ProfilingTools_
 #define HiggsAnalysis_CombinedLimit_ProfilingTools_
+#include <atomic>
 #include <string>
 
 bool setupIgProfDumpHook() ;
@@ -18,6 +19,43 @@ class PerfCounter {
         double value_ = 0.0;
 };
 
+/// Hierarchical profiler of scoped regions (fits, likelihood evaluations, ...).
+/// Each thread records into its own buffers: a call tree with the total time and number of calls
+/// of each region, and (up to a maximum number) the individual begin/end times of the regions.
+/// When not enabled, a scope costs a single relaxed atomic load.
+/// The names must outlive the profiler: string literals, or strings returned by intern().
+/// The write functions should be called when no other thread is inside a profiled scope.
+namespace profiler {
+    extern std::atomic<bool> enabled_;
+    inline bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+    /// start (or stop) recording; at most maxTraceEvents regions per thread are kept for the trace
+    void enable(bool on = true, unsigned long maxTraceEvents = 2000000) ;
+    /// return a copy of name with the lifetime of the program
+    const char * intern(const std::string &name) ;
+    void begin(const char *name) ;
+    void end() ;
+    /// trace-event JSON, for chrome://tracing or https://ui.perfetto.dev
+    bool writeChromeTrace(const std::string &fileName) ;
+    /// one line per call stack with its self time in microseconds, for flamegraph.pl
+    bool writeFoldedStacks(const std::string &fileName) ;
+    /// keep a value that is computed only to be timed, so that the compiler can't drop its computation
+    inline void doNotOptimize(double value) { static volatile double sink; sink = value; }
+
+    class Scope {
+        public:
+            explicit Scope(const char *name) : active_(enabled()) { if (active_) begin(name); }
+            ~Scope() { if (active_) end(); }
+            Scope(const Scope &) = delete;
+            Scope & operator=(const Scope &) = delete;
+        private:
+            bool active_;
+    };
+}
+#define PROFILE_SCOPE_CAT_(a, b) a##b
+#define PROFILE_SCOPE_CAT(a, b) PROFILE_SCOPE_CAT_(a, b)
+/// profile the rest of the enclosing block as a region called name
+#define PROFILE_SCOPE(name) profiler::Scope PROFILE_SCOPE_CAT(profilerScope_, __LINE__)(name)
+
 namespace runtimedef {
     // get the flag. name MUST BE a compile-time string
     int  get(const char *name);
@@ -6,6 +6,7 @@
 
 #include <vector>
 #include <string>
+#include <functional>
 #include "RooRealVar.h"
 #include "RooAbsReal.h"
 #include "RooArgSet.h"
@@ -31,13 +32,29 @@ class RandStartPt {
       std::vector<RooCategory*> &specifiedcat_; 
       std::vector<int> &specifiedcatvals_;
       unsigned int nOtherFloatingPOI_;
+      int numworkers_;
+      /// outcome of the minimisation from one start point, when it was done by a forked worker
+      struct StartResult {
+          bool done = false;     // if false, the start point is minimised in this process as usual
+          bool ok = false;
+          bool aborted = false;  // stopped after the pre-fit, as already too far from the best start: committed unminimised
+          double nll = 0;
+          std::vector<double> vals;
+      };
+      std::vector<StartResult> startResults_;
+      StartResult minimizeOneStart(unsigned int startptIdx, const std::function<void(unsigned int)> &setStart, RooArgSet &param, double nll_init, bool hasBest, double bestNll, CascadeMinimizer &minimObj);
   public:
-      RandStartPt(RooAbsReal& nll, std::vector<RooRealVar* > &specifiedvars, std::vector<float> &specifiedvals, bool skipdefaultstart, std::string parameterRandInitialValranges, int numrandpts, int verbose, bool fastscan, bool hasmaxdeltaNLLforprof, float maxdeltaNLLforprof, std::vector<std::string> &specifiednuis, std::vector<std::string> &specifiedfuncnames, std::vector<RooAbsReal*> &specifiedfunc, std::vector<float> &specifiedfuncvals, std::vector<std::string> &specifiedcatnames, std::vector<RooCategory*> &specifiedcat, std::vector<int> &specifiedcatvals, unsigned int nOtherFloatingPOI);
+      RandStartPt(RooAbsReal& nll, std::vector<RooRealVar* > &specifiedvars, std::vector<float> &specifiedvals, bool skipdefaultstart, std::string parameterRandInitialValranges, int numrandpts, int verbose, bool fastscan, bool hasmaxdeltaNLLforprof, float maxdeltaNLLforprof, std::vector<std::string> &specifiednuis, std::vector<std::string> &specifiedfuncnames, std::vector<RooAbsReal*> &specifiedfunc, std::vector<float> &specifiedfuncvals, std::vector<std::string> &specifiedcatnames, std::vector<RooCategory*> &specifiedcat, std::vector<int> &specifiedcatvals, unsigned int nOtherFloatingPOI, int numworkers = 1);
       std::map<std::string, std::vector<float>> getRangesDictFromInString(std::string params_ranges_string_in);
       std::vector<std::vector<float>> vectorOfPointsToTry ();
       void commitBestNLLVal(unsigned int idx, float &nllVal, double &probVal);
       void setProfPOIvalues(unsigned int startptIdx, std::vector<std::vector<float>> &nested_vector_of_wc_vals);
       void setValSpecifiedObjs();
+      /// Minimise from the start points in forked workers, each with its own copy of the model, numworkers at a time.
+      /// setStart(i) must bring the parameters to start point i. The results are then used by minimizeStart.
+      void minimizeStartsInParallel(unsigned int nstarts, const std::function<void(unsigned int)> &setStart, RooArgSet &param, double nll_init, CascadeMinimizer &minimObj);
+      /// Minimise from start point startptIdx (already set), or take the result of the parallel minimisation if there is one
+      bool minimizeStart(unsigned int startptIdx, RooArgSet &param, CascadeMinimizer &minimObj);
       void doRandomStartPt1DGridScan(double &xval, unsigned int poiSize, std::vector<float> &poival, std::vector<RooRealVar* > &poivars, std::unique_ptr <RooArgSet> &param, RooArgSet &snap, float &deltaNLL, double &nll_init, CascadeMinimizer &minimObj);
       void doRandomStartPt2DGridScan(double &xval, double &yval, unsigned int poiSize, std::vector<float> &poival, std::vector<RooRealVar* > &poivars, std::unique_ptr <RooArgSet> &param, RooArgSet &snap, float &deltaNLL, double &nll_init, MultiDimFit::GridType gridType, double deltaX, double deltaY, CascadeMinimizer &minimObj);
 
@@ -0,0 +1,105 @@
+#ifndef HiggsAnalysis_CombinedLimit_ResultStore_h
+#define HiggsAnalysis_CombinedLimit_ResultStore_h
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//_________________________________________________
+/*
+ * Columnar, append-only store for the points of the output tree.
+ *
+ * A file is a sequence of self-contained chunks, each holding a fixed number of rows of a fixed
+ * set of columns, all 8-byte aligned (native byte order):
+ *    header: magic "CMBRSLT1", uint64 size of the chunk in bytes, uint64 rows,
+ *            uint32 columns, uint32 size of the schema in bytes,
+ *            schema: for each column, a type code (as in TTree leaflists: D F I i L l O),
+ *                    an unused byte, uint16 length of the name and the name; padded to 8 bytes
+ *    data:   for each column, rows values of its type; padded to 8 bytes
+ *    footer: uint64 offset of each column from the start of the chunk, uint64 size of the chunk,
+ *            magic "CMBRSLTE"
+ * Since chunks don't refer to anything outside themselves, the outputs of several jobs can be
+ * merged by concatenating the files (e.g. with cat). A chunk that was only partially written
+ * (e.g. by a job that crashed) is at the end of its file: the reader skips it, and continues
+ * from the header of the next chunk, if any (e.g. from the next file that was concatenated).
+ * The python module HiggsAnalysis.CombinedLimit.ResultStore reads the same format with numpy.
+ */
+class ResultStoreWriter {
+    public:
+        /// truncates the file; rows are written in chunks of up to chunkRows rows
+        explicit ResultStoreWriter(const std::string &file, unsigned int chunkRows = 4096) ;
+        ~ResultStoreWriter() ;
+
+        /// add a column read from address at each fill(); type is a leaflist type code.
+        /// Adding columns after rows have been filled starts a new chunk with the new schema.
+        void addColumn(const std::string &name, char type, const void *address) ;
+        /// remove all the columns (rows already filled are kept)
+        void clearColumns() ;
+        unsigned int columns() const { return columns_.size(); }
+        /// append one row with the current values at the column addresses
+        void fill() ;
+        /// write the rows filled so far as a chunk
+        void flush() ;
+        /// flush and close the file; returns false if any write failed
+        bool close() ;
+
+        /// size in bytes of a value of this type, or 0 if the type is not supported
+        static unsigned int typeSize(char type) ;
+    private:
+        struct Column {
+            std::string name;
+            char type;
+            const void *address;
+            std::vector<char> data;
+        };
+        std::string file_;
+        FILE *out_;
+        unsigned int chunkRows_, rows_;
+        bool good_;
+        std::vector<Column> columns_;
+};
+
+class ResultStoreReader {
+    public:
+        /// maps the file in memory; throws std::runtime_error if it can't be read or is not in this format
+        explicit ResultStoreReader(const std::string &file) ;
+        ~ResultStoreReader() ;
+        ResultStoreReader(const ResultStoreReader &other) = delete;
+        ResultStoreReader &operator=(const ResultStoreReader &other) = delete;
+
+        /// the values of one column in one chunk, pointing directly into the mapped file
+        struct Column {
+            char type;
+            uint64_t size;
+            const void *data;
+            /// value of row i, converted to double
+            double operator[](uint64_t i) const ;
+        };
+
+        unsigned int chunks() const { return chunks_.size(); }
+        uint64_t rows(unsigned int chunk) const { return chunks_[chunk].rows; }
+        /// total number of rows in all the chunks
+        uint64_t entries() const ;
+        /// names of the columns of a chunk (chunks of different jobs may have different columns)
+        std::vector<std::string> columnNames(unsigned int chunk) const ;
+        /// the column of a chunk; size is 0 and data is null if the chunk has no such column
+        Column column(unsigned int chunk, const std::string &name) const ;
+        /// the values of a column in all the chunks that have it, converted to double
+        std::vector<double> values(const std::string &name) const ;
+        /// true if the file has incomplete or corrupted chunks, which were skipped
+        bool truncated() const { return truncated_; }
+    private:
+        struct Chunk {
+            uint64_t rows;
+            std::vector<std::string> names;
+            std::vector<char> types;
+            std::vector<const char *> data;
+        };
+        const char *base_;
+        size_t size_;
+        bool truncated_;
+        std::vector<Chunk> chunks_;
+};
+
+#endif
@@ -12,6 +12,8 @@ class RooAbsReal;
 #include "Riostream.h"
 #include "TMath.h"
 #include <TH1.h>
+#include <vector>
+#include "SimpleCacheSentry.h"
 
 //---------------------------------------------------------------------------
 class RooParametricShapeBinPdf : public RooAbsPdf
@@ -49,6 +51,19 @@ protected:
    Double_t xMin;        // X min
 
    Double_t evaluate() const override;
+
+   // integrals of the pdf in each bin, recomputed only when its parameters change
+   mutable SimpleCacheSentry sentry; //! not to be serialized
+   mutable std::vector<Double_t> binIntegrals; //! not to be serialized
+   mutable bool cacheInit = false; //! not to be serialized
+
+   /// index of the bin containing xval, or -1 if it is outside of the bins
+   Int_t findBin(Double_t xval) const;
+   /// make sure that x has the named range of each bin, used by the bin integrals
+   void checkRanges() const;
+   /// fill binIntegrals if the parameters changed, with the analytic integrals of the pdf if it has them,
+   /// or else with a Gauss-Legendre rule in each bin
+   void updateCache() const;
 private:
    RooPlot* plotOn(RooPlot* frame, 
               const RooCmdArg& arg1=RooCmdArg::none(), const RooCmdArg& arg2=RooCmdArg::none(),
@@ -4,6 +4,7 @@
 #include "RooAbsPdf.h"
 #include "RooListProxy.h"
 #include "TVectorD.h"
+#include "SimpleCacheSentry.h"
 
 class RooRealVar;
 // class RooFitResult;
@@ -27,6 +28,9 @@ class RooTaylorExpansion : public RooAbsReal {
   void printMultiline(std::ostream& os, Int_t contents,
                                    Bool_t verbose, TString indent) const override;
 
+  /// analytic first derivatives with respect to each of the x, in the same order
+  void gradient(std::vector<double>& grad) const;
+
  protected:
 
   RooListProxy _x;
@@ -37,6 +41,23 @@ class RooTaylorExpansion : public RooAbsReal {
   Double_t evaluate() const override;
 
  private:
+  // The terms with the same indices in any order are merged, and the index lists are stored as a prefix
+  // tree with the parents before their children, so that the expansion is evaluated as
+  // value(node) = coef(node) + sum_children dx[index(child)] * value(child), sharing the common factors.
+  mutable std::vector<int> _nodeIndex;       //! not to be serialized
+  mutable std::vector<unsigned> _nodeParent; //! not to be serialized
+  mutable std::vector<double> _nodeCoef;     //! not to be serialized
+  mutable std::vector<double> _nodeValue;    //! not to be serialized
+  mutable std::vector<double> _nodeAdjoint;  //! not to be serialized
+  mutable std::vector<double> _dx;           //! not to be serialized
+  mutable std::vector<double> _grad;         //! not to be serialized
+  mutable bool _init = false;                //! not to be serialized
+  mutable bool _gradGood = false;            //! not to be serialized
+  mutable SimpleCacheSentry _sentry;         //! not to be serialized
+
+  void compile() const;
+  void sync() const;
+
   ClassDefOverride(RooTaylorExpansion,
            1)  // Multivariate Gaussian PDF with correlations
 };
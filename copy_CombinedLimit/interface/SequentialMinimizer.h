@@ -9,11 +9,33 @@ struct RooRealVar;
 
 namespace cmsmath {
 
+    /// Optional description of the function minimized by the SequentialMinimizer as a sum of terms,
+    /// each of which depends only on some of the parameters (e.g. the channels and constraints of a likelihood).
+    /// When one is set, each parameter is minimized evaluating only the terms that depend on it.
+    class SeparableFunction {
+        public:
+            SeparableFunction() ;
+            virtual ~SeparableFunction() ;
+            /// fill, for each of the named parameters, the indices of the terms that depend on it; return false if not known
+            virtual bool terms(const std::vector<std::string> &params, std::vector<std::vector<unsigned int> > &terms) = 0;
+            /// set parameter ipar (index in the list given to terms()) to x
+            virtual void set(unsigned int ipar, double x) = 0;
+            /// sum of the given terms at the current values of the parameters
+            virtual double evalTerms(const std::vector<unsigned int> &terms) = 0;
+            /// number to give as the integer extra option "SeparableFunction" of the minimizer options, to use this
+            /// function in a SequentialMinimizer that is not created directly (e.g. by RooMinimizer)
+            int id() const { return id_; }
+            /// the existing function with this id, or nullptr
+            static SeparableFunction *find(int id) ;
+        private:
+            int id_;
+    };
+
     /// Basic struct to call a function
     struct MinimizerContext {
         MinimizerContext(const ROOT::Math::IMultiGenFunction *function) : func(function), x(func->NDim()) {}
         // convenience methods
-        double eval() const { nCalls++; return (*func)(&x[0]); }
+        double eval() const { nCalls++; return terms ? evalTerms() : (*func)(&x[0]); }
         double setAndEval(unsigned int i, double xi) const { x[i] = xi; return eval(); }
         double cleanEval(unsigned int i, double xi) const { double x0 = x[i]; x[i] = xi; double y = eval(); x[i] = x0; return y; }
         // data, fixed
@@ -21,6 +43,12 @@ namespace cmsmath {
         // data, mutable
         mutable std::vector<double> x;
         mutable unsigned int nCalls = 0;
+        // if terms is set, eval() computes only these terms, which are all those that depend on x[termsIdx]:
+        // it is then equal to the full function up to a constant, as long as only x[termsIdx] is changed
+        SeparableFunction *separable = nullptr;
+        const std::vector<unsigned int> *terms = nullptr;
+        unsigned int termsIdx = 0, termsPar = 0;
+        double evalTerms() const { separable->set(termsPar, x[termsIdx]); return separable->evalTerms(*terms); }
     };
 
     class OneDimMinimizer {
@@ -128,6 +156,10 @@ namespace cmsmath {
             /// method to perform the minimization
              bool Minimize() override ; 
 
+            /// use this description of the function in the next minimizations (nullptr to stop using it);
+            /// an extra option "SeparableFunction" in the options replaces it, see SeparableFunction::id()
+            void setSeparableFunction(SeparableFunction *separable) { separable_ = separable; }
+
             /// return minimum function value
             double MinValue() const override { return minValue_;  }
 
@@ -170,6 +202,11 @@ namespace cmsmath {
             bool improve(int smallsteps=5);
             bool doFullMinim(); 
 
+            /// find the terms of the separable function that depend on each worker
+            void setupTerms();
+            /// improve one worker, evaluating only the terms that depend on it if possible
+            OneDimMinimizer::ImproveRet improveWorker(Worker &w, int steps, double ytol, bool force=true);
+
             std::unique_ptr<MinimizerContext> func_;
             unsigned int nDim_, nFree_;
 
@@ -181,6 +218,11 @@ namespace cmsmath {
             std::vector<Worker> workers_;
             State state_;
 
+            // for each worker the terms that depend on it and its index for the separable function
+            SeparableFunction *separable_ = nullptr;
+            std::vector<std::vector<unsigned int> > workerTerms_;
+            std::vector<unsigned int> workerPar_;
+
             // ROOT::Math::Minimizer for strategy 2
             std::unique_ptr<ROOT::Math::Minimizer> fullMinimizer_;
             std::vector<int> subspaceIndices_;
@@ -28,6 +28,8 @@ namespace toymcoptutils {
             bool        keepHistoSpec_ = false;
             RooRealVar *weightVar_ = nullptr;
             RooDataSet *generateWithHisto(RooRealVar *&weightVar, bool asimov, double weightScale = 1.0, int verbose = 0) ;
+            /// Asimov dataset of a binned channel made of a single CMSHistSum, from its cache; null if the channel is not one
+            RooDataSet *generateAsimovFromCache(RooRealVar *&weightVar, double weightScale, int verbose) ;
             RooDataSet *generateCountingAsimov() ;
             void setToExpected(RooProdPdf &prod, RooArgSet &obs) ;
             void setToExpected(RooPoisson &pois, RooArgSet &obs) ;
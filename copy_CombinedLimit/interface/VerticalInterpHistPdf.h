@@ -286,6 +286,13 @@ protected:
   // Coefficients of the list in _coefList, already dynamic_cast'ed and in a vector
   mutable std::vector<const RooAbsReal *> _morphParams; //! not to be serialized
 
+  // The same diff and sum templates packed in one contiguous matrix, in blocks of bins (see syncTotal)
+  mutable std::vector<FastTemplate::T> _morphMatrix; //! not to be serialized
+  mutable unsigned int _morphMatrixBins = 0;         //! not to be serialized
+  // Interpolation weights of the morphs with a non-zero coefficient, and their index
+  mutable std::vector<FastTemplate::T> _morphWeights; //! not to be serialized
+  mutable std::vector<unsigned int> _morphActive;     //! not to be serialized
+
   // Prepare morphing data for a triplet of templates
   void initMorph(Morph &out, const FastTemplate &nominal, FastTemplate &lo, FastTemplate &hi) const;
 
@@ -293,6 +300,13 @@ protected:
   // Do not normalize yet, as that depends on the dimension of the template
   void syncTotal(FastTemplate &cache, const FastTemplate &cacheNominal, const FastTemplate &cacheNominalLog) const ;
 
+  // Apply all the morphs to cache in one pass over _morphMatrix (used by syncTotal)
+  void syncTotalMatrix(FastTemplate &cache) const ;
+  // (Re)build _morphMatrix for templates with nbins active bins
+  void packMorphMatrix(unsigned int nbins) const ;
+  // Drop _morphMatrix, to be called whenever the contents or the active size of _morphs change
+  void clearMorphMatrix() const { _morphMatrix.clear(); _morphMatrixBins = 0; }
+
   // return a smooth function that is equal to +/-1 for |x| >= smoothRegion_ and it's null in zero
   inline double smoothStepFunc(double x) const { 
     if (fabs(x) >= _smoothRegion) return x > 0 ? +1 : -1;
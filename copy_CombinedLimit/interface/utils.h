@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <functional>
 #include <TGraphAsymmErrors.h>
 #include <TString.h>
 #include <RooHistError.h>
@@ -47,6 +48,9 @@ namespace utils {
     /// Will return 0 if it's all constraints, &pdf if it's all observables, or a new pdf if it's something mixed
     /// In the last case, you're the owner of the returned pdf.
     RooAbsPdf *factorizePdf(const RooArgSet &observables, RooAbsPdf &pdf, RooArgList &constraints);
+    /// Same as above, but asking obsDependent whether each term that is neither a product nor a simultaneous pdf
+    /// depends on the observables, instead of calling dependsOn (e.g. to use the answers cached by a previous job)
+    RooAbsPdf *factorizePdf(const RooArgSet &observables, RooAbsPdf &pdf, RooArgList &constraints, const std::function<bool(const RooAbsPdf &)> &obsDependent);
 
     /// collect factors depending on observables in obsTerms, and all others in constraints
     void factorizePdf(RooStats::ModelConfig &model, RooAbsPdf &pdf, RooArgList &obsTerms, RooArgList &constraints, bool debug=false);
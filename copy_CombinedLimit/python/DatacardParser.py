@@ -270,6 +270,13 @@ def addDatacardParserOptions(parser):
         action="store_true",
         help="Try reduce the number of inputs by merging AsymPow instances into ProcessNormalization objects",
     )
+    parser.add_option(
+        "--X-bulk-channels",
+        dest="bulkChannels",
+        default=False,
+        action="store_true",
+        help="Build the channels that only have histogram templates, lnN and shape effects, rateParams and autoMCStats (with --use-histsum) in C++, importing each one in a single step",
+    )
     parser.add_option(
         "--X-optimizeMHDependency",
         dest="optimizeMHDependency",
@@ -907,6 +907,8 @@ class ModelBuilder(ModelBuilderBase):
                 if scale == 0:
                     self.doVar(f"n_exp_bin{b}_proc_{p}[{0:g}]")
                     continue
+                if self.isBulkChannel(b):
+                    continue  # made together with the rest of the channel in doIndividualModels
                 # collect multiplicative corrections
                 nominal = self.DC.exp[b][p]
                 gamma = None
@@ -1023,6 +1025,10 @@ class ModelBuilder(ModelBuilderBase):
                     else:
                         self.out.safe_import(procNorm)
 
+    def isBulkChannel(self, channel):
+        """True if the normalizations of this channel are made in doIndividualModels, together with its pdf"""
+        return False
+
     def doIndividualModels(self):
         """create pdf_bin<X> and pdf_bin<X>_bonly for each bin"""
         raise RuntimeError("Not implemented in ModelBuilder")
@@ -0,0 +1,101 @@
+"""Reader for the columnar result store written by combine --resultStore (see interface/ResultStore.h).
+
+    from HiggsAnalysis.CombinedLimit.ResultStore import ResultStore
+    store = ResultStore("toys.store")
+    limits = store["limit"]                     # all the chunks, concatenated in one array
+    for chunk in store.chunks():                # or chunk by chunk, without copying
+        print(chunk["quantileExpected"].mean())
+"""
+
+import mmap
+import struct
+
+import numpy as np
+
+HEADER_MAGIC = b"CMBRSLT1"
+FOOTER_MAGIC = b"CMBRSLTE"
+HEADER = struct.Struct("=8sQQII")
+DTYPES = {"D": np.float64, "F": np.float32, "I": np.int32, "i": np.uint32, "L": np.int64, "l": np.uint64, "O": np.bool_}
+
+
+class ResultStore:
+    def __init__(self, path):
+        """Map the file in memory and index its chunks. Incomplete or corrupted chunks (e.g. from a job that crashed,
+        followed by the chunks of another file concatenated to it) are skipped, and flagged in self.truncated."""
+        self.path = path
+        self.truncated = False
+        self._chunks = []
+        with open(path, "rb") as f:
+            size = f.seek(0, 2)
+            self._buffer = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) if size else b""
+        if size and self._buffer[: len(HEADER_MAGIC)] != HEADER_MAGIC[:size]:
+            raise RuntimeError("%s is not a result store, or is corrupted" % path)
+        pos = 0
+        while pos < size:
+            chunk = self._read_chunk(pos, size - pos)
+            if chunk is None:
+                # resume at the next header, if any
+                self.truncated = True
+                pos = self._buffer.find(HEADER_MAGIC, pos + 1)
+                if pos < 0:
+                    break
+                continue
+            chunk_size, rows, columns = chunk
+            self._chunks.append((rows, columns))
+            pos += chunk_size
+
+    def _read_chunk(self, pos, avail):
+        """Size, rows and columns of the chunk at pos, or None if it is incomplete or inconsistent"""
+        if avail < HEADER.size:
+            return None
+        magic, chunk_size, rows, ncol, schema_size = HEADER.unpack_from(self._buffer, pos)
+        data_start, footer_size = HEADER.size + schema_size, 8 * ncol + 16
+        if magic != HEADER_MAGIC or chunk_size < data_start + footer_size or chunk_size > avail or chunk_size % 8:
+            return None
+        if self._buffer[pos + chunk_size - 8 : pos + chunk_size] != FOOTER_MAGIC:
+            return None
+        if struct.unpack_from("=Q", self._buffer, pos + chunk_size - 16)[0] != chunk_size:
+            return None
+        data_end = chunk_size - footer_size
+        offsets = struct.unpack_from("=%dQ" % ncol, self._buffer, pos + data_end)
+        schema, schema_end = pos + HEADER.size, pos + data_start
+        columns = {}
+        for i in range(ncol):
+            if schema_end - schema < 4:
+                return None
+            code, _, length = struct.unpack_from("=ccH", self._buffer, schema)
+            dtype = DTYPES.get(code.decode("latin-1"))
+            if dtype is None or schema_end - schema - 4 < length:
+                return None
+            if offsets[i] < data_start or offsets[i] + rows * np.dtype(dtype).itemsize > data_end:
+                return None
+            name = bytes(self._buffer[schema + 4 : schema + 4 + length]).decode()
+            schema += 4 + length
+            columns[name] = (dtype, pos + offsets[i])
+        return chunk_size, rows, columns
+
+    def __len__(self):
+        return sum(rows for rows, _ in self._chunks)
+
+    def columns(self):
+        """Names of the columns, in the order in which they first appear"""
+        names = []
+        for _, columns in self._chunks:
+            names += [name for name in columns if name not in names]
+        return names
+
+    def chunks(self, columns=None):
+        """Yield one dict per chunk, mapping the column names to read-only numpy arrays that point into the file"""
+        for rows, chunk_columns in self._chunks:
+            yield {
+                name: np.frombuffer(self._buffer, dtype=dtype, count=rows, offset=offset)
+                for name, (dtype, offset) in chunk_columns.items()
+                if columns is None or name in columns
+            }
+
+    def __getitem__(self, name):
+        """All the values of a column, from the chunks that have it"""
+        arrays = [chunk[name] for chunk in self.chunks([name]) if name in chunk]
+        if not arrays:
+            raise KeyError(name)
+        return np.concatenate(arrays)
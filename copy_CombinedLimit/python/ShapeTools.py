@@ -72,6 +72,7 @@ class ShapeBuilder(ModelBuilder):
         self.extraImports = []
         self.norm_rename_map = {}
         self._fileCache = FileCache(self.options.baseDir)
+        self._bulkChannelCache = {}
 
     ## ------------------------------------------
     ## -------- ModelBuilder interface ----------
@@ -116,7 +117,12 @@ class ShapeBuilder(ModelBuilder):
             channelBinParFlag = b in list(self.DC.binParFlags.keys())
             if channelBinParFlag:
                 print("Channel %s will use autoMCStats with settings: event-threshold=%g, include-signal=%i, hist-mode=%i" % ((b,) + self.DC.binParFlags[b]))
+            bulk = self.isBulkChannel(b)
+            if bulk:
+                prop = self.doBulkChannel(b, pdfs, coeffs, bgpdfs, bgcoeffs, sigcoeffs, binconstraints, bbb_names)
             for p in self.DC.exp[b].keys():  # so that we get only self.DC.processes contributing to this bin
+                if bulk:
+                    break  # already made by doBulkChannel
                 if self.DC.exp[b][p] == 0:
                     continue
                 if self.physics.getYieldScale(b, p) == 0:
@@ -187,7 +193,9 @@ class ShapeBuilder(ModelBuilder):
             if self.options.verbose > 1:
                 print("Creating RooAddPdf {} with {} elements".format("pdf_bin" + b, coeffs.getSize()))
             if channelBinParFlag:
-                if self.options.useCMSHistSum:
+                if bulk:
+                    pass  # already in the workspace, with the autoMCStats constraints
+                elif self.options.useCMSHistSum:
                     prop = self.addObj(
                         ROOT.CMSHistSum,
                         "prop_bin%s" % b,
@@ -207,7 +215,7 @@ class ShapeBuilder(ModelBuilder):
                         coeffs,
                     )
                 prop.setAttribute("CachingPdf_Direct", True)
-                if self.DC.binParFlags[b][0] >= 0.0:
+                if not bulk and self.DC.binParFlags[b][0] >= 0.0:
                     bbb_args = prop.setupBinPars(self.DC.binParFlags[b][0])
                     for bidx in range(bbb_args.getSize()):
                         arg = bbb_args.at(bidx)
@@ -377,6 +385,129 @@ class ShapeBuilder(ModelBuilder):
             stderr.write("\b\b\b\bdone.\n")
             stderr.flush()
 
+    def isBulkChannel(self, channel):
+        """True if the channel is built with ChannelBuilder (--X-bulk-channels): only histogram templates,
+        lnN and shape effects and rateParams, with autoMCStats and --use-histsum"""
+        if channel in self._bulkChannelCache:
+            return self._bulkChannelCache[channel]
+        ok = self.options.bulkChannels and self.options.bin and self.options.useCMSHistSum and self.options.useHistPdf == "never"
+        ok = ok and channel in self.DC.binParFlags and channel not in self.selfNormBins and not self.DC.systematicsParamMap
+        if ok:
+            for p in self.DC.exp[channel].keys():
+                if self.DC.exp[channel][p] == 0:
+                    continue
+                scale = self.physics.getYieldScale(channel, p)
+                if scale == 0:
+                    continue
+                shape = self.getShape(channel, p)
+                if type(scale) != str and scale != 1 or shape == None or not shape.InheritsFrom("TH1"):
+                    ok = False
+                    break
+                for syst, nofloat, pdf, args, errline in self.DC.systs:
+                    if p not in errline[channel] or errline[channel][p] == 0:
+                        continue
+                    if pdf not in ("lnN", "lnU", "param", "constr", "rateParam", "flatParam") and not pdf.startswith("shape"):
+                        ok = False
+                        break
+                if not ok:
+                    break
+        self._bulkChannelCache[channel] = ok
+        return ok
+
+    def doBulkChannel(self, b, pdfs, coeffs, bgpdfs, bgcoeffs, sigcoeffs, binconstraints, bbb_names):
+        """Make the templates, normalizations, CMSHistSum and autoMCStats constraints of channel b in one go
+        with ChannelBuilder, and fill the lists as doIndividualModels does; returns the CMSHistSum"""
+        threshold, includeSignal, histMode = self.DC.binParFlags[b]
+        builder = ROOT.ChannelBuilder(
+            self.out,
+            b,
+            "prop_bin%s" % b,
+            self.out.var(self.TH1Observables[b]),
+            self.out.maxbins,
+            self.options.optimizeTemplateBins,
+        )
+        builder.setAutoMCStats(threshold, includeSignal, histMode, not self.options.noOptimizePdf, self.options.optimizeBoundNuisances)
+        procs = []
+        for p in self.DC.exp[b].keys():
+            if self.DC.exp[b][p] == 0:
+                continue
+            scale = self.physics.getYieldScale(b, p)
+            if scale == 0:
+                continue
+            postFix = "Sig" if self.DC.isSignal[p] else "Bkg"
+            shapeNominal = self.getShape(b, p)
+            # same choices as getPdf and doExpectedEvents
+            shapeAlgo = None
+            morphs, logNorms, alogNorms = [], [], []
+            for syst, nofloat, pdf, args, errline in self.DC.systs:
+                if p not in errline[b] or errline[b][p] == 0:
+                    continue
+                if pdf.startswith("shape"):
+                    allowNoSyst = pdf[-1] == "?"
+                    algo = pdf.replace("?", "")
+                    if algo[-1] == "U":
+                        algo = algo[:-1]
+                    if shapeAlgo == None:
+                        shapeAlgo = algo
+                    elif algo != shapeAlgo:
+                        errmsg = f"ERROR for channel {b}, process {p}. "
+                        errmsg += f"Requesting morphing {algo}  for systematic {syst} after having requested {shapeAlgo}. "
+                        raise RuntimeError(errmsg + " One can use only one morphing algorithm for a given shape")
+                    if not allowNoSyst or self.isShapeSystematic(b, p, syst):
+                        systShapeName = self.DC.systematicsShapeMap.get((syst, b, p), syst)
+                        morphs.append((syst, errline[b][p], self.getShape(b, p, systShapeName + "Up"), self.getShape(b, p, systShapeName + "Down")))
+                        continue
+                    pdf = "lnN"  # a lnN in disguise
+                if pdf == "lnN" or pdf == "lnU":
+                    if type(errline[b][p]) == list:
+                        alogNorms.append((errline[b][p][0], errline[b][p][1], syst))
+                    elif not (pdf == "lnN" and errline[b][p] == 1.0):
+                        logNorms.append((errline[b][p], syst))
+            if morphs:
+                if shapeAlgo[-1] == "*":
+                    shapeAlgo = shapeAlgo[:-1]
+                if shapeAlgo == "shape":
+                    shapeAlgo = self.options.defMorph
+                if "shapeL" in shapeAlgo:
+                    raise RuntimeError("No algorithm shapeL - this mode is deprecated")
+                funcName = f"shape{postFix}_{b}_{p}_morph"
+            else:
+                funcName = shapeNominal.GetName() + "_rebinPdf"
+            normName = f"n_exp_final_bin{b}_proc_{p}"
+            builder.addProcess(p, funcName, normName, self.DC.isSignal[p], self.DC.exp[b][p], shapeNominal, "shapeN" in (shapeAlgo or ""))
+            for syst, scale_syst, shapeUp, shapeDown in morphs:
+                if not shapeUp.InheritsFrom("TH1") or not shapeDown.InheritsFrom("TH1"):
+                    raise RuntimeError(f"Mismatched shape types for channel {b}, process {p}, syst {syst}")
+                builder.addShape(p, syst, scale_syst, shapeUp, shapeDown)
+            for kappa, syst in logNorms:
+                builder.addLogNormal(p, kappa, syst)
+            for kappaLo, kappaHi, syst in alogNorms:
+                builder.addAsymmLogNormal(p, kappaLo, kappaHi, syst)
+            if type(scale) == str:
+                builder.addFactor(p, scale)
+            for rk in self.DC.rateParams.get(f"{b}AND{p}", []):
+                if not self.out.arg(rk[0][0]):
+                    raise RuntimeError("No rate parameter found %s, are you sure you defined it correctly in the datacard?" % (rk[0][0]))
+                builder.addFactor(p, rk[0][0])
+            procs.append((p, funcName, normName))
+        builder.build()
+        for p, funcName, normName in procs:
+            pdf, coeff = self.out.function(funcName), self.out.arg(normName)
+            pdfs.add(pdf)
+            coeffs.add(coeff)
+            if not self.DC.isSignal[p]:
+                bgpdfs.add(pdf)
+                bgcoeffs.add(coeff)
+            else:
+                sigcoeffs.append(coeff)
+        for n in builder.binParameters():
+            bbb_names.append(n)
+            parname = n[:-5] if n.endswith("_prod") else n
+            binconstraints.add(self.out.pdf("%s_Pdf" % n))
+            self.extraNuisances.append(self.out.var(parname))
+            self.extraGlobalObservables.append(self.out.var("%s_In" % n))
+        return self.out.function("prop_bin%s" % b)
+
     def doCombination(self):
         ## Contrary to Number-counting models, here each channel PDF already contains the nuisances
         ## So we just have to build the combined pdf
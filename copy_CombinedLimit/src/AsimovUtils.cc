@@ -1,12 +1,22 @@
 #include "../interface/AsimovUtils.h"
 
+#include <cstdio>
+#include <cstring>
 #include <memory>
 #include <stdexcept>
+#include <unistd.h>
+#include <RooAbsCategory.h>
 #include <RooAbsData.h>
 #include <RooArgSet.h>
 #include <RooProdPdf.h>
+#include <RooRealVar.h>
 #include <RooUniform.h>
+#include <TFile.h>
+#include <TMD5.h>
+#include <TSystem.h>
+#include <Math/MinimizerOptions.h>
 #include "../interface/utils.h"
+#include "../interface/ProfilingTools.h"
 #include "../interface/Combine.h"
 #include "../interface/ToyMCSamplerOpt.h"
 #include "../interface/CloseCoutSentry.h"
@@ -14,7 +24,8 @@
 #include "../interface/CombineLogger.h"
 
 
-RooAbsData *asimovutils::asimovDatasetNominal(RooStats::ModelConfig *mc, double poiValue, int verbose) {
+namespace {
+RooAbsData *makeAsimovNominal(RooStats::ModelConfig *mc, double poiValue, int verbose) {
         RooArgSet  poi(*mc->GetParametersOfInterest());
         RooRealVar *r = dynamic_cast<RooRealVar *>(poi.first());
         r->setConstant(true); r->setVal(poiValue);
@@ -35,7 +46,7 @@ RooAbsData *asimovutils::asimovDatasetNominal(RooStats::ModelConfig *mc, double
         return asimov;
 }
 
-RooAbsData *asimovutils::asimovDatasetWithFit(RooStats::ModelConfig *mc, RooAbsData &realdata, RooAbsCollection &snapshot, bool needsFit, double poiValue, int verbose) {
+RooAbsData *makeAsimovWithFit(RooStats::ModelConfig *mc, RooAbsData &realdata, RooAbsCollection &snapshot, bool needsFit, double poiValue, int verbose) {
         RooArgSet  poi(*mc->GetParametersOfInterest());
         RooRealVar *r = dynamic_cast<RooRealVar *>(poi.first());
         r->setConstant(true); r->setVal(poiValue);
@@ -175,3 +186,148 @@ RooAbsData *asimovutils::asimovDatasetWithFit(RooStats::ModelConfig *mc, RooAbsD
 
         return asimov;
 }
+}
+
+namespace {
+    struct CachedAsimov {
+        std::unique_ptr<RooAbsData> data;
+        std::unique_ptr<RooArgSet> params;  // all the parameters of the model after the call
+        std::unique_ptr<RooArgSet> gobs;    // global observables for the asimov dataset, if any
+    };
+    // only the last result is kept in memory, so that it does not grow with the number of toys; the older ones
+    // are only found again in the cache directory
+    std::string cachedKey_;
+    CachedAsimov cached_;
+    std::string cacheDir_;
+
+    void hashString(TMD5 &md5, const char *str) { md5.Update((const UChar_t *) str, strlen(str) + 1); }
+    void hashValue(TMD5 &md5, double val) { md5.Update((const UChar_t *) &val, sizeof(double)); }
+    void hashArg(TMD5 &md5, const RooAbsArg &arg) {
+        hashString(md5, arg.GetName());
+        if (const RooAbsReal *rar = dynamic_cast<const RooAbsReal *>(&arg)) hashValue(md5, rar->getVal());
+        else if (const RooAbsCategory *cat = dynamic_cast<const RooAbsCategory *>(&arg)) hashValue(md5, cat->getCurrentIndex());
+        hashValue(md5, arg.isConstant());
+        if (const RooRealVar *rrv = dynamic_cast<const RooRealVar *>(&arg)) {
+            hashValue(md5, rrv->getMin()); hashValue(md5, rrv->getMax()); hashValue(md5, rrv->getBins());
+        }
+    }
+
+    /// hash of everything the result depends on: the structure of the model, the values and ranges of all its parameters,
+    /// the POI value, the fitted data and the settings of the minimizer and of the generation
+    std::string cacheKey(RooStats::ModelConfig *mc, RooAbsData *realdata, bool needsFit, double poiValue) {
+        TMD5 md5;
+        hashString(md5, realdata ? (needsFit ? "fit" : "nofit") : "nominal");
+        hashValue(md5, poiValue);
+        RooAbsPdf *pdf = mc->GetPdf();
+        RooArgSet nodes;
+        pdf->branchNodeServerList(&nodes);
+        for (RooAbsArg *a : nodes) { hashString(md5, a->ClassName()); hashString(md5, a->GetName()); }
+        for (RooAbsArg *a : *mc->GetObservables()) hashArg(md5, *a);
+        std::unique_ptr<RooArgSet> params(pdf->getParameters(*mc->GetObservables()));
+        for (RooAbsArg *a : *params) hashArg(md5, *a);
+        if (realdata) {
+            hashValue(md5, realdata->numEntries());
+            for (int i = 0, n = realdata->numEntries(); i < n; ++i) {
+                for (RooAbsArg *a : *realdata->get(i)) hashArg(md5, *a);
+                hashValue(md5, realdata->weight());
+            }
+            hashString(md5, ROOT::Math::MinimizerOptions::DefaultMinimizerType().c_str());
+            hashString(md5, ROOT::Math::MinimizerOptions::DefaultMinimizerAlgo().c_str());
+            hashValue(md5, ROOT::Math::MinimizerOptions::DefaultTolerance());
+            hashValue(md5, ROOT::Math::MinimizerOptions::DefaultStrategy());
+            hashString(md5, CascadeMinimizer::optionsString().c_str());
+        }
+        for (const char *flag : { "TMCSO_PseudoAsimov", "TMCSO_AdaptivePseudoAsimov", "TMCSO_ASIMOV_FROM_CACHE" }) hashValue(md5, runtimedef::get(flag));
+        md5.Final();
+        return md5.AsString();
+    }
+
+    std::string cacheFile(const std::string &key) { return cacheDir_ + "/asimov_" + key + ".root"; }
+
+    /// the cached result for this key, from memory or from the cache directory, or null
+    const CachedAsimov *findCached(const std::string &key) {
+        if (!cachedKey_.empty() && key == cachedKey_) return &cached_;
+        if (cacheDir_.empty() || gSystem->AccessPathName(cacheFile(key).c_str())) return 0; // AccessPathName is true if the file is not there
+        TDirectory *pwd = gDirectory;
+        std::unique_ptr<TFile> file(TFile::Open(cacheFile(key).c_str()));
+        pwd->cd();
+        if (!file || file->IsZombie()) return 0;
+        CachedAsimov read;
+        read.data.reset(dynamic_cast<RooAbsData *>(file->Get("asimov")));
+        read.params.reset(dynamic_cast<RooArgSet *>(file->Get("params")));
+        read.gobs.reset(dynamic_cast<RooArgSet *>(file->Get("gobs")));
+        if (!read.data || !read.params) return 0;
+        cachedKey_ = key;
+        cached_ = std::move(read);
+        return &cached_;
+    }
+
+    /// keep a copy of the result and of the parameters after the call, and write them to the cache directory if there is one
+    void storeCached(const std::string &key, RooStats::ModelConfig *mc, const RooAbsData &asimov, const RooAbsCollection *gobs) {
+        cachedKey_ = key;
+        CachedAsimov &stored = cached_;
+        stored.gobs.reset();
+        stored.data.reset((RooAbsData *) asimov.Clone());
+        std::unique_ptr<RooArgSet> params(mc->GetPdf()->getParameters(*mc->GetObservables()));
+        stored.params.reset(new RooArgSet());
+        params->snapshot(*stored.params);
+        if (gobs) { stored.gobs.reset(new RooArgSet()); gobs->snapshot(*stored.gobs); }
+        if (cacheDir_.empty()) return;
+        // written under a temporary name and then renamed, so that other jobs never read a partial file
+        std::string tmpName = cacheFile(key) + Form(".%d.tmp", int(getpid()));
+        TDirectory *pwd = gDirectory;
+        std::unique_ptr<TFile> file(TFile::Open(tmpName.c_str(), "RECREATE"));
+        pwd->cd();
+        if (!file || file->IsZombie()) return;
+        file->WriteTObject(stored.data.get(), "asimov");
+        file->WriteTObject(stored.params.get(), "params");
+        if (stored.gobs) file->WriteTObject(stored.gobs.get(), "gobs");
+        file->Close();
+        if (rename(tmpName.c_str(), cacheFile(key).c_str()) != 0) unlink(tmpName.c_str());
+    }
+
+    /// put the model in the state it had after the call that made the cached result, and return a copy of the dataset
+    RooAbsData *restoreCached(const CachedAsimov &cached, RooStats::ModelConfig *mc, RooAbsCollection *snapshot, int verbose) {
+        std::unique_ptr<RooArgSet> params(mc->GetPdf()->getParameters(*mc->GetObservables()));
+        params->assignValueOnly(*cached.params);
+        if (snapshot && cached.gobs) {
+            snapshot->removeAll();
+            cached.gobs->snapshot(*snapshot);
+        }
+        if (verbose > 1) CombineLogger::instance().log("AsimovUtils.cc",__LINE__,"Using cached asimov dataset",__func__);
+        return (RooAbsData *) cached.data->Clone();
+    }
+}
+
+void asimovutils::setCacheDir(const std::string &dir) {
+    cacheDir_ = dir;
+    if (!dir.empty()) gSystem->mkdir(dir.c_str(), true);
+}
+
+void asimovutils::clearCache() {
+    cachedKey_.clear();
+    cached_ = CachedAsimov();
+}
+
+RooAbsData *asimovutils::asimovDatasetNominal(RooStats::ModelConfig *mc, double poiValue, int verbose) {
+        if (!runtimedef::get("ASIMOV_CACHE")) return makeAsimovNominal(mc, poiValue, verbose);
+        RooRealVar *r = dynamic_cast<RooRealVar *>(mc->GetParametersOfInterest()->first());
+        r->setConstant(true); r->setVal(poiValue);
+        std::string key = cacheKey(mc, 0, false, poiValue);
+        if (const CachedAsimov *cached = findCached(key)) return restoreCached(*cached, mc, 0, verbose);
+        RooAbsData *asimov = makeAsimovNominal(mc, poiValue, verbose);
+        storeCached(key, mc, *asimov, 0);
+        return asimov;
+}
+
+RooAbsData *asimovutils::asimovDatasetWithFit(RooStats::ModelConfig *mc, RooAbsData &realdata, RooAbsCollection &snapshot, bool needsFit, double poiValue, int verbose) {
+        if (!runtimedef::get("ASIMOV_CACHE")) return makeAsimovWithFit(mc, realdata, snapshot, needsFit, poiValue, verbose);
+        RooRealVar *r = dynamic_cast<RooRealVar *>(mc->GetParametersOfInterest()->first());
+        r->setConstant(true); r->setVal(poiValue);
+        std::string key = cacheKey(mc, &realdata, needsFit, poiValue);
+        if (const CachedAsimov *cached = findCached(key)) return restoreCached(*cached, mc, &snapshot, verbose);
+        RooAbsData *asimov = makeAsimovWithFit(mc, realdata, snapshot, needsFit, poiValue, verbose);
+        bool hasGobs = mc->GetGlobalObservables() && mc->GetGlobalObservables()->getSize() > 0;
+        storeCached(key, mc, *asimov, hasGobs ? &snapshot : 0);
+        return asimov;
+}
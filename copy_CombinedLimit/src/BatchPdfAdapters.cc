@@ -0,0 +1,287 @@
+#include "../interface/BatchPdfAdapters.h"
+#include "../interface/RooDoubleCBFast.h"
+#include "../interface/RooBernsteinFast.h"
+#include "../interface/GaussExp.h"
+#include "../interface/ProfilingTools.h"
+#include "../interface/CombineLogger.h"
+#include <RooAbsPdf.h>
+#include <RooRealVar.h>
+#include <RVersion.h>
+#include <TString.h>
+#include <memory>
+#include <stdexcept>
+#include "./MathHeaders.h"
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,32,0)
+#include <RooFit/Evaluator.h>
+#include <RooFit/Detail/NormalizationHelpers.h>
+#define COMBINE_BATCH_ROOFIT_FALLBACK
+#endif
+
+namespace {
+    /// the specialized adapters below handle only a pdf whose single observable is x and whose parameters are
+    /// not observables (as VectorizedCBShape); anything else is left to the scalar path
+    void checkObservables(const RooAbsReal &pdf, const RooArgSet &obs, const RooAbsData &data, const RooAbsReal &x) {
+        if (obs.getSize() != 1) throw std::invalid_argument("Multi-dimensional dataset?");
+        if (!obs.find(x.GetName())) throw std::invalid_argument(std::string("The observable of ") + pdf.GetName() + " is not " + x.GetName());
+        std::unique_ptr<RooArgSet> params(pdf.getParameters(data));
+        if (params->overlaps(obs)) throw std::invalid_argument(std::string("Some observables of ") + pdf.GetName() + " are not in the dataset");
+    }
+
+    /// values of the observable called name for the entries with positive weight (or all, if includeZeroWeights),
+    /// i.e. the same entries as the weights of CachingAddNLL
+    std::vector<Double_t> readColumn(const RooAbsData &data, const char *name, bool includeZeroWeights) {
+        RooArgSet obs(*data.get());
+        RooRealVar *x = dynamic_cast<RooRealVar *>(obs.find(name));
+        if (x == 0) throw std::invalid_argument(std::string("Dataset does not have a real observable called ") + name);
+        std::vector<Double_t> ret;
+        ret.reserve(data.numEntries());
+        for (unsigned int i = 0, n = data.numEntries(); i < n; ++i) {
+            data.get(i);
+            if (data.weight() > 0 || includeZeroWeights) ret.push_back(x->getVal());
+        }
+        return ret;
+    }
+
+    /// what getVal(obs) divides evaluate() by
+    double normalization(const RooAbsReal &pdf, const RooArgSet &obs) {
+        const RooAbsPdf *p = dynamic_cast<const RooAbsPdf *>(&pdf);
+        return p ? p->getNorm(obs) : 1.0;
+    }
+
+    class BatchDoubleCBFast : public cacheutils::BatchPdfAdapter {
+        class Worker : public RooDoubleCBFast {
+            public:
+                Worker(const RooDoubleCBFast &g) : RooDoubleCBFast(g, "") {}
+                const RooAbsReal & xvar()      const { return x.arg(); }
+                const RooAbsReal & meanvar()   const { return mean.arg(); }
+                const RooAbsReal & widthvar()  const { return width.arg(); }
+                const RooAbsReal & alpha1var() const { return alpha1.arg(); }
+                const RooAbsReal & n1var()     const { return n1.arg(); }
+                const RooAbsReal & alpha2var() const { return alpha2.arg(); }
+                const RooAbsReal & n2var()     const { return n2.arg(); }
+        };
+        public:
+            BatchDoubleCBFast(const RooAbsReal &pdf, const RooArgSet &obs, const RooAbsData &data, bool includeZeroWeights) :
+                pdf_(&pdf), obs_(&obs)
+            {
+                Worker w(static_cast<const RooDoubleCBFast &>(pdf));
+                checkObservables(pdf, obs, data, w.xvar());
+                mean_ = &w.meanvar(); width_ = &w.widthvar();
+                alpha1_ = &w.alpha1var(); n1_ = &w.n1var();
+                alpha2_ = &w.alpha2var(); n2_ = &w.n2var();
+                xvals_ = readColumn(data, w.xvar().GetName(), includeZeroWeights);
+            }
+            void fill(std::vector<Double_t> &out) const override {
+                double mean = mean_->getVal(), invwidth = my_inv(width_->getVal());
+                double alpha1 = alpha1_->getVal(), n1 = n1_->getVal(), alpha2 = alpha2_->getVal(), n2 = n2_->getVal();
+                double alpha1invn1 = alpha1*my_inv(n1), alpha2invn2 = alpha2*my_inv(n2);
+                double left = my_exp(-0.5*alpha1*alpha1), right = my_exp(-0.5*alpha2*alpha2);
+                double norm = 1.0/normalization(*pdf_, *obs_);
+                out.resize(xvals_.size());
+                for (unsigned int i = 0, n = xvals_.size(); i < n; ++i) {
+                    double t = (xvals_[i]-mean)*invwidth, val;
+                    if (t > -alpha1 && t < alpha2) {
+                        val = my_exp(-0.5*t*t);
+                    } else if (t <= -alpha1) {
+                        val = left*gbrmath::fast_pow(1. - alpha1invn1*(alpha1+t), -n1);
+                    } else {
+                        val = right*gbrmath::fast_pow(1. - alpha2invn2*(alpha2-t), -n2);
+                    }
+                    out[i] = val*norm;
+                }
+            }
+        private:
+            const RooAbsReal *pdf_;
+            const RooArgSet *obs_;
+            const RooAbsReal *mean_, *width_, *alpha1_, *n1_, *alpha2_, *n2_;
+            std::vector<Double_t> xvals_;
+    };
+
+    class BatchGaussExp : public cacheutils::BatchPdfAdapter {
+        class Worker : public GaussExp {
+            public:
+                Worker(const GaussExp &g) : GaussExp(g, "") {}
+                const RooAbsReal & xvar()  const { return x.arg(); }
+                const RooAbsReal & p0var() const { return p0.arg(); }
+                const RooAbsReal & p1var() const { return p1.arg(); }
+                const RooAbsReal & p2var() const { return p2.arg(); }
+        };
+        public:
+            BatchGaussExp(const RooAbsReal &pdf, const RooArgSet &obs, const RooAbsData &data, bool includeZeroWeights) :
+                pdf_(&pdf), obs_(&obs)
+            {
+                Worker w(static_cast<const GaussExp &>(pdf));
+                checkObservables(pdf, obs, data, w.xvar());
+                p0_ = &w.p0var(); p1_ = &w.p1var(); p2_ = &w.p2var();
+                xvals_ = readColumn(data, w.xvar().GetName(), includeZeroWeights);
+            }
+            void fill(std::vector<Double_t> &out) const override {
+                double p0 = p0_->getVal(), p1 = p1_->getVal(), p2 = p2_->getVal();
+                double norm = 1.0/normalization(*pdf_, *obs_);
+                out.resize(xvals_.size());
+                for (unsigned int i = 0, n = xvals_.size(); i < n; ++i) {
+                    double t = (xvals_[i]-p0)/p1;
+                    out[i] = norm * (t < p2 ? std::exp(-0.5*std::pow(t, 2)) : std::exp(p2*p2/2.-p2*t));
+                }
+            }
+        private:
+            const RooAbsReal *pdf_;
+            const RooArgSet *obs_;
+            const RooAbsReal *p0_, *p1_, *p2_;
+            std::vector<Double_t> xvals_;
+    };
+
+    template<int N>
+    class BatchBernsteinFast : public cacheutils::BatchPdfAdapter {
+        typedef ROOT::Math::SMatrix<double,N+1,N+1,ROOT::Math::MatRepStd<double,N+1,N+1> > MType;
+        typedef ROOT::Math::SVector<double,N+1> VType;
+        class Worker : public RooBernsteinFast<N> {
+            public:
+                Worker(const RooBernsteinFast<N> &g) : RooBernsteinFast<N>(g, "") {}
+                const RooAbsReal & xvar() const { return this->_x.arg(); }
+                const RooArgList & coefs() const { return this->_coefList; }
+                const MType & cmatrix() const { return this->_cmatrix; }
+        };
+        public:
+            BatchBernsteinFast(const RooAbsReal &pdf, const RooArgSet &obs, const RooAbsData &data, bool includeZeroWeights) :
+                pdf_(&pdf), obs_(&obs)
+            {
+                Worker w(static_cast<const RooBernsteinFast<N> &>(pdf));
+                checkObservables(pdf, obs, data, w.xvar());
+                x_ = dynamic_cast<const RooAbsRealLValue *>(&w.xvar());
+                if (x_ == 0) throw std::invalid_argument("RooBernsteinFast with a non-lvalue observable");
+                for (RooAbsArg *a : w.coefs()) coefs_.push_back(static_cast<const RooAbsReal *>(a));
+                cmatrix_ = w.cmatrix();
+                xvals_ = readColumn(data, w.xvar().GetName(), includeZeroWeights);
+            }
+            void fill(std::vector<Double_t> &out) const override {
+                VType bern;
+                bern[0] = 1.0;
+                for (int ipow = 1; ipow <= N; ++ipow) bern[ipow] = coefs_[ipow-1]->getVal();
+                VType powv = cmatrix_*bern;
+                double xmin = x_->getMin(), xmax = x_->getMax();
+                double norm = 1.0/normalization(*pdf_, *obs_);
+                out.resize(xvals_.size());
+                for (unsigned int i = 0, n = xvals_.size(); i < n; ++i) {
+                    double x = (xvals_[i] - xmin) / (xmax - xmin), xp = 1., val = powv[0];
+                    for (int ipow = 1; ipow <= N; ++ipow) {
+                        xp *= x;
+                        val += powv[ipow]*xp;
+                    }
+                    out[i] = val*norm;
+                }
+            }
+        private:
+            const RooAbsReal *pdf_;
+            const RooArgSet *obs_;
+            const RooAbsRealLValue *x_;
+            std::vector<const RooAbsReal *> coefs_;
+            MType cmatrix_;
+            std::vector<Double_t> xvals_;
+    };
+
+#ifdef COMBINE_BATCH_ROOFIT_FALLBACK
+    /// generic fallback: RooFit's batch evaluation of a compiled copy of the pdf, fed with
+    /// the columns of the dataset
+    class BatchRooFitEvaluator : public cacheutils::BatchPdfAdapter {
+        public:
+            BatchRooFitEvaluator(const RooAbsReal &pdf, const RooArgSet &obs, const RooAbsData &data, bool includeZeroWeights) {
+                RooArgSet dataObs(*data.get());
+                std::vector<RooRealVar *> vars;
+                for (RooAbsArg *a : dataObs) {
+                    RooRealVar *v = dynamic_cast<RooRealVar *>(a);
+                    if (v == 0) throw std::invalid_argument(std::string("Batch evaluation needs real observables, but ") + a->GetName() + " is not");
+                    vars.push_back(v);
+                }
+                columns_.resize(vars.size());
+                size_ = 0;
+                for (unsigned int i = 0, n = data.numEntries(); i < n; ++i) {
+                    data.get(i);
+                    if (!(data.weight() > 0 || includeZeroWeights)) continue;
+                    for (unsigned int k = 0; k < vars.size(); ++k) columns_[k].push_back(vars[k]->getVal());
+                    ++size_;
+                }
+                compiled_ = RooFit::Detail::compileForNormSet<RooAbsReal>(pdf, obs);
+                evaluator_ = std::make_unique<RooFit::Evaluator>(*compiled_);
+                for (unsigned int k = 0; k < vars.size(); ++k) evaluator_->setInput(vars[k]->GetName(), columns_[k], false);
+            }
+            void fill(std::vector<Double_t> &out) const override {
+                std::span<const double> vals = evaluator_->run();
+                out.resize(size_);
+                if (vals.size() == 1) std::fill(out.begin(), out.end(), vals[0]);
+                else std::copy(vals.begin(), vals.begin() + size_, out.begin());
+            }
+        private:
+            std::vector<std::vector<double>> columns_;
+            std::unique_ptr<RooAbsReal> compiled_;
+            std::unique_ptr<RooFit::Evaluator> evaluator_;
+            unsigned int size_;
+    };
+#endif
+
+    template<typename AdapterT>
+    cacheutils::BatchPdfAdapter * makeAdapter(const RooAbsReal &pdf, const RooArgSet &obs, const RooAbsData &data, bool includeZeroWeights) {
+        return new AdapterT(pdf, obs, data, includeZeroWeights);
+    }
+}
+
+std::map<std::string, cacheutils::BatchPdfAdapter::Factory> &
+cacheutils::BatchPdfAdapter::registry()
+{
+    static std::map<std::string, Factory> adapters = {
+        { "RooDoubleCBFast",     makeAdapter<BatchDoubleCBFast> },
+        { "GaussExp",            makeAdapter<BatchGaussExp> },
+        { "RooBernsteinFast<1>", makeAdapter<BatchBernsteinFast<1>> },
+        { "RooBernsteinFast<2>", makeAdapter<BatchBernsteinFast<2>> },
+        { "RooBernsteinFast<3>", makeAdapter<BatchBernsteinFast<3>> },
+        { "RooBernsteinFast<4>", makeAdapter<BatchBernsteinFast<4>> },
+        { "RooBernsteinFast<5>", makeAdapter<BatchBernsteinFast<5>> },
+        { "RooBernsteinFast<6>", makeAdapter<BatchBernsteinFast<6>> },
+        { "RooBernsteinFast<7>", makeAdapter<BatchBernsteinFast<7>> }
+    };
+    return adapters;
+}
+
+void
+cacheutils::BatchPdfAdapter::registerAdapter(const std::string &className, Factory factory)
+{
+    registry()[className] = factory;
+}
+
+cacheutils::BatchPdfAdapter::Mode
+cacheutils::BatchPdfAdapter::mode(const RooAbsReal &pdf)
+{
+    int mode = runtimedef::get(std::string("ADDNLL_BATCH_") + pdf.ClassName());
+    return mode < 0 ? Scalar : (mode > 0 ? Batch : Default);
+}
+
+bool
+cacheutils::BatchPdfAdapter::enabled(const RooAbsReal &pdf)
+{
+    Mode m = mode(pdf);
+    if (m == Scalar) return false;
+    if (registry().count(pdf.ClassName())) return true;
+#ifdef COMBINE_BATCH_ROOFIT_FALLBACK
+    return m == Batch || runtimedef::get("ADDNLL_BATCH_ROOFIT");
+#else
+    return false;
+#endif
+}
+
+cacheutils::BatchPdfAdapter *
+cacheutils::BatchPdfAdapter::create(const RooAbsReal &pdf, const RooArgSet &obs, const RooAbsData &data, bool includeZeroWeights)
+{
+    try {
+        auto it = registry().find(pdf.ClassName());
+        if (it != registry().end()) return it->second(pdf, obs, data, includeZeroWeights);
+#ifdef COMBINE_BATCH_ROOFIT_FALLBACK
+        return new BatchRooFitEvaluator(pdf, obs, data, includeZeroWeights);
+#endif
+    } catch (std::exception &ex) {
+        if (runtimedef::get("ADDNLL_VERBOSE_CACHING")) {
+            CombineLogger::instance().log("BatchPdfAdapters.cc",__LINE__,std::string(Form("No batch evaluation for %s (%s), using the scalar one: %s",pdf.ClassName(),pdf.GetName(),ex.what())),__func__);
+        }
+    }
+    return 0;
+}
@@ -14,6 +14,7 @@
 #include "RooGaussian.h"
 #include "RooProduct.h"
 #include "vectorized.h"
+#include "../interface/ProfilingTools.h"
 
 #define HFVERBOSE 0
 
@@ -101,6 +102,7 @@ void CMSHistErrorPropagator::initialize() const {
 
 
 void CMSHistErrorPropagator::updateCache(int eval) const {
+  PROFILE_SCOPE("CMSHistErrorPropagator::updateCache");
   initialize();
 
 #if HFVERBOSE > 0
@@ -479,12 +479,12 @@ void CMSHistFunc::updateCache() const {
             double y2 = mcache_[idx2].integral;
             if(y1 <= 0.0 || y2 <= 0.0)
             {
-              FastTemplate emptyhist(cache_.size());
-              mcache_[idx1].step1 = emptyhist;
+              mcache_[idx1].step1.Resize(cache_.size());
+              mcache_[idx1].step1.Clear();
             }
             else
             {
-              mcache_[idx1].step1 = cdfMorph(idx1, x1, x2, val);
+              cdfMorph(idx1, x1, x2, val, mcache_[idx1].step1);
               mcache_[idx1].step1.CropUnderflows();
               double ym = y1 + ((y2 - y1) / (x2 - x1)) * (val - x1);
               mcache_[idx1].step1.Scale(ym / integrateTemplate(mcache_[idx1].step1));
@@ -761,221 +761,26 @@ void CMSHistFunc::updateMomentFractions(double m) const {
 
 void CMSHistFunc::prepareInterpCache(Cache& c1,
                                      Cache const& c2) const {
-  // *
-  // *......We are going to step through all the edges of both input
-  // *      cdf's ordered by increasing value of y. We start at the
-  // *      lower edge, but first we should identify the upper ends of the
-  // *      curves. These (ixl1, ixl2) are the first point in each cdf from
-  // *      above that has the same integral as the last edge.
-  // *
-
-  Int_t ix1l = cache_.size();
-  Int_t ix2l = cache_.size();
-  while (c1.cdf[ix1l - 1] >= c1.cdf[ix1l]) {
-    ix1l = ix1l - 1;
-  }
-  while (c2.cdf[ix2l - 1] >= c2.cdf[ix2l]) {
-    ix2l = ix2l - 1;
-  }
-
-  // *
-  // *......Step up to the beginnings of the curves. These (ix1, ix2) are the
-  // *      first non-zero points from below.
-
-  Int_t ix1 = -1;
-  do {
-    ix1 = ix1 + 1;
-  } while (c1.cdf[ix1 + 1] <= c1.cdf[0]);
-
-  Int_t ix2 = -1;
-  do {
-    ix2 = ix2 + 1;
-  } while (c2.cdf[ix2 + 1] <= c2.cdf[0]);
-
+  // The inverse cdf table is built once for each pair of templates, and
+  // cdfMorph only has to project it for the current morphing parameter
+  int nbn = cache_.size();
+  std::vector<double> edges(nbn + 1);
+  for (int i = 0; i <= nbn; ++i) edges[i] = cache_.GetEdge(i);
+  c1.hmorph.init(nbn, &edges[0], &c1.cdf[0], nbn, &edges[0], &c2.cdf[0], nbn,
+                 &edges[0], HorizontalMorph::HistFunc);
 #if HFVERBOSE > 2
-  std::cout << "First and last edge of hist1: " << ix1 << " " << ix1l
+  std::cout << "Points of the interpolated cdf: " << c1.hmorph.levels()
             << std::endl;
-  std::cout << "Relevant bins of cdf1: (x, y) = " << std::endl;
-  for (int ind=ix1; ind<=ix1l; ind++)
-  {
-    std::cout << "\t(" << cache_.GetEdge(ind) << "," << c1.cdf[ind] << ")" << std::endl;
-  }
-  std::cout << "First and last edge of hist2: " << ix2 << " " << ix2l
-            << std::endl;
-  std::cout << "Relevant bins of cdf2: (x, y) = " << std::endl;
-  for (int ind=ix2; ind<=ix2l; ind++)
-  {
-    std::cout << "\t(" << cache_.GetEdge(ind) << "," << c2.cdf[ind] << ")" << std::endl;
-  }
-#endif
-
-
-  // ....The first interpolated point should be computed now.
-
-  Int_t nx3 = 0;
-  // Double_t x1, x2, x;
-  Double_t x1, x2;
-  x1 = cache_.GetEdge(ix1);
-  x2 = cache_.GetEdge(ix2);
-
-  c1.x1.push_back(x1);
-  c1.x2.push_back(x2);
-  c1.y.push_back(0.);
-
-  // x = wt1 * x1 + wt2 * x2;
-  // xdisn[nx3] = x;
-  // sigdisn[nx3] = 0;
-  // if (idebug >= 1) {
-  //   std::cout << "First interpolated point: " << xdisn[nx3] << " "
-  //             << sigdisn[nx3] << std::endl;
-  //   std::cout << "                          " << x1 << " <= " << x
-  //             << " <= " << x2 << std::endl;
-  // }
-
-  // .....Loop over the remaining point in both curves. Getting the last
-  //      points may be a bit tricky due to limited floating point
-  //      precision.
-
-#if HFVERBOSE > 2
-  std::cout << "----BEFORE while with ix1=" << ix1 << ", ix1l=" << ix1l
-       << ", ix2=" << ix2 << ", ix2l=" << ix2l << std::endl;
-#endif
-
-  Double_t yprev = -1;  // The probability y of the previous point, it will
-  // get updated and used in the loop.
-  Double_t y = 0;
-  while ((ix1 < ix1l) | (ix2 < ix2l)) {
-
-#if HFVERBOSE > 2
-    std::cout << "----Top of while with ix1=" << ix1 << ", ix1l=" << ix1l
-         << ", ix2=" << ix2 << ", ix2l=" << ix2l << std::endl;
-#endif
-    // .....Increment to the next lowest point. Step up to the next
-    //      kink in case there are several empty (flat in the integral)
-    //      bins.
-
-    Int_t i12type = -1;  // Tells which input distribution we need to
-                         // see next point of.
-    if ((c1.cdf[ix1 + 1] <= c2.cdf[ix2 + 1] || ix2 == ix2l) && ix1 < ix1l) {
-      ix1 = ix1 + 1;
-      while (c1.cdf[ix1 + 1] < c1.cdf[ix1] && ix1 < ix1l) {
-        ix1 = ix1 + 1;
-      }
-      i12type = 1;
-    } else if (ix2 < ix2l) {
-      ix2 = ix2 + 1;
-      while (c2.cdf[ix2 + 1] <= c2.cdf[ix2] && ix2 < ix2l) {
-        ix2 = ix2 + 1;
-      }
-      i12type = 2;
-    }
-    if (i12type == 1) {
-#if HFVERBOSE > 2
-      std::cout << "Pair for i12type=1: " << c2.cdf[ix2] << " "
-                << c1.cdf[ix1] << " " << c2.cdf[ix2 + 1] << std::endl;
-#endif
-      x1 = cache_.GetEdge(ix1);
-      y = c1.cdf[ix1];
-      Double_t x20 = cache_.GetEdge(ix2);
-      Double_t y20 = c2.cdf[ix2];
-      Double_t x21 = x20;
-      Double_t y21 = y20;
-      if (ix2 < ix2l) {
-        x21 = cache_.GetEdge(ix2 + 1);
-        y21 = c2.cdf[ix2 + 1];
-      }
-      // .....Calculate where the cummulative probability y in distribution 1
-      //      intersects between the 2 points from distribution 2 which
-      //      bracket it.
-
-      if (y21 > y20) {
-        x2 = x20 + (x21 - x20) * (y - y20) / (y21 - y20);
-      } else {
-        x2 = x20;
-      }
-    } else {
-#if HFVERBOSE > 2
-      std::cout << "Pair for i12type=2: " << c1.cdf[ix1] << " "
-                << c2.cdf[ix2] << " " << c1.cdf[ix1 + 1] << std::endl;
-#endif
-      x2 = cache_.GetEdge(ix2);
-      y = c2.cdf[ix2];
-      Double_t x10 = cache_.GetEdge(ix1);
-      Double_t y10 = c1.cdf[ix1];
-      Double_t x11 = x10;
-      Double_t y11 = y10;
-      if (ix1 < ix1l) {
-        x11 = cache_.GetEdge(ix1 + 1);
-        y11 = c1.cdf[ix1 + 1];
-      }
-
-      // .....Calculate where the cummulative probability y in distribution 2
-      //      intersects between the 2 points from distribution 1 which
-      //      brackets it.
-
-      if (y11 > y10) {
-        x1 = x10 + (x11 - x10) * (y - y10) / (y11 - y10);
-      } else {
-        x1 = x10;
-      }
-    }
-
-    // .....Interpolate between the x's in the 2 distributions at the
-    //      cummulative probability y. Store the (x,y) for provisional
-    //      edge nx3 in (xdisn[nx3],sigdisn[nx3]). nx3 grows for each point
-    //      we add the the arrays. Note: Should probably turn the pair into
-    //      a structure to make the code more object-oriented and readable.
-
-    // x = wt1 * x1 + wt2 * x2;
-    if (y > yprev) {
-      nx3 = nx3 + 1;
-#if HFVERBOSE > 2
-        std::cout << " ---> y > yprev: i12type=" << i12type << ", nx3=" << nx3
-             << ", y=" << y << ", yprev=" << yprev << std::endl;
-             // << ", x= " << x << ", y=" << y << ", yprev=" << yprev << std::endl;
-#endif
-      yprev = y;
-      c1.x1.push_back(x1);
-      c1.x2.push_back(x2);
-      c1.y.push_back(y);
-      // xdisn[nx3] = x;
-      // sigdisn[nx3] = y;
-#if HFVERBOSE > 2
-      std::cout << "    ix1=" << ix1 << ", ix2= " << ix2
-           << ", i12type= " << i12type << ", sigdis1[ix1]=" << c1.cdf[ix1]
-           << std::endl;
-      std::cout << "        "
-           << ", nx3=" << nx3 << ", y= " << c1.y[nx3]
-           // << ", nx3=" << nx3 << ", x=" << x << ", y= " << c1.y[nx3]
-           << std::endl;
-#endif
-    }
-  }
-#if HFVERBOSE > 2
-    for (unsigned i = 0; i < c1.y.size(); i++) {
-      std::cout << " nx " << i << " " << c1.x1[i] << " " << c1.x2[i] << " " << c1.y[i]
-                << std::endl;
-    }
 #endif
   c1.interp_set = true;
 }
 
-FastTemplate CMSHistFunc::cdfMorph(unsigned idx, double par1, double par2,
-                                 double parinterp) const {
+void CMSHistFunc::cdfMorph(unsigned idx, double par1, double par2,
+                           double parinterp, FastTemplate& out) const {
   double wt1;
   double wt2;
-  if (par2 != par1) {
-    wt1 = 1. - (parinterp - par1) / (par2 - par1);
-    wt2 = 1. + (parinterp - par2) / (par2 - par1);
-  } else {
-    wt1 = 0.5;
-    wt2 = 0.5;
-  }
-
   // ......Give a warning if this is an extrapolation.
-
-  if (wt1 < 0 || wt1 > 1. || wt2 < 0. || wt2 > 1. ||
-      fabs(1 - (wt1 + wt2)) > 1.0e-4) {
+  if (!HorizontalMorph::weights(par1, par2, parinterp, wt1, wt2)) {
     std::cout << "Warning! th1fmorph: This is an extrapolation!! Weights are "
               << wt1 << " and " << wt2 << " (sum=" << wt1 + wt2 << ")"
               << std::endl;
@@ -984,183 +789,8 @@ FastTemplate CMSHistFunc::cdfMorph(unsigned idx, double par1, double par2,
     std::cout << "th1morph - Weights: " << wt1 << " " << wt2 << std::endl;
 #endif
 
-  // Treatment for empty histograms: Return an empty histogram
-  // with interpolated bins.
-
-  // FIXME should restore zero integral behaviour
-  // if (hist1.Integral() <= 0 || hist2.Integral() <= 0) {
-  //   std::cout << "Warning! th1morph detects an empty input histogram. Empty "
-  //           "interpolated histogram returned: " << std::endl;
-  //   return (TH1F("morphed", "morphed", mc_.nbn, mc_.xminn, mc_.xmaxn));
-  // }
-  // if (idebug >= 1)
-  //   std::cout << "Input histogram content sums: " << hist1.Integral() << " "
-  //        << hist2.Integral() << std::endl;
-
-  // *
-  // *......Extract the single precision histograms into double precision arrays
-  // *      for the interpolation computation. The offset is because sigdis(i)
-  // *      describes edge i (there are nbins+1 of them) while dist1/2
-  // *      describe bin i. Be careful, ROOT does not use C++ convention to
-  // *      number bins: dist1[ibin] is content of bin ibin where ibin runs from
-  // *      1 to nbins. We allocate some extra space for the derived
-  // distributions
-  // *      because there may be as many as nb1+nb2+2 edges in the intermediate
-  // *      interpolated cdf described by xdisn[i] (position of edge i) and
-  // *      sigdisn[i] (cummulative probability up this edge) before we project
-  // *      into the final binning.
-  // Float_t const* dist1 = hist1.GetArray();
-  // Float_t const* dist2 = hist2.GetArray();
-
-  // *......Now we loop over the edges of the bins of the interpolated
-  // *      histogram and find out where the interpolated cdf 3
-  // *      crosses them. This projection defines the result and will
-  // *      be stored (after differention and renormalization) in the
-  // *      output histogram.
-  // *
-  // *......We set all the bins following the final edge to the value
-  // *      of the final edge.
-
-  Cache const& c1 = mcache_[idx];
-
-  int nbn = cache_.size();
-  int nbe = cache_.size() + 1;
-
-  double x  = cache_.GetEdge(nbn);
-  int ix = nbn;
-
-  int nx3 = c1.y.size();
-  std::vector<double> xdisn(nx3);
-  for (int i = 0; i < nx3; ++i) {
-    xdisn[i] = wt1 * c1.x1[i] + wt2 * c1.x2[i];
-  }
-#if HFVERBOSE > 2
-    std::cout << "relevant x,y for the morphed cdf: "  << std::endl;
-    for (unsigned int i=0; i < c1.y.size(); ++i){ std::cout << "\t (x,y) = (" << xdisn[i] << "," << c1.y[i] << ")" << std::endl; }
-#endif
-  std::vector<double> sigdisf(nbe, 0.);
-
-
-  nx3 = nx3 - 1;
-
-#if HFVERBOSE > 2
-    std::cout << "------> Any final bins to set? " << x << " " << xdisn[nx3]
-              << std::endl;
-#endif
-
-  while (x >= xdisn[nx3]) {
-    sigdisf[ix] = c1.y[nx3];
-
-#if HFVERBOSE > 2
-      std::cout << "   Setting final bins " << ix << " " << x << " "
-                << sigdisf[ix] << std::endl;
-#endif
-
-    ix = ix - 1;
-    x = cache_.GetEdge(ix);
-  }
-  Int_t ixl = ix + 1;
-
-#if HFVERBOSE > 2
-  std::cout << " Now ixl=" << ixl << " ix=" << ix << std::endl;
-#endif
-
-  // *
-  // *......The beginning may be empty, so we have to step up to the first
-  // *      edge where the result is nonzero. We zero the bins which have
-  // *      and upper (!) edge which is below the first point of the
-  // *      cummulative distribution we are going to project to this
-  // *      output histogram binning.
-  // *
-
-  ix = 0;
-  x = cache_.GetEdge(ix + 1);
-
-#if HFVERBOSE > 2
-  std::cout << "Start setting initial bins at x=" << x << std::endl;
-#endif
-
-  while (x <= xdisn[0]) {
-    sigdisf[ix] = c1.y[0];
-#if HFVERBOSE > 2
-    std::cout << "   Setting initial bins " << ix << " " << x << " "
-              << xdisn[1] << " " << sigdisf[ix] << std::endl;
-#endif
-    ix = ix + 1;
-    x = cache_.GetEdge(ix + 1);
-  }
-  Int_t ixf = ix;
-
-#if HFVERBOSE > 2
-  std::cout << "Bins left to loop over:" << ixf << "-" << ixl << std::endl;
-#endif
-  // *......Also the end (from y to 1.0) often comes before the last edge
-  // *      so we have to set the following to 1.0 as well.
-
-  Int_t ix3 = 0;  // Problems with initial edge!!!
-  double y = 0;
-  for (ix = ixf; ix < ixl; ix++) {
-    x = cache_.GetEdge(ix);
-    if (x < xdisn[0]) {
-      y = 0;
-    } else if (x > xdisn[nx3]) {
-      y = 1.;
-    } else {
-      while (xdisn[ix3 + 1] <= x && ix3 < 2 * nbn) {
-        ix3 = ix3 + 1;
-      }
-      int bin = cache_.FindBin(x);
-      if (bin == -1) bin = 0;
-      // std::cout << "x=" << x << ", bin=" << bin << "\n";
-      Double_t dx2 = cache_.GetWidth(bin);
-      if (xdisn[ix3 + 1] - x >= 1.0 * dx2) {  // Empty bin treatment
-#if HFVERBOSE > 2
-        std::cout << "Warning - th1fmorph: encountered empty bin." << std::endl;
-#endif
-        y = c1.y[ix3];
-      } else if (xdisn[ix3 + 1] > xdisn[ix3]) {  // Normal bins
-        y = c1.y[ix3] + (c1.y[ix3 + 1] - c1.y[ix3]) *
-                               (x - xdisn[ix3]) / (xdisn[ix3 + 1] - xdisn[ix3]);
-      } else {  // Is this ever used?
-        y = 0;
-        std::cout << "Warning - th1fmorph: This probably shoudn't happen! "
-                  << std::endl;
-        std::cout << "Warning - th1fmorph: Zero slope solving x(y)"
-                  << std::endl;
-        // for (unsigned z = 0; z < c1.y.size(); ++z) {
-        //   printf("x %.6f x1 %.6f x2 %.6f y %.6f\n", xdisn[z], c1.x1[z], c1.x2[z], c1.y[z]);
-        // }
-      }
-    }
-    sigdisf[ix] = y;
-#if HFVERBOSE > 2
-      std::cout << ix << ", ix3=" << ix3 << ", xdisn=" << xdisn[ix3]
-                << ", x=" << x << ", next xdisn=" << xdisn[ix3 + 1]
-                << std::endl;
-      std::cout << "   cdf n=" << c1.y[ix3] << ", y=" << y
-           << ", next point=" << c1.y[ix3 + 1] << std::endl;
-#endif
-  }
-#if HFVERBOSE > 2
-  std::cout << "CDF mapped into the histogram binning:" << std::endl;
-  for (int ind = std::max(0, ixf - 1); ind < ixl+1; ind++) {
-    std::cout << "\t(bin,x,y) = (" << ind << "," << cache_.GetEdge(ind) << "," << sigdisf[ind] << ")" << std::endl;
-  }
-#endif
-
-  // .....Differentiate interpolated cdf and return renormalized result in
-  //      new histogram.
-
-  FastTemplate morphedhist(nbn);
-
-  for (ix = nbn - 1; ix > -1; ix--) {
-    y = sigdisf[ix + 1] - sigdisf[ix];
-    morphedhist[ix] = y / cache_.GetWidth(ix);
-  }
-
-  // ......All done, return the result.
-
-  return morphedhist;
+  out.Resize(cache_.size());
+  mcache_[idx].hmorph.morph(wt1, wt2, &out[0], true);
 }
 
 double CMSHistFunc::integrateTemplate(FastTemplate const& t) const {
@@ -14,6 +14,7 @@
 #include "RooGaussian.h"
 #include "RooProduct.h"
 #include "vectorized.h"
+#include "../interface/ProfilingTools.h"
 
 #define HFVERBOSE 0
 
@@ -338,6 +339,7 @@ inline double CMSHistSum::smoothStepFunc(double x, int const& ip) const {
 
 
 void CMSHistSum::updateCache() const {
+  PROFILE_SCOPE("CMSHistSum::updateCache");
   initialize();
 
 #if HFVERBOSE > 0
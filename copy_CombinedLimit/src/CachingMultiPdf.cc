@@ -67,32 +67,98 @@ Double_t  RooMultiPdf::getLogVal(const RooArgSet* nset) const {
 #include "../interface/CachingMultiPdf.h"
 #include "vectorized.h"
 #include "../interface/utils.h"
+#include "../interface/ProfilingTools.h"
+#include <iterator>
 
 // Uncomment do do regression testing wrt uncached multipdf
 //#define CachingMultiPdf_VALIDATE
 
+cacheutils::CachingMultiPdf::LRUList cacheutils::CachingMultiPdf::lru_;
+size_t cacheutils::CachingMultiPdf::lruBytes_ = 0;
+
 cacheutils::CachingMultiPdf::CachingMultiPdf(const RooMultiPdf &pdf, const RooArgSet &obs) :
-    pdf_(&pdf)
+    pdf_(&pdf),
+    obs_(&obs),
+    cachingPdfs_(pdf.getNumPdfs()),
+    lruPos_(pdf.getNumPdfs(), lru_.end())
 {
     //std::cout << "Making a CachingMultiPdf for " << pdf.GetName() << " with " <<  pdf_->getNumPdfs() << " pdfs." << std::endl;
-    for (int i = 0, n = pdf_->getNumPdfs(); i < n; ++i) {
-        cachingPdfs_.emplace_back(makeCachingPdf(pdf_->getPdf(i), &obs));
-        //cachingPdfs_.push_back(new CachingPdf(pdf_->getPdf(i), &obs));
-        //std::cout << "      MultiPdfAdding " <<  pdf.GetName() << "[" << i << "]: " << pdf_->getPdf(i)->ClassName() << " " << pdf_->getPdf(i)->GetName() << " using " << typeid(cachingPdfs_.back()).name() << std::endl;
-    }
 #ifdef CachingMultiPdf_VALIDATE
-    cachingPdfs_.push_back(new CachingPdf((RooAbsPdf*)&pdf,&obs));
+    cachingPdfs_.emplace_back(new CachingPdf((RooAbsPdf*)&pdf,&obs));
 #endif
 
 }
 
 cacheutils::CachingMultiPdf::~CachingMultiPdf()
 {
+    for (int i = 0, n = lruPos_.size(); i < n; ++i) {
+        if (lruPos_[i] != lru_.end()) release(i);
+    }
+}
+
+unsigned int cacheutils::CachingMultiPdf::allocated() const
+{
+    unsigned int ret = 0;
+    for (int i = 0, n = pdf_->getNumPdfs(); i < n; ++i) {
+        if (cachingPdfs_[i]) ++ret;
+    }
+    return ret;
+}
+
+cacheutils::CachingPdfBase & cacheutils::CachingMultiPdf::alternative(int index)
+{
+    std::unique_ptr<CachingPdfBase> &ret = cachingPdfs_[index];
+    if (!ret) {
+        ret.reset(makeCachingPdf(pdf_->getPdf(index), obs_));
+        ret->setIncludeZeroWeights(includeZeroWeights_);
+        //std::cout << "      MultiPdfAdding " <<  pdf_->GetName() << "[" << index << "]: " << pdf_->getPdf(index)->ClassName() << " " << pdf_->getPdf(index)->GetName() << std::endl;
+    }
+    return *ret;
+}
+
+void cacheutils::CachingMultiPdf::touch(int index, size_t bytes)
+{
+    static size_t budget = size_t(runtimedef::get("MULTIPDF_CACHE_BUDGET_MB")) << 20;
+    // without a budget nothing is ever evicted, so there is no need to keep track of the use
+    if (budget == 0) return;
+    if (lruPos_[index] != lru_.end()) {
+        // move the entry to the front without reallocating it, as this is called at every eval
+        lru_.splice(lru_.begin(), lru_, lruPos_[index]);
+        lruBytes_ -= lruPos_[index]->bytes;
+        lruPos_[index]->bytes = bytes;
+    } else {
+        lru_.push_front(LRUEntry{this, index, bytes});
+        lruPos_[index] = lru_.begin();
+    }
+    lruBytes_ += bytes;
+    evict(budget);
+}
+
+void cacheutils::CachingMultiPdf::release(int index)
+{
+    lruBytes_ -= lruPos_[index]->bytes;
+    lru_.erase(lruPos_[index]);
+    lruPos_[index] = lru_.end();
+    cachingPdfs_[index].reset();
+}
+
+void cacheutils::CachingMultiPdf::evict(size_t budget)
+{
+    // the current alternatives are never freed: the values they returned may still be in use by the caller
+    LRUList::iterator it = lru_.end();
+    while (lruBytes_ > budget && it != lru_.begin()) {
+        LRUList::iterator victim = std::prev(it);
+        if (victim->owner->pdf_->getCurrentIndex() == victim->index) { it = victim; continue; }
+        victim->owner->release(victim->index);
+    }
 }
 
 const std::vector<Double_t> & cacheutils::CachingMultiPdf::eval(const RooAbsData &data)
 {
-    const std::vector<Double_t> & ret = cachingPdfs_[pdf_->getCurrentIndex()]->eval(data);
+    int index = pdf_->getCurrentIndex();
+    const std::vector<Double_t> & ret = alternative(index).eval(data);
+    // a rough size of the cache: the values for the last few points in the parameter space (see ValuesCache)
+    touch(index, 3 * ret.capacity() * sizeof(Double_t));
 #ifdef CachingMultiPdf_VALIDATE
     cachingPdfs_.back().setDataDirty();
     const std::vector<Double_t> & chk = cachingPdfs_.back()->eval(data);
@@ -124,14 +190,15 @@ const std::vector<Double_t> & cacheutils::CachingMultiPdf::eval(const RooAbsData
 void cacheutils::CachingMultiPdf::setDataDirty()
 {
     for (auto &pdf : cachingPdfs_) {
-        pdf->setDataDirty();
+        if (pdf) pdf->setDataDirty();
     }
 }
 
 void cacheutils::CachingMultiPdf::setIncludeZeroWeights(bool includeZeroWeights) 
 {
+    includeZeroWeights_ = includeZeroWeights;
     for (auto &pdf : cachingPdfs_) {
-        pdf->setIncludeZeroWeights(includeZeroWeights);
+        if (pdf) pdf->setIncludeZeroWeights(includeZeroWeights);
     }
 }
 
@@ -2,6 +2,8 @@
 #include "../interface/utils.h"
 #include "../interface/FnTimer.h"
 #include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
 #include <RooCategory.h>
 #include <RooDataSet.h>
 #include <RooProduct.h>
@@ -19,10 +21,13 @@
 #include "../interface/VectorizedCB.h"
 #include "../interface/VectorizedSimplePdfs.h"
 #include "../interface/VectorizedHistFactoryPdfs.h"
+#include "../interface/BatchPdfAdapters.h"
 #include "../interface/CachingMultiPdf.h"
 #include "../interface/RooCheapProduct.h"
+#include "../interface/ProcessNormalization.h"
 #include "../interface/Accumulators.h"
 #include "../interface/CombineLogger.h"
+#include "../interface/FactorizationCache.h"
 #include "vectorized.h"
 
 namespace cacheutils {
@@ -344,6 +349,53 @@ cacheutils::CachingPdf::realFill_(const RooAbsData &data, std::vector<Double_t>
 }
 
 
+cacheutils::CachingBatchPdf::CachingBatchPdf(RooAbsReal *pdf, const RooArgSet *obs) :
+    CachingPdf(pdf, obs)
+{
+}
+
+cacheutils::CachingBatchPdf::CachingBatchPdf(const CachingBatchPdf &other) :
+    CachingPdf(other)
+{
+}
+
+cacheutils::CachingBatchPdf::~CachingBatchPdf()
+{
+}
+
+void
+cacheutils::CachingBatchPdf::newData_(const RooAbsData &data)
+{
+    CachingPdf::newData_(data);
+    adapter_.reset(BatchPdfAdapter::create(*pdf_, *obs_, data, includeZeroWeights_));
+}
+
+void
+cacheutils::CachingBatchPdf::realFill_(const RooAbsData &data, std::vector<Double_t> &vals)
+{
+    static bool check = runtimedef::get("ADDNLL_BATCH_CHECK");
+    if (!adapter_) {
+        CachingPdf::realFill_(data, vals);
+        return;
+    }
+    adapter_->fill(vals);
+    if (check) {
+        CachingPdf::realFill_(data, scalarValues_);
+        if (scalarValues_.size() != vals.size()) {
+            CombineLogger::instance().log("CachingNLL.cc",__LINE__,std::string(Form("Batch evaluation of %s (%s) filled %u values instead of %u",pdf_->ClassName(),pdf_->GetName(),unsigned(vals.size()),unsigned(scalarValues_.size()))),__func__);
+            return;
+        }
+        double maxdiff = 0; unsigned int imax = 0;
+        for (unsigned int i = 0, n = vals.size(); i < n; ++i) {
+            double diff = std::abs(vals[i] - scalarValues_[i]) / std::max(std::abs(scalarValues_[i]), 1e-300);
+            if (!(diff <= maxdiff)) { maxdiff = diff; imax = i; }
+        }
+        if (!(maxdiff <= 1e-6)) {
+            CombineLogger::instance().log("CachingNLL.cc",__LINE__,std::string(Form("Batch evaluation of %s (%s) differs from the scalar one by %g (relative) at entry %u: %g vs %g",pdf_->ClassName(),pdf_->GetName(),maxdiff,imax,vals[imax],scalarValues_[imax])),__func__);
+        }
+    }
+}
+
 template <typename PdfT, typename VPdfT>
 void
 cacheutils::OptimizedCachingPdfT<PdfT,VPdfT>::newData_(const RooAbsData &data) 
@@ -467,6 +519,7 @@ cacheutils::makeCachingPdf(RooAbsReal *pdf, const RooArgSet *obs) {
     static bool histfuncNll  = runtimedef::get("ADDNLL_HISTFUNCNLL");
     static bool cbNll  = runtimedef::get("ADDNLL_CBNLL");
     static bool hfNll  = runtimedef::get("ADDNLL_HFNLL");
+    static bool batchNll  = runtimedef::get("ADDNLL_BATCHNLL");
     static bool verb  = runtimedef::get("ADDNLL_VERBOSE_CACHING");
 
     if (histNll && typeid(*pdf) == typeid(FastVerticalInterpHistPdf)) {
@@ -508,6 +561,8 @@ cacheutils::makeCachingPdf(RooAbsReal *pdf, const RooArgSet *obs) {
         return new CachingCMSHistErrorPropagator(pdf, obs);
     } else if (histfuncNll && typeid(*pdf) == typeid(CMSHistSum)) {
         return new CachingCMSHistSum(pdf, obs);
+    } else if (batchNll && BatchPdfAdapter::enabled(*pdf)) {
+        return new CachingBatchPdf(pdf, obs);
     } else {
         if (verb) {
             CombineLogger::instance().log("CachingNLL.cc",__LINE__,std::string(Form("I don't have an optimized implementation for %s (%s)",pdf->ClassName(),pdf->GetName())),__func__);
@@ -521,6 +576,7 @@ void
 cacheutils::CachingAddNLL::setup_() 
 {
     fastExit_ = !runtimedef::get("NO_ADDNLL_FASTEXIT");
+    profileName_ = profiler::intern(std::string("CachingAddNLL:") + pdf_->GetName());
     for (int i = 0, n = integrals_.size(); i < n; ++i) delete integrals_[i];
     integrals_.clear(); pdfs_.clear(); coeffs_.clear(); prods_.clear();
     RooAddPdf *addpdf = 0;
@@ -573,6 +629,25 @@ cacheutils::CachingAddNLL::setup_()
         throw std::invalid_argument(errmsg);
     }
 
+    normBank_.reset(); normIndex_.assign(coeffs_.size(), -1);
+    static bool normBank = runtimedef::get("ADDNLL_NORMBANK");
+    if (normBank) {
+        std::vector<const ProcessNormalization *> norms(coeffs_.size(), nullptr);
+        int nnorms = 0;
+        for (unsigned int i = 0, n = coeffs_.size(); i < n; ++i) {
+            if (typeid(*coeffs_[i]) == typeid(ProcessNormalization)) { norms[i] = static_cast<const ProcessNormalization *>(coeffs_[i]); ++nnorms; }
+        }
+        if (nnorms > 1) {
+            normBank_.reset(new ProcessNormalizationBank());
+            for (unsigned int i = 0, n = coeffs_.size(); i < n; ++i) {
+                if (norms[i]) normIndex_[i] = normBank_->add(*norms[i]);
+            }
+            if (runtimedef::get("ADDNLL_VERBOSE_CACHING")) {
+                CombineLogger::instance().log("CachingNLL.cc",__LINE__,std::string(Form("Evaluating %d of %d normalizations of %s together, with %u distinct inputs", nnorms, int(coeffs_.size()), pdf_->GetName(), normBank_->inputs())),__func__);
+            }
+        }
+    }
+
     std::unique_ptr<RooArgSet> params(pdf_->getParameters(*data_));
     for (RooAbsArg *a : *params) {
         if (dynamic_cast<RooRealVar *>(a))  params_.add(*a);
@@ -602,6 +677,7 @@ cacheutils::CachingAddNLL::setIncludeZeroWeights(bool includeZeroWeights)
 Double_t 
 cacheutils::CachingAddNLL::evaluate() const 
 {
+    PROFILE_SCOPE(profileName_);
 #ifdef DEBUG_CACHE
     PerfCounter::add("CachingAddNLL::evaluate called");
 #endif
@@ -614,10 +690,12 @@ cacheutils::CachingAddNLL::evaluate() const
     std::vector<Double_t>::iterator       its, bgs = partialSum_.begin(), eds = partialSum_.end();
     double sumCoeff = 0;
     bool allBasicIntegralsOk = (basicIntegrals_ == 1);
+    if (normBank_) normBank_->update();
     //std::cout << "Performing evaluation of " << GetName() << std::endl;
     for ( ; itc != edc; ++itp, ++itc ) {
         // get coefficient
-        Double_t coeff = (*itc)->getVal();
+        int inorm = normIndex_[itc - coeffs_.begin()];
+        Double_t coeff = (inorm >= 0 ? normBank_->value(inorm) : (*itc)->getVal());
         if (isRooRealSum_ && basicIntegrals_ < 2) {
             sumCoeff += coeff * integrals_[itc - coeffs_.begin()]->getVal();
             //std::cout << "  coefficient = " << coeff << ", integral = " << integrals_[itc - coeffs_.begin()]->getVal() << std::endl;
@@ -806,6 +884,30 @@ cacheutils::CachingAddNLL::setData(const RooAbsData &data)
     propagateData();
 }
 
+bool
+cacheutils::CachingAddNLL::isBinned() const
+{
+    // weights_ and binWidths_ must also be aligned, i.e. no zero-weight bins have been dropped
+    return canBasicIntegrals_ > 0 && !binWidths_.empty() && (binWidths_.size() == 1 || binWidths_.size() == weights_.size());
+}
+
+double
+cacheutils::CachingAddNLL::saturatedNLL() const
+{
+    // The saturated pdf is the data histogram itself, f_i = n_i / (N w_i), and the
+    // expected yield is N so the extended term vanishes: NLL = - sum_i n_i log(n_i / (N w_i))
+    if (!isBinned()) throw std::logic_error(std::string("CachingAddNLL::saturatedNLL called for non-binned channel ") + GetName());
+    if (sumWeights_ <= 0) return 0.;
+    DefaultAccumulator<double> ret = 0;
+    for (unsigned int i = 0, n = weights_.size(); i < n; ++i) {
+        double w = weights_[i];
+        if (w <= 0) continue;
+        double width = binWidths_.size() > 1 ? binWidths_[i] : binWidths_.front();
+        ret -= w * log(w / (sumWeights_ * width));
+    }
+    return ret.sum();
+}
+
 void cacheutils::CachingAddNLL::propagateData() {
     for (auto const& funci : pdfs_) {
         if ( auto pdf = dynamic_cast<CMSHistErrorPropagator const*>(funci->pdf()); pdf != nullptr ) {
@@ -898,7 +1000,7 @@ cacheutils::CachingSimNLL::setup_()
     static bool verb  = runtimedef::get("ADDNLL_VERBOSE_CACHING");
 
     RooArgList constraints;
-    factorizedPdf_.reset(dynamic_cast<RooSimultaneous *>(utils::factorizePdf(*dataOriginal_->get(), *pdfclone, constraints)));
+    factorizedPdf_.reset(dynamic_cast<RooSimultaneous *>(FactorizationCache::factorizePdf(*dataOriginal_->get(), *pdfclone, constraints)));
 
     RooSimultaneous *simpdf = factorizedPdf_.get();
     constrainPdfs_.clear(); 
@@ -1022,6 +1124,7 @@ cacheutils::CachingSimNLL::setup_()
 Double_t 
 cacheutils::CachingSimNLL::evaluate() const 
 {
+    PROFILE_SCOPE("CachingSimNLL::evaluate");
     // LAUNCH_FUNCTION_TIMER(__timer__, __token__)
     TRACE_POINT(params_)
 #ifdef TRACE_NLL_EVAL_COUNT
@@ -1243,6 +1346,89 @@ void cacheutils::CachingSimNLL::setAnalyticBarlowBeeston(bool flag) {
     }
 }
 
+std::vector<std::string> cacheutils::CachingSimNLL::binnedChannels() const {
+    std::vector<std::string> ret;
+    for (const CachingAddNLL *canll : pdfs_) {
+        if (canll != 0 && canll->isBinned()) ret.push_back(canll->GetName());
+    }
+    return ret;
+}
+
+double cacheutils::CachingSimNLL::saturatedNLL(const std::vector<std::string> &channels) const {
+    DefaultAccumulator<double> ret = 0;
+    for (int ib = 0, nb = pdfs_.size(); ib < nb; ++ib) {
+        const CachingAddNLL *canll = pdfs_[ib];
+        if (canll == 0) continue;
+        if (!channelMasks_.empty() && channelMasks_[ib]->getVal() != 0.) continue;
+        if (!internalMasks_.empty() && !internalMasks_[ib]) continue;
+        if (std::find(channels.begin(), channels.end(), canll->GetName()) == channels.end()) continue;
+        ret += canll->saturatedNLL();
+    }
+    return ret.sum();
+}
+
+std::vector<std::vector<unsigned int> > cacheutils::CachingSimNLL::termsDependingOn(const RooArgList &params) const {
+    std::vector<std::vector<unsigned int> > ret(params.getSize());
+    std::unordered_map<const RooAbsArg *, unsigned int> index;
+    for (int i = 0, n = params.getSize(); i < n; ++i) index[params.at(i)] = i;
+    unsigned int term = 0;
+    auto addTerm = [&](const RooAbsCollection &deps) {
+        for (RooAbsArg *a : deps) {
+            auto found = index.find(a);
+            if (found != index.end()) ret[found->second].push_back(term);
+        }
+        ++term;
+    };
+    for (CachingAddNLL *canll : pdfs_) {
+        if (canll != 0) addTerm(canll->params()); else ++term;
+    }
+    for (RooAbsPdf *pdf : constrainPdfs_) {
+        std::unique_ptr<RooArgSet> deps(pdf->getParameters(*dataOriginal_));
+        addTerm(*deps);
+    }
+    for (SimpleGaussianConstraint *pdf : constrainPdfsFast_) {
+        std::unique_ptr<RooArgSet> deps(pdf->getParameters(*dataOriginal_));
+        addTerm(*deps);
+    }
+    for (SimplePoissonConstraint *pdf : constrainPdfsFastPoisson_) {
+        std::unique_ptr<RooArgSet> deps(pdf->getParameters(*dataOriginal_));
+        addTerm(*deps);
+    }
+    return ret;
+}
+
+double cacheutils::CachingSimNLL::evaluateTerms(const std::vector<unsigned int> &terms) const {
+    static bool gentleNegativePenalty_ = runtimedef::get("GENTLE_LEE");
+    // same as in evaluate(), for the chosen terms only
+    DefaultAccumulator<double> ret = 0;
+    unsigned int nchannels = pdfs_.size(), ngeneric = constrainPdfs_.size(), nfast = constrainPdfsFast_.size();
+    for (unsigned int term : terms) {
+        if (term < nchannels) {
+            if (pdfs_[term] == 0) continue;
+            if (!channelMasks_.empty() && channelMasks_[term]->getVal() != 0.) continue;
+            if (!internalMasks_.empty() && !internalMasks_[term]) continue;
+            ret += pdfs_[term]->getVal();
+            continue;
+        }
+        if (maskConstraints_) continue;
+        term -= nchannels;
+        if (term < ngeneric) {
+            double pdfval = constrainPdfs_[term]->getVal(nuis_);
+            if (!std::isnormal(pdfval) || pdfval <= 0) {
+                if (gentleNegativePenalty_) { ret += 25; continue; }
+                pdfval = 1e-9;
+            }
+            ret += -(log(pdfval) + constrainZeroPoints_[term]);
+        } else if ((term -= ngeneric) < nfast) {
+            ret += -(constrainPdfsFast_[term]->getLogValFast() + constrainZeroPointsFast_[term]);
+        } else {
+            term -= nfast;
+            ret += -(constrainPdfsFastPoisson_[term]->getLogValFast() + constrainZeroPointsFastPoisson_[term]);
+        }
+    }
+    return ret.sum();
+}
+
 // ROOT 6.26 changed the signature of getParameters to avoid heap allocation,
 // and especially returning an owning pointer that people tend to forget to
 // delete.
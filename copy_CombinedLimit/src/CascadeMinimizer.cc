@@ -5,9 +5,12 @@
 #include "../interface/utils.h"
 #include "../interface/ProfilingTools.h"
 #include "../interface/CombineLogger.h"
+#include "../interface/SequentialMinimizer.h"
 
 #include <Math/MinimizerOptions.h>
 #include <Math/IOptions.h>
+#include <Math/GenAlgoOptions.h>
+#include <Fit/Fitter.h>
 #include <RooCategory.h>
 #include <RooNumIntConfig.h>
 #include <TStopwatch.h>
@@ -37,6 +40,35 @@ double CascadeMinimizer::defaultMinimizerTolerance_=1e-1;
 double CascadeMinimizer::defaultMinimizerPrecision_=-1.0;
 int  CascadeMinimizer::strategy_=1; 
 
+namespace {
+    /// the channels and constraints of a CachingSimNLL, as the terms of the function minimized by the SequentialMinimizer
+    class SimNLLTerms : public cmsmath::SeparableFunction {
+        public:
+            SimNLLTerms(cacheutils::CachingSimNLL &nll) : nll_(nll) {}
+            bool terms(const std::vector<std::string> &params, std::vector<std::vector<unsigned int> > &terms) override {
+                std::unique_ptr<RooArgSet> all(nll_.getParameters((const RooArgSet *)nullptr));
+                RooArgList vars;
+                vars_.clear();
+                for (const std::string &name : params) {
+                    RooRealVar *var = dynamic_cast<RooRealVar *>(all->find(name.c_str()));
+                    if (var == nullptr) return false;
+                    vars_.push_back(var);
+                    vars.add(*var);
+                }
+                terms = nll_.termsDependingOn(vars);
+                return true;
+            }
+            void set(unsigned int ipar, double x) override { vars_[ipar]->setVal(x); }
+            double evalTerms(const std::vector<unsigned int> &terms) override {
+                double ret = nll_.evaluateTerms(terms);
+                return std::isfinite(ret) ? ret : std::numeric_limits<double>::infinity();
+            }
+        private:
+            cacheutils::CachingSimNLL &nll_;
+            std::vector<RooRealVar *> vars_;
+    };
+}
+
 std::map<std::string,std::vector<std::string> > const CascadeMinimizer::minimizerAlgoMap_{
  {"Minuit"	 ,{"Migrad","Simplex","Combined","Scan"}}
 ,{"Minuit2" 	 ,{"Migrad","Simplex","Combined","Scan"}}
@@ -91,6 +123,7 @@ void CascadeMinimizer::setAutoMax(const RooArgSet *pois)
 
 bool CascadeMinimizer::improve(int verbose, bool cascade, bool forceResetMinimizer) 
 {
+    PROFILE_SCOPE("CascadeMinimizer::improve");
     cacheutils::CachingSimNLL *simnllbb = dynamic_cast<cacheutils::CachingSimNLL *>(&nll_);
     if (simnllbb && !runtimedef::get(std::string("MINIMIZER_no_analytic"))) {
       simnllbb->setAnalyticBarlowBeeston(true);
@@ -167,8 +200,22 @@ bool CascadeMinimizer::improveOnce(int verbose, bool noHesse)
     bool outcome = false;
     double tol = ROOT::Math::MinimizerOptions::DefaultTolerance();
     static int maxcalls = runtimedef::get("MINIMIZER_MaxCalls");
+    static bool seqMinimizerBlocks = runtimedef::get("SeqMinimizer_blocks");
     if (!minimizer_.get()) remakeMinimizer();
 
+    // let the SequentialMinimizer evaluate only the channels and constraints that depend on each parameter
+    std::unique_ptr<SimNLLTerms> simnllTerms;
+    cacheutils::CachingSimNLL *simnllForTerms = dynamic_cast<cacheutils::CachingSimNLL *>(&nll_);
+    if (seqMinimizerBlocks && simnllForTerms && myType == "SeqMinimizer") {
+        simnllTerms.reset(new SimNLLTerms(*simnllForTerms));
+        // passed with the options of this minimizer, so that no other minimization picks it up
+        ROOT::Math::MinimizerOptions &opts = minimizer_->fitter()->Config().MinimizerOptions();
+        ROOT::Math::GenAlgoOptions extra;
+        if (const ROOT::Math::GenAlgoOptions *old = dynamic_cast<const ROOT::Math::GenAlgoOptions *>(opts.ExtraOptions())) extra = *old;
+        extra.SetIntValue("SeparableFunction", simnllTerms->id());
+        opts.SetExtraOptions(extra);
+    }
+
     // freeze non active parameters if MINIMIZER_freezeDisassociatedParams enabled
     freezeDiscParams(true);
 
@@ -224,6 +271,7 @@ bool CascadeMinimizer::improveOnce(int verbose, bool noHesse)
 
 
 bool CascadeMinimizer::minos(const RooArgSet & params , int verbose ) {
+    PROFILE_SCOPE("CascadeMinimizer::minos");
    
    cacheutils::CachingSimNLL *simnllbb = dynamic_cast<cacheutils::CachingSimNLL *>(&nll_);
    if (simnllbb && !runtimedef::get(std::string("MINIMIZER_no_analytic"))) {
@@ -274,6 +322,7 @@ bool CascadeMinimizer::minos(const RooArgSet & params , int verbose ) {
 }
 
 bool CascadeMinimizer::hesse(int verbose ) {
+   PROFILE_SCOPE("CascadeMinimizer::hesse");
    
    cacheutils::CachingSimNLL *simnllbb = dynamic_cast<cacheutils::CachingSimNLL *>(&nll_);
    if (simnllbb && !runtimedef::get(std::string("MINIMIZER_no_analytic"))) {
@@ -372,6 +421,7 @@ bool CascadeMinimizer::iterativeMinimize(double &minimumNLL,int verbose, bool ca
 
 bool CascadeMinimizer::minimize(int verbose, bool cascade) 
 {
+    PROFILE_SCOPE("CascadeMinimizer::minimize");
     static int optConst = runtimedef::get("MINIMIZER_optimizeConst");
     static int rooFitOffset = runtimedef::get("MINIMIZER_rooFitOffset");
     if (runtimedef::get("CMIN_CENSURE")) {
@@ -837,6 +887,17 @@ void CascadeMinimizer::applyOptions(const boost::program_options::variables_map
     //if (vm.count("cminDefaultIntegratorNDOpen")) setDefaultIntegrator(RooAbsReal::defaultIntegratorConfig()->methodNDOpen(), vm["cminDefaultIntegratorNDOpen"].as<std::string>());
 }
 
+std::string CascadeMinimizer::optionsString()
+{
+    std::string ret = Form("type=%s algo=%s tolerance=%g precision=%g strategy=%d", defaultMinimizerType_.c_str(), defaultMinimizerAlgo_.c_str(),
+                           defaultMinimizerTolerance_, defaultMinimizerPrecision_, strategy_);
+    for (const Algo &fall : fallbacks_) ret += Form(" fallback=%s,%s,%d:%g", fall.type.c_str(), fall.algo.c_str(), fall.strategy, fall.tolerance);
+    ret += Form(" preScan=%d preFit=%d approxPreFit=%g,%d poiOnlyFit=%d singleNuisFit=%d pruning=%g zeroPoint=%d oldFallback=%d",
+                preScan_, preFit_, approxPreFitTolerance_, approxPreFitStrategy_, poiOnlyFit_, singleNuisFit_, nuisancePruningThreshold_, setZeroPoint_, oldFallback_);
+    ret += Form(" hesse=%d,%d storage=%d discreteTol=%g shortCombinations=%d", firstHesse_, lastHesse_, minuit2StorageLevel_, discreteMinTol_, runShortCombinations);
+    return ret;
+}
+
 //void CascadeMinimizer::setDefaultIntegrator(RooCategory &cat, const std::string & val) {
 //    if (val == "list") {
 //        std::cout << "States for " << cat.GetName() << std::endl;
@@ -0,0 +1,255 @@
+#include "../interface/ChannelBuilder.h"
+#include "../interface/CMSHistFunc.h"
+#include "../interface/CMSHistSum.h"
+#include "../interface/ProcessNormalization.h"
+#include "../interface/SimpleGaussianConstraint.h"
+
+#include <cmath>
+#include <stdexcept>
+#include "Math/ProbFuncMathCore.h"
+#include "RooArgList.h"
+#include "RooArgSet.h"
+#include "RooConstVar.h"
+#include "RooGaussian.h"
+#include "RooGlobalFunc.h"
+#include "RooPoisson.h"
+#include "RooProduct.h"
+#include "RooRealVar.h"
+#include "RooWorkspace.h"
+#include "TH1F.h"
+#include "TMath.h"
+#include "TString.h"
+
+ChannelBuilder::ChannelBuilder(RooWorkspace &w, const std::string &channel, const std::string &prop, RooRealVar &x, int bins, bool optimizeBins) :
+    w_(w), channel_(channel), prop_(prop), x_(x), bins_(bins), optimizeBins_(optimizeBins)
+{
+}
+
+ChannelBuilder::~ChannelBuilder()
+{
+}
+
+ChannelBuilder::Process & ChannelBuilder::process(const std::string &name)
+{
+    for (Process &p : processes_) {
+        if (p.name == name) return p;
+    }
+    throw std::invalid_argument("ChannelBuilder: process "+name+" was not added to channel "+channel_);
+}
+
+RooAbsReal & ChannelBuilder::arg(const std::string &name) const
+{
+    RooAbsReal *ret = dynamic_cast<RooAbsReal *>(w_.arg(name.c_str()));
+    if (ret == 0) throw std::invalid_argument("ChannelBuilder: no function or variable "+name+" in the workspace (channel "+channel_+")");
+    return *ret;
+}
+
+std::unique_ptr<TH1> ChannelBuilder::padded(const TH1 &hist) const
+{
+    int bins = optimizeBins_ ? bins_ : hist.GetNbinsX();
+    std::unique_ptr<TH1> ret(new TH1F((std::string(hist.GetName())+"_rebin").c_str(), "", bins, 0., double(bins)));
+    ret->SetDirectory(0);
+    for (int i = 1, n = std::min(hist.GetNbinsX(), bins); i <= n; ++i) {
+        ret->SetBinContent(i, hist.GetBinContent(i));
+        ret->SetBinError(i, hist.GetBinError(i));
+    }
+    return ret;
+}
+
+void ChannelBuilder::addProcess(const std::string &process, const std::string &func, const std::string &norm, bool signal, double rate, const TH1 &nominal, bool logVertical)
+{
+    processes_.push_back(Process());
+    Process &p = processes_.back();
+    p.name = process; p.func = func; p.norm = norm;
+    p.signal = signal; p.logVertical = logVertical;
+    p.rate = rate;
+    p.integral = nominal.Integral();
+    if (p.integral == 0) throw std::runtime_error("Null norm for channel "+channel_+", process "+process);
+    p.originalBins = nominal.GetNbinsX();
+    p.nominal = padded(nominal);
+}
+
+void ChannelBuilder::addLogNormal(const std::string &process, double kappa, const std::string &theta)
+{
+    this->process(process).logNormals.emplace_back(kappa, theta);
+}
+
+void ChannelBuilder::addAsymmLogNormal(const std::string &process, double kappaLo, double kappaHi, const std::string &theta)
+{
+    this->process(process).asymmLogNormals.emplace_back(std::make_pair(kappaLo, kappaHi), theta);
+}
+
+void ChannelBuilder::addFactor(const std::string &process, const std::string &factor)
+{
+    this->process(process).factors.push_back(factor);
+}
+
+void ChannelBuilder::addShape(const std::string &process, const std::string &theta, double scale, const TH1 &up, const TH1 &down)
+{
+    Process &p = this->process(process);
+    p.shapes.push_back(Shape());
+    Shape &s = p.shapes.back();
+    s.theta = theta;
+    s.scale = scale;
+    s.kappaHi = up.Integral();
+    s.kappaLo = down.Integral();
+    if (!(s.kappaHi > 0)) throw std::runtime_error(Form("Bogus norm %g for channel %s, process %s, systematic %s Up", s.kappaHi, channel_.c_str(), process.c_str(), theta.c_str()));
+    if (!(s.kappaLo > 0)) throw std::runtime_error(Form("Bogus norm %g for channel %s, process %s, systematic %s Down", s.kappaLo, channel_.c_str(), process.c_str(), theta.c_str()));
+    s.kappaHi /= p.integral;
+    s.kappaLo /= p.integral;
+    s.originalBins = std::max(up.GetNbinsX(), down.GetNbinsX());
+    s.up = padded(up);
+    s.down = padded(down);
+}
+
+void ChannelBuilder::setAutoMCStats(double threshold, bool includeSignal, int histMode, bool optimizedGaussians, bool optimizeBounds)
+{
+    threshold_ = threshold;
+    includeSignal_ = includeSignal;
+    histMode_ = histMode;
+    optimizedGaussians_ = optimizedGaussians;
+    optimizeBounds_ = optimizeBounds;
+}
+
+void ChannelBuilder::build()
+{
+    // declared so that clients are deleted before their servers, once the workspace has its own copies
+    std::vector<std::unique_ptr<RooAbsArg>> inputs, models;
+    std::unique_ptr<RooArgList> binPars;
+    std::unique_ptr<CMSHistSum> prop;
+    std::vector<std::unique_ptr<RooAbsArg>> constraints;
+
+    RooArgList funcs, coeffs;
+    for (Process &p : processes_) {
+        CMSHistFunc *func = new CMSHistFunc(p.func.c_str(), "", x_, *p.nominal);
+        models.emplace_back(func);
+        if (p.shapes.empty()) {
+            func->prepareStorage();
+            func->setShape(0, 0, 0, 0, *p.nominal);
+            if (optimizeBins_) func->setActiveBins(p.originalBins);
+        } else {
+            RooArgList vmorphs;
+            double smoothRegion = 1;
+            int maxBins = p.originalBins;
+            for (const Shape &s : p.shapes) {
+                if (s.scale == 1) {
+                    vmorphs.add(arg(s.theta));
+                } else {
+                    RooConstVar *scale = new RooConstVar(Form("%g", s.scale), "", s.scale);
+                    RooProduct *scaled = new RooProduct((s.theta+"_scaled_"+channel_+"_"+p.name).c_str(), "", RooArgList(*scale, arg(s.theta)));
+                    inputs.emplace_back(scale);
+                    inputs.emplace_back(scaled);
+                    vmorphs.add(*scaled);
+                    smoothRegion = std::min(smoothRegion, s.scale);
+                }
+                maxBins = std::max(maxBins, s.originalBins);
+            }
+            func->setVerticalMorphs(vmorphs);
+            func->setVerticalType(p.logVertical ? CMSHistFunc::LogQuadLinear : CMSHistFunc::QuadLinear);
+            func->setVerticalSmoothRegion(smoothRegion);
+            func->prepareStorage();
+            func->setShape(0, 0, 0, 0, *p.nominal);
+            for (unsigned int i = 0, n = p.shapes.size(); i < n; ++i) {
+                const Shape &s = p.shapes[i];
+                if (histMode_ == 2) {
+                    func->setShape(0, 0, i + 1, 0, *s.down);
+                    func->setShape(0, 0, i + 1, 1, *s.up);
+                } else if (histMode_ == 1) {
+                    TH1 *lo = s.down.get(), *hi = s.up.get();
+                    std::unique_ptr<TH1> renormLo((TH1 *) lo->Clone()), renormHi((TH1 *) hi->Clone());
+                    renormLo->SetDirectory(0); renormHi->SetDirectory(0);
+                    if (renormLo->Integral() > 0.0) renormLo->Scale(p.nominal->Integral() / renormLo->Integral());
+                    if (renormHi->Integral() > 0.0) renormHi->Scale(p.nominal->Integral() / renormHi->Integral());
+                    func->setShape(0, 0, i + 1, 0, *renormLo);
+                    func->setShape(0, 0, i + 1, 1, *renormHi);
+                }
+            }
+            if (optimizeBins_ && maxBins < bins_) func->setActiveBins(maxBins);
+        }
+
+        RooAbsReal *norm = 0;
+        bool hasShapeNorms = false;
+        for (const Shape &s : p.shapes) {
+            if (std::abs(s.kappaHi - 1) >= 1e-3 || std::abs(s.kappaLo - 1) >= 1e-3) hasShapeNorms = true;
+        }
+        if (p.logNormals.empty() && p.asymmLogNormals.empty() && p.factors.empty() && !hasShapeNorms) {
+            RooRealVar *constNorm = new RooRealVar(p.norm.c_str(), p.norm.c_str(), p.rate);
+            constNorm->setConstant(true);
+            norm = constNorm;
+        } else {
+            ProcessNormalization *procNorm = new ProcessNormalization(p.norm.c_str(), "", p.rate);
+            for (auto &ln : p.logNormals) procNorm->addLogNormal(ln.first, arg(ln.second));
+            for (auto &aln : p.asymmLogNormals) procNorm->addAsymmLogNormal(aln.first.first, aln.first.second, arg(aln.second));
+            // the normalization effects of the templates, in the same order as ShapeBuilder::getExtraNorm
+            for (const Shape &s : p.shapes) {
+                if (std::abs(s.kappaHi - 1) < 1e-3 && std::abs(s.kappaLo - 1) < 1e-3) continue;
+                procNorm->addAsymmLogNormal(std::pow(s.kappaLo, s.scale), std::pow(s.kappaHi, s.scale), arg(s.theta));
+            }
+            for (auto &f : p.factors) procNorm->addOtherFactor(arg(f));
+            norm = procNorm;
+        }
+        models.emplace_back(norm);
+
+        for (RooAbsArg *a : { (RooAbsArg *) func, (RooAbsArg *) norm }) {
+            a->setStringAttribute("combine.process", p.name.c_str());
+            a->setStringAttribute("combine.channel", channel_.c_str());
+            a->setAttribute("combine.signal", p.signal);
+        }
+        if (p.signal && !includeSignal_) func->setAttribute("skipForErrorSum");
+        funcs.add(*func);
+        coeffs.add(*norm);
+    }
+    if (processes_.empty()) throw std::runtime_error("ChannelBuilder: no processes in channel "+channel_);
+
+    prop.reset(new CMSHistSum(prop_.c_str(), "", x_, funcs, coeffs));
+    prop->setAttribute("CachingPdf_NoClone", true);
+    prop->setAttribute("CachingPdf_Direct", true);
+
+    RooArgSet toImport(*prop);
+    binParameters_.clear();
+    if (threshold_ >= 0) {
+        binPars.reset(prop->setupBinPars(threshold_));
+        for (RooAbsArg *a : *binPars) {
+            // as in ShapeBuilder, a Poisson-constrained parameter may come as the RooProduct <var>_prod of
+            // the parameter and a constant: the constraint is then made on the underlying RooRealVar
+            std::string n = a->GetName();
+            RooRealVar *par = dynamic_cast<RooRealVar *>(a);
+            if (!par && n.size() > 5 && n.compare(n.size() - 5, 5, "_prod") == 0) {
+                par = dynamic_cast<RooRealVar *>(a->findServer(n.substr(0, n.size() - 5).c_str()));
+            }
+            if (!par) throw std::logic_error("ChannelBuilder: bin parameter "+n+" is not a RooRealVar");
+            binParameters_.push_back(n);
+            RooAbsPdf *pdf = 0;
+            RooRealVar *gobs = 0;
+            if (par->getAttribute("createGaussianConstraint")) {
+                gobs = new RooRealVar((n+"_In").c_str(), (n+"_In").c_str(), 0, -7, 7);
+                RooConstVar *sigma = new RooConstVar("1", "", 1.0);
+                inputs.emplace_back(gobs);
+                inputs.emplace_back(sigma);
+                if (optimizedGaussians_) pdf = new SimpleGaussianConstraint((n+"_Pdf").c_str(), "", *par, *gobs, *sigma);
+                else                     pdf = new RooGaussian((n+"_Pdf").c_str(), "", *par, *gobs, *sigma);
+                par->setVal(0);
+                par->setError(1);
+                if (optimizeBounds_) par->setAttribute("optimizeBounds");
+            } else if (par->getAttribute("createPoissonConstraint")) {
+                // the same range of the observed value as for the constraints made by text2workspace
+                double nom = par->getVal(), pval = ROOT::Math::normal_cdf_c(7);
+                double minObs = nom, maxObs = nom + 2;
+                while (minObs > 0 && TMath::Poisson(minObs, nom + 1) > pval) minObs -= (nom > 10 ? std::sqrt(nom) : 1);
+                while (TMath::Poisson(maxObs, nom + 1) > pval) maxObs += (nom > 10 ? std::sqrt(nom) : 2);
+                gobs = new RooRealVar((n+"_In").c_str(), (n+"_In").c_str(), std::floor(nom), minObs, maxObs);
+                inputs.emplace_back(gobs);
+                pdf = new RooPoisson((n+"_Pdf").c_str(), "", *gobs, *par, true);
+            } else {
+                throw std::logic_error("ChannelBuilder: bin parameter "+n+" has no constraint type");
+            }
+            gobs->setConstant(true);
+            constraints.emplace_back(pdf);
+            toImport.add(*pdf);
+        }
+    }
+
+    if (w_.import(toImport, RooFit::RecycleConflictNodes(), RooFit::Silence())) {
+        throw std::runtime_error("ChannelBuilder: failed to import the model of channel "+channel_+" in the workspace");
+    }
+}
@@ -66,42 +66,27 @@ bool ChannelCompatibilityCheck::runSpecific(RooWorkspace *w, RooStats::ModelConf
   RooSimultaneous *sim = dynamic_cast<RooSimultaneous *>(mc_s->GetPdf());
   if (sim == 0) throw std::logic_error("Cannot use ChannelCompatibilityCheck if the pdf is not a RooSimultaneous");
 
-  RooAbsCategoryLValue *cat = (RooAbsCategoryLValue *) sim->indexCat().Clone();
-  int nbins = cat->numBins((const char *)0);
-  TString satname = TString::Format("%s_freeform", sim->GetName());
-  std::unique_ptr<RooSimultaneous> newsim((typeid(*sim) == typeid(RooSimultaneousOpt)) ? new RooSimultaneousOpt(satname, "", *cat) : new RooSimultaneous(satname, "", *cat)); 
-  std::map<std::string,std::string> rs;
-  RooArgList minosVars, minosOneVar; if (runMinos_) minosOneVar.add(*r);
-  for (int ic = 0, nc = nbins; ic < nc; ++ic) {
-      cat->setBin(ic);
-      RooAbsPdf *pdfi = sim->getPdf(cat->getLabel());
-      if (pdfi == 0) continue;
-      RooCustomizer customizer(*pdfi, "freeform");
-      std::string label = nameForLabel(cat->getLabel());
-      TString riName = TString::Format("_ChannelCompatibilityCheck_%s_%s", r->GetName(), label.c_str());
-      rs.insert(std::pair<std::string,std::string>(label, riName.Data()));
-      std::pair<double,double> range = {r->getMin(),r->getMax()};
-      if (groupRanges_.find(TString(label)) != groupRanges_.end()) range = groupRanges_[label];
-      if (w->var(riName) == 0) {
-        w->factory(TString::Format("%s[%g,%g]", riName.Data(), range.first, range.second));
-      }
-      customizer.replaceArg(*r, *w->var(riName));
-      newsim->addPdf((RooAbsPdf&)*customizer.build(), cat->getLabel());
-      if (runMinos_ && !minosVars.find(riName)) minosVars.add(*w->var(riName));
-  }
+  if (freeformOf_ != sim) buildFreeForm(w, *sim, *r);
+  RooArgList minosOneVar; if (runMinos_) minosOneVar.add(*r);
 
   CloseCoutSentry sentry(verbose < 2);
   const RooCmdArg &constCmdArg = withSystematics  ? RooFit::Constrain(*mc_s->GetNuisanceParameters()) : RooFit::NumCPU(1); // use something dummy 
-  std::unique_ptr<RooFitResult> result_nominal (doFit(   *sim, data, minosOneVar, constCmdArg, runMinos_)); // let's run Hesse if we want to run Minos
+  // each fit gets back its own nll, which doFit only re-creates if it can't just swap the dataset
+  nll = std::move(nllNominal_);
+  std::unique_ptr<RooFitResult> result_nominal (doFit(   *sim, data, minosOneVar, constCmdArg, runMinos_, 1, dynamic_cast<cacheutils::CachingSimNLL*>(nll.get()) != 0)); // let's run Hesse if we want to run Minos
   if (dynamic_cast<cacheutils::CachingSimNLL*>(nll.get())) {
     static_cast<cacheutils::CachingSimNLL*>(nll.get())->clearConstantZeroPoint();
   }
   double nll_nominal   = nll->getVal();
-  std::unique_ptr<RooFitResult> result_freeform(doFit(*newsim, data, minosVars,   constCmdArg, runMinos_));
+  nllNominal_ = std::move(nll);
+  nll = std::move(nllFreeform_);
+  std::unique_ptr<RooFitResult> result_freeform(doFit(*freeform_, data, minosVars_,   constCmdArg, runMinos_, 1, dynamic_cast<cacheutils::CachingSimNLL*>(nll.get()) != 0));
   if (dynamic_cast<cacheutils::CachingSimNLL*>(nll.get())) {
     static_cast<cacheutils::CachingSimNLL*>(nll.get())->clearConstantZeroPoint();
   }
   double nll_freeform   = nll->getVal();
+  nllFreeform_ = std::move(nll);
+  if (protectUnbinnedChannels_) { nllNominal_.reset(); nllFreeform_.reset(); }
   sentry.clear();
 
   if (result_nominal.get()  == 0) return false;
@@ -127,7 +112,7 @@ bool ChannelCompatibilityCheck::runSpecific(RooWorkspace *w, RooStats::ModelConf
 	  printf("Nominal fit  : %s = %7.4f  +/- %6.4f\n", r->GetName(), rNominal->getVal(), rNominal->getError());
       }
   }
-  for (std::map<std::string,std::string>::const_iterator it = rs.begin(), ed = rs.end(); it != ed; ++it) {
+  for (std::map<std::string,std::string>::const_iterator it = rs_.begin(), ed = rs_.end(); it != ed; ++it) {
       RooRealVar *ri = (RooRealVar*) result_freeform->floatParsFinal().find(it->second.c_str());
       if (ri == NULL){
       printf("Parameter %s not found in channel %s. Does this region contain signal templates?\n", r->GetName(), it->first.c_str());
@@ -150,6 +135,38 @@ bool ChannelCompatibilityCheck::runSpecific(RooWorkspace *w, RooStats::ModelConf
   return true;
 }
 
+void ChannelCompatibilityCheck::buildFreeForm(RooWorkspace *w, RooSimultaneous &sim, RooRealVar &r) {
+  // the nlls refer to the old model, so they go first
+  nllNominal_.reset(); nllFreeform_.reset();
+  freeform_.reset();
+  rs_.clear();
+  minosVars_.removeAll();
+
+  freeformCat_.reset((RooAbsCategoryLValue *) sim.indexCat().Clone());
+  RooAbsCategoryLValue *cat = freeformCat_.get();
+  int nbins = cat->numBins((const char *)0);
+  TString satname = TString::Format("%s_freeform", sim.GetName());
+  freeform_.reset((typeid(sim) == typeid(RooSimultaneousOpt)) ? new RooSimultaneousOpt(satname, "", *cat) : new RooSimultaneous(satname, "", *cat)); 
+  for (int ic = 0, nc = nbins; ic < nc; ++ic) {
+      cat->setBin(ic);
+      RooAbsPdf *pdfi = sim.getPdf(cat->getLabel());
+      if (pdfi == 0) continue;
+      RooCustomizer customizer(*pdfi, "freeform");
+      std::string label = nameForLabel(cat->getLabel());
+      TString riName = TString::Format("_ChannelCompatibilityCheck_%s_%s", r.GetName(), label.c_str());
+      rs_.insert(std::pair<std::string,std::string>(label, riName.Data()));
+      std::pair<double,double> range = {r.getMin(),r.getMax()};
+      if (groupRanges_.find(TString(label)) != groupRanges_.end()) range = groupRanges_[label];
+      if (w->var(riName) == 0) {
+        w->factory(TString::Format("%s[%g,%g]", riName.Data(), range.first, range.second));
+      }
+      customizer.replaceArg(r, *w->var(riName));
+      freeform_->addPdf((RooAbsPdf&)*customizer.build(), cat->getLabel());
+      if (runMinos_ && !minosVars_.find(riName)) minosVars_.add(*w->var(riName));
+  }
+  freeformOf_ = &sim;
+}
+
 std::string ChannelCompatibilityCheck::nameForLabel(const char *label)
 {
     std::string ret(label);
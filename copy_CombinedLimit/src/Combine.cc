@@ -25,6 +25,7 @@
 #include <TSystem.h>
 #include <TStopwatch.h>
 #include <TTree.h>
+#include <TLeaf.h>
 #include <TInterpreter.h>
 
 #include <RooAbsData.h>
@@ -64,6 +65,8 @@
 #include "../interface/CMSHistSum.h"
 
 #include "../interface/CombineLogger.h"
+#include "../interface/FactorizationCache.h"
+#include "../interface/ResultStore.h"
 
 using namespace RooStats;
 using namespace RooFit;
@@ -86,6 +89,8 @@ float cl = 0.95;
 bool bypassFrequentistFit_ = false;
 bool g_fillTree_ = true;
 TTree *Combine::tree_ = 0;
+std::unique_ptr<ResultStoreWriter> Combine::resultStore_;
+int Combine::resultStoreBranches_ = 0;
 
 std::string setPhysicsModelParameterExpression_ = "";
 std::string setPhysicsModelParameterRangeExpression_ = "";
@@ -150,6 +155,8 @@ Combine::Combine() :
 
       ("validateModel,V", "Perform some sanity checks on the model and abort if they fail.")
       ("saveToys",   "Save results of toy MC in output file")
+      ("resultStore", po::value<std::string>(&resultStoreFile_)->default_value(""), "Also write the entries of the output tree to this file in a columnar, append-only format that can be merged with cat and mapped in memory (see interface/ResultStore.h and python/ResultStore.py)")
+      ("asimovCacheDir", po::value<std::string>(&asimovCacheDir_)->default_value(""), "Keep the Asimov datasets in this directory, and reuse those made by other jobs for the same model, parameters, data and minimizer options")
       ("floatAllNuisances", po::value<bool>(&floatAllNuisances_)->default_value(false), "Make all nuisance parameters floating")
       ("floatParameters", po::value<string>(&floatNuisances_)->default_value(""), "Set these parameters floating(note freeze will take priority over float), also accepts regexp with syntax 'rgx{<my regexp>}' or 'var{<my regexp>}'")
       ("freezeAllGlobalObs", po::value<bool>(&freezeAllGlobalObs_)->default_value(true), "Make all global observables constant")
@@ -159,6 +166,7 @@ Combine::Combine() :
       ("noMCbonly", po::value<bool>(&noMCbonly_)->default_value(false), "Don't create a background-only modelConfig")
       ("noDefaultPrior", po::value<bool>(&noDefaultPrior_)->default_value(false), "Don't create a default uniform prior")
       ("rebuildSimPdf", po::value<bool>(&rebuildSimPdf_)->default_value(false), "Rebuild simultaneous pdf from scratch to make sure constraints are correct (not needed in CMS workspaces)")
+      ("setupCache", po::value<std::string>(&setupCacheDir_)->default_value(""), "Directory where to keep the factorization of the model into observable-dependent terms and constraints, keyed by a hash of the structure of the model, so that later jobs on the same model can skip it (default = none)")
       ("compile", "Compile expressions instead of interpreting them")
       ("tempDir", po::value<bool>(&makeTempDir_)->default_value(false), "Run the program from a temporary directory (automatically on for text datacards or if 'compile' is activated)")
       ("guessGenMode", "Guess whether to generate binned or unbinned based on dataset")
@@ -398,6 +406,10 @@ void Combine::run(TString hlfFile, const std::string &dataset, double &limit, do
 
 
     if (verbose > 3) { std::cout << "Input workspace '" << workspaceName_ << "': \n"; w->Print("V"); }
+    if (!setupCacheDir_.empty()) {
+      FactorizationCache::setDirectory(setupCacheDir_);
+      FactorizationCache::setWorkspace(workspaceName_);
+    }
     RooRealVar *MH = w->var("MH");
     if (MH!=0) {
       if (verbose > 2) std::cerr << "Setting variable 'MH' in workspace to the mass " << mass_ << std::endl;
@@ -805,6 +817,14 @@ void Combine::run(TString hlfFile, const std::string &dataset, double &limit, do
   addPOI(POI);
 
   tree_ = tree;
+  // the result store is closed when leaving run(), also on early returns and exceptions
+  struct ResultStoreGuard { ~ResultStoreGuard() { closeResultStore(); } } resultStoreGuard;
+  if (!resultStoreFile_.empty()) {
+      resultStore_.reset(new ResultStoreWriter(resultStoreFile_));
+      resultStoreBranches_ = 0;
+  }
+  asimovutils::setCacheDir(asimovCacheDir_);
+  asimovutils::clearCache();
 
   // Set up additional branches
   addBranches(trackParametersNameString_,w,trackedParametersMap_,"Param");
@@ -1154,10 +1174,49 @@ void Combine::commitPoint(bool expected, float quantile) {
       it.second = (it.first)->getError();
     }
 
-    if (g_fillTree_) tree_->Fill();
+    if (g_fillTree_) {
+        tree_->Fill();
+        if (resultStore_) {
+            if (resultStoreBranches_ != tree_->GetNbranches()) bindResultStore();
+            resultStore_->fill();
+        }
+    }
     g_quantileExpected_ = saveQuantile;
 }
 
+void Combine::bindResultStore() {
+    resultStore_->clearColumns();
+    resultStoreBranches_ = tree_->GetNbranches();
+    for (TObject *obj : *tree_->GetListOfBranches()) {
+        TBranch *branch = static_cast<TBranch *>(obj);
+        TLeaf *leaf = branch->GetListOfLeaves()->GetEntries() == 1 ? static_cast<TLeaf *>(branch->GetListOfLeaves()->At(0)) : nullptr;
+        char type = 0;
+        if (leaf && leaf->GetLenStatic() == 1 && leaf->GetLeafCount() == nullptr) {
+            std::string typeName = leaf->GetTypeName();
+            if      (typeName == "Double_t")  type = 'D';
+            else if (typeName == "Float_t")   type = 'F';
+            else if (typeName == "Int_t")     type = 'I';
+            else if (typeName == "UInt_t")    type = 'i';
+            else if (typeName == "Long64_t")  type = 'L';
+            else if (typeName == "ULong64_t") type = 'l';
+            else if (typeName == "Bool_t")    type = 'O';
+        }
+        if (type == 0 || leaf->GetValuePointer() == nullptr) {
+            if (verbose > 0) CombineLogger::instance().log("Combine.cc",__LINE__,std::string(Form("Branch %s of the output tree is not a scalar number, it is not written to the result store", branch->GetName())),__func__);
+            continue;
+        }
+        resultStore_->addColumn(branch->GetName(), type, leaf->GetValuePointer());
+    }
+}
+
+void Combine::closeResultStore() {
+    if (!resultStore_) return;
+    if (!resultStore_->close()) {
+        std::cerr << "Error when writing the result store, the file may be incomplete" << std::endl;
+    }
+    resultStore_.reset();
+}
+
 void Combine::addBranch(const char *name, void *address, const char *leaflist) {
     tree_->Branch(name,address,leaflist);
 }
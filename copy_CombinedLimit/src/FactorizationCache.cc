@@ -0,0 +1,171 @@
+#include "../interface/FactorizationCache.h"
+#include "../interface/utils.h"
+#include "../interface/Combine.h"
+#include "../interface/CombineLogger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
+
+#include <TString.h>
+#include <RooAbsPdf.h>
+#include <RooArgSet.h>
+#include <RooArgList.h>
+
+namespace {
+    const char kMagic[8] = { 'C', 'M', 'B', 'F', 'A', 'C', 'T', '1' };
+
+    struct Entry {
+        std::unordered_map<std::string, bool> obsDependent;
+    };
+
+    std::string gDirectory_;
+    std::string gWorkspace_;
+    std::map<uint64_t, Entry> gEntries_;
+
+    std::string fileName(uint64_t key) {
+        return gDirectory_ + TString::Format("/factorization_%016llx.bin", (unsigned long long) key).Data();
+    }
+
+    // file layout: magic, key, number of terms, then for each term the length of its name, the name and the answer
+    bool readEntry(uint64_t key, Entry &entry) {
+        std::ifstream in(fileName(key), std::ios::binary);
+        if (!in.good()) return false;
+        char magic[sizeof(kMagic)]; uint64_t fileKey = 0; uint32_t n = 0;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char *>(&fileKey), sizeof(fileKey));
+        in.read(reinterpret_cast<char *>(&n), sizeof(n));
+        if (!in.good() || memcmp(magic, kMagic, sizeof(kMagic)) || fileKey != key) return false;
+        std::string name;
+        for (uint32_t i = 0; i < n; ++i) {
+            uint32_t len = 0; char answer = 0;
+            in.read(reinterpret_cast<char *>(&len), sizeof(len));
+            if (!in.good()) return false;
+            name.resize(len);
+            in.read(&name[0], len);
+            in.read(&answer, 1);
+            if (!in.good()) return false;
+            entry.obsDependent[name] = (answer != 0);
+        }
+        return true;
+    }
+
+    // written to a temporary file and renamed, so that concurrent jobs never read a partial file
+    bool writeEntry(uint64_t key, const Entry &entry) {
+        std::string target = fileName(key), tmp = target + TString::Format(".tmp%d", int(getpid())).Data();
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out.good()) return false;
+            std::vector<std::pair<std::string, bool>> sorted(entry.obsDependent.begin(), entry.obsDependent.end());
+            std::sort(sorted.begin(), sorted.end());
+            uint32_t n = sorted.size();
+            out.write(kMagic, sizeof(kMagic));
+            out.write(reinterpret_cast<const char *>(&key), sizeof(key));
+            out.write(reinterpret_cast<const char *>(&n), sizeof(n));
+            for (const auto &term : sorted) {
+                uint32_t len = term.first.size(); char answer = term.second;
+                out.write(reinterpret_cast<const char *>(&len), sizeof(len));
+                out.write(term.first.data(), len);
+                out.write(&answer, 1);
+            }
+            if (!out.good()) { out.close(); std::remove(tmp.c_str()); return false; }
+        }
+        if (std::rename(tmp.c_str(), target.c_str()) != 0) { std::remove(tmp.c_str()); return false; }
+        return true;
+    }
+}
+
+uint64_t FactorizationCache::hash(const void *data, size_t size, uint64_t seed) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+void FactorizationCache::setDirectory(const std::string &dir) {
+    gDirectory_ = dir;
+    gEntries_.clear();
+}
+
+void FactorizationCache::setWorkspace(const std::string &name) {
+    gWorkspace_ = name;
+    gEntries_.clear();
+}
+
+bool FactorizationCache::enabled() {
+    return !gDirectory_.empty();
+}
+
+uint64_t FactorizationCache::structureHash(const RooAbsPdf &pdf, uint64_t seed) {
+    // whether a term depends on the observables is determined by the names of the nodes and servers
+    // of its graph; the nodes are sorted, so that the hash doesn't depend on the order of the servers
+    RooArgSet nodes;
+    pdf.treeNodeServerList(&nodes);
+    std::vector<std::string> lines;
+    lines.reserve(nodes.getSize());
+    std::vector<std::string> servers;
+    for (RooAbsArg *node : nodes) {
+        servers.clear();
+        for (RooAbsArg *server : node->servers()) servers.push_back(server->GetName());
+        std::sort(servers.begin(), servers.end());
+        std::string line = std::string(node->ClassName()) + " " + node->GetName() + ":";
+        for (const std::string &server : servers) (line += " ") += server;
+        lines.push_back(line);
+    }
+    std::sort(lines.begin(), lines.end());
+    uint64_t h = seed;
+    for (const std::string &line : lines) h = hash(line.c_str(), line.size() + 1, h);
+    return h;
+}
+
+RooAbsPdf *FactorizationCache::factorizePdf(const RooArgSet &observables, RooAbsPdf &pdf, RooArgList &constraints) {
+    if (!enabled()) return utils::factorizePdf(observables, pdf, constraints);
+
+    // the answers depend on the model and on which variables are the observables
+    uint64_t key = hash(gWorkspace_.c_str(), gWorkspace_.size() + 1);
+    key = structureHash(pdf, key);
+    std::vector<std::string> obsNames;
+    for (RooAbsArg *a : observables) obsNames.push_back(a->GetName());
+    std::sort(obsNames.begin(), obsNames.end());
+    for (const std::string &name : obsNames) key = hash(name.c_str(), name.size() + 1, key);
+
+    auto found = gEntries_.find(key);
+    if (found == gEntries_.end()) {
+        found = gEntries_.emplace(key, Entry()).first;
+        bool hit = readEntry(key, found->second);
+        if (verbose > 1) {
+            CombineLogger::instance().log("FactorizationCache.cc",__LINE__,std::string(Form(
+                "Factorization cache %s for %s: %s", hit ? "hit" : "miss", pdf.GetName(), fileName(key).c_str())),__func__);
+        }
+    }
+    Entry &entry = found->second;
+
+    unsigned int nmissing = 0;
+    RooAbsPdf *ret = utils::factorizePdf(observables, pdf, constraints, [&](const RooAbsPdf &term) {
+            auto answer = entry.obsDependent.find(term.GetName());
+            if (answer != entry.obsDependent.end()) return answer->second;
+            bool dep = term.dependsOn(observables);
+            entry.obsDependent.emplace(term.GetName(), dep);
+            ++nmissing;
+            return dep;
+        });
+
+    if (nmissing) {
+        if (!writeEntry(key, entry)) {
+            CombineLogger::instance().log("FactorizationCache.cc",__LINE__,std::string(Form(
+                "Could not write the factorization cache file %s", fileName(key).c_str())),__func__);
+        } else if (verbose > 1) {
+            CombineLogger::instance().log("FactorizationCache.cc",__LINE__,std::string(Form(
+                "Added %u terms to the factorization cache %s", nmissing, fileName(key).c_str())),__func__);
+        }
+    }
+    return ret;
+}
@@ -73,17 +73,25 @@ FastHisto::FastHisto(const FastHisto &other) :
 }
 
 int FastHisto::FindBin(const T &x) const {
-    auto match = std::lower_bound(binEdges_.begin(), binEdges_.end(), x);
-    if (match == binEdges_.begin()) return -1;
-    if (match == binEdges_.end()) return values_.size();
-    return match - binEdges_.begin() - 1;
+    unsigned int match = index().lowerBound(x);
+    if (match == 0) return -1;
+    if (match == binEdges_.size()) return values_.size();
+    return match - 1;
+}
+
+void FastHisto::FindBins(unsigned int n, const T *x, int *bins) const {
+    index().lowerBins(n, x, bins);
+    int last = binEdges_.size() - 1;
+    for (unsigned int i = 0; i < n; ++i) {
+        if (bins[i] == last && last >= 0) bins[i] = values_.size();
+    }
 }
 
 
 FastHisto::T FastHisto::GetAt(const T &x) const {
-    auto match = std::lower_bound(binEdges_.begin(), binEdges_.end(), x);
-    if (match == binEdges_.begin() || match == binEdges_.end()) return T(0.0);
-    return values_[match - binEdges_.begin() - 1];
+    unsigned int match = index().lowerBound(x);
+    if (match == 0 || match == binEdges_.size()) return T(0.0);
+    return values_[match - 1];
 }
 
 FastHisto::T FastHisto::IntegralWidth() const {
@@ -35,8 +35,141 @@
 #include <Math/MinimizerOptions.h>
 
 #include <iomanip>
+#include <limits>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/wait.h>
 using namespace RooStats;
 
+namespace {
+  /// Streaming (Welford) accumulator of the mean and of the second and third central moments of a
+  /// vector of sampled values. The co-moments of pairs of elements are kept only if covariances are
+  /// requested, and then either for all pairs or only for pairs within the same block (see setBlocks).
+  /// Accumulators filled with disjoint sets of samples can be merged exactly, and serialized to a
+  /// file descriptor to collect them from forked workers.
+  class SampleMoments {
+    public:
+      SampleMoments(unsigned int size, bool covariance = false, bool thirdMoment = false) :
+          size_(size), covariance_(covariance), thirdMoment_(thirdMoment), full_(true), n_(0),
+          blockStart_(size, 0), mean_(size, 0.), m2_(covariance ? size * size : size, 0.),
+          m3_(thirdMoment ? size : 0, 0.), delta_(size, 0.) {}
+
+      /// blockStart[i] is the first element of the block of element i; if full is true
+      /// the co-moments of all pairs are kept anyway.
+      void setBlocks(const std::vector<int> &blockStart, bool full) {
+        blockStart_.assign(blockStart.begin(), blockStart.end());
+        full_ = full;
+      }
+
+      unsigned int size() const { return size_; }
+      bool tracked(unsigned int i, unsigned int j) const {
+        if (i == j) return true;
+        if (!covariance_) return false;
+        return full_ || blockStart_[i] == blockStart_[j];
+      }
+      double mean(unsigned int i) const { return mean_[i]; }
+      /// central moment E[(x_i - <x_i>)(x_j - <x_j>)] (zero for pairs that are not tracked)
+      double covariance(unsigned int i, unsigned int j) const { return n_ > 0 && tracked(i, j) ? m2(i, j) / n_ : 0.; }
+      /// central moment E[(x_i - <x_i>)^3]
+      double thirdMoment(unsigned int i) const { return n_ > 0 && thirdMoment_ ? m3_[i] / n_ : 0.; }
+      /// E[(x_i - ref_i)(x_j - ref_j)], i.e. the (co)variance around a reference point instead of the mean
+      double meanProductAbout(unsigned int i, unsigned int j, double ref_i, double ref_j) const {
+        if (n_ == 0 || !tracked(i, j)) return 0.;
+        return covariance(i, j) + (mean_[i] - ref_i) * (mean_[j] - ref_j);
+      }
+
+      void add(const std::vector<double> &x) {
+        n_ += 1;
+        for (unsigned int i = 0; i < size_; ++i) {
+          delta_[i] = x[i] - mean_[i];
+          mean_[i] += delta_[i] / n_;
+        }
+        if (thirdMoment_) {
+          double a = (n_ - 1) * (n_ - 2) / (n_ * n_);
+          for (unsigned int i = 0; i < size_; ++i) {
+            double d = delta_[i];
+            m3_[i] += d * d * d * a - 3. * d * m2(i, i) / n_;
+          }
+        }
+        if (covariance_) {
+          for (unsigned int i = 0; i < size_; ++i) {
+            double *row = &m2_[i * size_];
+            for (unsigned int j = full_ ? 0 : blockStart_[i]; j <= i; ++j) row[j] += delta_[i] * (x[j] - mean_[j]);
+          }
+        } else {
+          for (unsigned int i = 0; i < size_; ++i) m2_[i] += delta_[i] * (x[i] - mean_[i]);
+        }
+      }
+
+      void merge(const SampleMoments &other) {
+        if (other.n_ == 0) return;
+        if (n_ == 0) { *this = other; return; }
+        double na = n_, nb = other.n_, n = na + nb;
+        for (unsigned int i = 0; i < size_; ++i) delta_[i] = other.mean_[i] - mean_[i];
+        if (thirdMoment_) {
+          for (unsigned int i = 0; i < size_; ++i) {
+            double d = delta_[i];
+            m3_[i] += other.m3_[i] + d * d * d * na * nb * (na - nb) / (n * n) + 3. * d * (na * other.m2(i, i) - nb * m2(i, i)) / n;
+          }
+        }
+        if (covariance_) {
+          for (unsigned int i = 0; i < size_; ++i) {
+            for (unsigned int j = full_ ? 0 : blockStart_[i]; j <= i; ++j) {
+              m2_[i * size_ + j] += other.m2_[i * size_ + j] + delta_[i] * delta_[j] * na * nb / n;
+            }
+          }
+        } else {
+          for (unsigned int i = 0; i < size_; ++i) m2_[i] += other.m2_[i] + delta_[i] * delta_[i] * na * nb / n;
+        }
+        for (unsigned int i = 0; i < size_; ++i) mean_[i] += delta_[i] * nb / n;
+        n_ = n;
+      }
+
+      bool write(int fd) const {
+        return writeAll(fd, &n_, sizeof(double)) && writeAll(fd, mean_.data(), mean_.size() * sizeof(double)) &&
+               writeAll(fd, m2_.data(), m2_.size() * sizeof(double)) && writeAll(fd, m3_.data(), m3_.size() * sizeof(double));
+      }
+      /// read the state written by an accumulator with the same configuration
+      bool read(int fd) {
+        return readAll(fd, &n_, sizeof(double)) && readAll(fd, mean_.data(), mean_.size() * sizeof(double)) &&
+               readAll(fd, m2_.data(), m2_.size() * sizeof(double)) && readAll(fd, m3_.data(), m3_.size() * sizeof(double));
+      }
+
+    private:
+      unsigned int size_;
+      bool covariance_, thirdMoment_, full_;
+      double n_;
+      std::vector<int> blockStart_;
+      std::vector<double> mean_, m2_, m3_, delta_;
+
+      // only the lower triangle of the co-moments is filled
+      double m2(unsigned int i, unsigned int j) const {
+        if (!covariance_) return m2_[i];
+        return i >= j ? m2_[i * size_ + j] : m2_[j * size_ + i];
+      }
+      static bool writeAll(int fd, const void *buf, size_t len) {
+        const char *p = static_cast<const char *>(buf);
+        while (len > 0) {
+          ssize_t ret = ::write(fd, p, len);
+          if (ret < 0 && errno == EINTR) continue;
+          if (ret <= 0) return false;
+          p += ret; len -= ret;
+        }
+        return true;
+      }
+      static bool readAll(int fd, void *buf, size_t len) {
+        char *p = static_cast<char *>(buf);
+        while (len > 0) {
+          ssize_t ret = ::read(fd, p, len);
+          if (ret < 0 && errno == EINTR) continue;
+          if (ret <= 0) return false;
+          p += ret; len -= ret;
+        }
+        return true;
+      }
+  };
+}
+
 std::string FitDiagnostics::name_ = "";
 std::string FitDiagnostics::massName_ = "";
 std::string FitDiagnostics::toyName_ = "";
@@ -45,6 +178,7 @@ std::string FitDiagnostics::out_ = ".";
 bool        FitDiagnostics::makePlots_ = false;
 float       FitDiagnostics::rebinFactor_ = 1.0;
 int         FitDiagnostics::numToysForShapes_ = 200;
+int         FitDiagnostics::numWorkersForShapes_ = 1;
 std::string FitDiagnostics::signalPdfNames_     = "shapeSig*";
 std::string FitDiagnostics::filterString_     = "";
 std::string FitDiagnostics::backgroundPdfNames_ = "shapeBkg*";
@@ -82,6 +216,7 @@ FitDiagnostics::FitDiagnostics() : FitterAlgoBase("FitDiagnostics specific optio
         ("saveWithUncertainties",  "Save also pre/post-fit uncertainties on the shapes and normalizations (from resampling the covariance matrix)")
         ("saveOverallShapes",  "Save total shapes (and covariance if used with --saveWithUncertainties), ie will produce TH1 (TH2) merging bins across all channels")
         ("numToysForShapes", 	boost::program_options::value<int>(&numToysForShapes_)->default_value(numToysForShapes_),  "Choose number of toys for re-sampling of the covariance (for shapes with uncertainties)")
+        ("numWorkersForShapes", 	boost::program_options::value<int>(&numWorkersForShapes_)->default_value(numWorkersForShapes_),  "Split the toys for re-sampling of the covariance across this many forked processes")
         ("filterString",	boost::program_options::value<std::string>(&filterString_)->default_value(filterString_), "Filter to search for when making covariance and shapes")
         ("justFit",  		"Just do the S+B fit, don't do the B-only one, don't save output file")
         ("robustHesse",  boost::program_options::value<bool>(&robustHesse_)->default_value(robustHesse_),  "Use a more robust calculation of the hessian/covariance matrix")
@@ -699,13 +834,12 @@ void FitDiagnostics::getNormalizations(RooAbsPdf *pdf, const RooArgSet &obs, Roo
 	}
 	// now let's start with the central values
 	std::vector<double> vals(snm.size(), 0.), sumx2(snm.size(), 0.);
-	std::vector<TH1 *> shapes(snm.size(), 0), shapes2(snm.size(), 0);
+	std::vector<TH1 *> shapes(snm.size(), 0);
 	std::vector<int> bins(snm.size(), 0), sig(snm.size(), 0);
-	std::map<std::string, TH1 *> totByCh, totByCh2, sigByCh, sigByCh2, bkgByCh, bkgByCh2,  widthByCh;
+	std::map<std::string, TH1 *> totByCh, sigByCh, bkgByCh, widthByCh;
 	std::map<std::string, TH2 *> totByCh2Covar;
 	std::map<std::string, double> norm_tot, norm_sig, norm_bkg;
 	std::map<std::string, double> sumx2_tot, sumx2_sig, sumx2_bkg;
-	std::map<std::string, double> diff_tot, diff_sig, diff_bkg;
 	std::vector<std::string> channel_names;
 	IT bg = snm.begin(), ed = snm.end(), pair;
 	int i;
@@ -731,10 +865,6 @@ void FitDiagnostics::getNormalizations(RooAbsPdf *pdf, const RooArgSet &obs, Roo
 			hist->Scale(vals[i] / hist->Integral("width"));
 			hist->SetDirectory(shapesByChannel[pair->second.channel]);
 			shapes[i] = hist;
-			// if (saveWithUncertainties_) {
-			shapes2[i] = (TH1 *)hist->Clone();
-			shapes2[i]->SetDirectory(0);
-			shapes2[i]->Reset();
 			bins[i] = hist->GetNbinsX();
 			TH1 *&htot = totByCh[pair->second.channel];
 			if (htot == 0)
@@ -743,10 +873,6 @@ void FitDiagnostics::getNormalizations(RooAbsPdf *pdf, const RooArgSet &obs, Roo
 				htot->SetName("total");
 				htot->SetTitle(Form("Total signal+background in %s", pair->second.channel.c_str()));
 				htot->SetDirectory(shapesByChannel[pair->second.channel]);
-				TH1 *htot2 = (TH1 *)hist->Clone();
-				htot2->Reset();
-				htot2->SetDirectory(0);
-				totByCh2[pair->second.channel] = htot2;
 
 				TH2F *htot2covar = new TH2F("total_covar", "Covariance signal+background", bins[i], 0, bins[i], bins[i], 0, bins[i]);
 				htot2covar->GetXaxis()->SetTitle("Bin number");
@@ -778,16 +904,11 @@ void FitDiagnostics::getNormalizations(RooAbsPdf *pdf, const RooArgSet &obs, Roo
 				hpart->SetName((sig[i] ? "total_signal" : "total_background"));
 				hpart->SetTitle(Form((sig[i] ? "Total signal in %s" : "Total background in %s"), pair->second.channel.c_str()));
 				hpart->SetDirectory(shapesByChannel[pair->second.channel]);
-				TH1 *hpart2 = (TH1 *)hist->Clone();
-				hpart2->Reset();
-				hpart2->SetDirectory(0);
-				(sig[i] ? sigByCh2 : bkgByCh2)[pair->second.channel] = hpart2;
 			}
 			else
 			{
 				hpart->Add(hist);
 			}
-			//}
 		}
 	}
 
@@ -826,14 +947,11 @@ void FitDiagnostics::getNormalizations(RooAbsPdf *pdf, const RooArgSet &obs, Roo
 	datOverallHist->SetDirectory(0);
 
 	int iBinOverall = 1;
-	// Map to hold info on bins across channels
-	std::map<TString, int> binMap;
 	for (IH h = totByCh.begin(), eh = totByCh.end(); h != eh; ++h)
 	{
 		for (int iBin = 0; iBin < h->second->GetNbinsX(); iBin++, iBinOverall++)
 		{
 			TString label = Form("%s_%d", h->first.c_str(), iBin);
-			binMap[label] = iBinOverall;
 			totOverall->GetXaxis()->SetBinLabel(iBinOverall, label);
 			totOverall->SetBinContent(iBinOverall, h->second->GetBinContent(iBin + 1));
 			wdtOverall->GetXaxis()->SetBinLabel(iBinOverall, label);
@@ -872,261 +990,217 @@ void FitDiagnostics::getNormalizations(RooAbsPdf *pdf, const RooArgSet &obs, Roo
 	if (saveWithUncertainties_)
 	{
 		int ntoys = numToysForShapes_;
+		int nworkers = std::max(1, std::min(numWorkersForShapes_, ntoys));
 
-		if (verbose > 0) CombineLogger::instance().log("FitDiagnostics.cc",__LINE__,std::string(Form("Generating toy data for evaluating per-bin uncertainties and covariances with post-fit nuisance parameters with %d toys", ntoys)), __func__);
+		if (verbose > 0) CombineLogger::instance().log("FitDiagnostics.cc",__LINE__,std::string(Form("Generating toy data for evaluating per-bin uncertainties and covariances with post-fit nuisance parameters with %d toys (%d workers)", ntoys, nworkers)), __func__);
 
 		sampler.generate(ntoys);
 		std::unique_ptr<RooArgSet> params(pdf->getParameters(obs));
-		// prepare histograms for running sums
-		std::map<std::string, TH1 *> totByCh1, sigByCh1, bkgByCh1;
+
+		// Each toy fills three flat arrays instead of per-channel histograms:
+		//  - norms:  process normalisations, then the total, signal and background sums of each channel
+		//  - shapes: the bins of each process, then the overall signal and background bins
+		//  - totals: the overall signal+background bins, for which covariances are also needed
+		std::map<std::string, int> chIdx;
+		for (std::map<std::string, double>::const_iterator it = norm_tot.begin(), et = norm_tot.end(); it != et; ++it)
+		{
+			int idx = chIdx.size();
+			chIdx[it->first] = idx;
+		}
+		int nproc = snm.size(), nch = chIdx.size();
+		std::map<std::string, int> chBinOffset;
+		std::vector<int> blockStart;
+		int nOverall = 0;
 		for (IH h = totByCh.begin(), eh = totByCh.end(); h != eh; ++h)
-			totByCh1[h->first] = (TH1 *)h->second->Clone();
-		for (IH h = sigByCh.begin(), eh = sigByCh.end(); h != eh; ++h)
-			sigByCh1[h->first] = (TH1 *)h->second->Clone();
-		for (IH h = bkgByCh.begin(), eh = bkgByCh.end(); h != eh; ++h)
-			bkgByCh1[h->first] = (TH1 *)h->second->Clone();
-		for (int t = 0; t < ntoys; ++t)
 		{
-			// zero out partial sums
-			for (IH h = totByCh1.begin(), eh = totByCh1.end(); h != eh; ++h)
-				h->second->Reset(), diff_tot[h->first] = 0.0;
-			for (IH h = sigByCh1.begin(), eh = sigByCh1.end(); h != eh; ++h)
-				h->second->Reset(), diff_sig[h->first] = 0.0;
-			for (IH h = bkgByCh1.begin(), eh = bkgByCh1.end(); h != eh; ++h)
-				h->second->Reset(), diff_bkg[h->first] = 0.0;
-			for (auto chname : channel_names)
-				diff_tot[chname] = 0.0, diff_sig[chname] = 0.0, diff_bkg[chname] = 0.0;
-			// randomize numbers
-			params->assignValueOnly(sampler.get(t));
-			for (pair = bg, i = 0; pair != ed; ++pair, ++i)
-			{
-				// add up deviations in numbers for each channel
-				sumx2[i] += std::pow(pair->second.norm->getVal() - vals[i], 2);
-				diff_tot[pair->second.channel] += (pair->second.norm->getVal() - vals[i]);
-				pair->second.signal ? diff_sig[pair->second.channel] += (pair->second.norm->getVal() - vals[i]) : diff_bkg[pair->second.channel] += (pair->second.norm->getVal() - vals[i]);
-				if (saveShapes_ && pair->second.obs.getSize() == 1)
-				{
-					// and also deviations in the shapes
-					RooRealVar *x = (RooRealVar *)pair->second.obs.at(0);
-					std::unique_ptr<TH1> hist(pair->second.pdf->createHistogram(pair->second.pdf->GetName(), *x,
-																				pair->second.isfunc ? RooFit::Extended(false) : RooCmdArg::none()));
-					hist->Scale(pair->second.norm->getVal() / hist->Integral("width"));
-					for (int b = 1; b <= bins[i]; ++b)
-					{
-						shapes2[i]->AddBinContent(b, std::pow(hist->GetBinContent(b) - shapes[i]->GetBinContent(b), 2));
-					}
-					// and cumulate in the total for this toy as well
-					totByCh1[pair->second.channel]->Add(&*hist);
-					(sig[i] ? sigByCh1 : bkgByCh1)[pair->second.channel]->Add(&*hist);
-				}
-			}
-			// now add up the deviations within channels in this toy 
-			for (IH h = totByCh1.begin(), eh = totByCh1.end(); h != eh; ++h)
+			chBinOffset[h->first] = nOverall;
+			for (int b = 0, nb = h->second->GetNbinsX(); b < nb; ++b)
+				blockStart.push_back(nOverall);
+			nOverall += h->second->GetNbinsX();
+		}
+		std::vector<int> procCh(nproc, 0), procBinOffset(nproc, -1), procOverallOffset(nproc, 0);
+		int nProcBins = 0;
+		for (pair = bg, i = 0; pair != ed; ++pair, ++i)
+		{
+			procCh[i] = chIdx[pair->second.channel];
+			if (shapes[i])
 			{
-				TH1 *target = totByCh2[h->first], *reference = totByCh[h->first];
-				TH2 *targetCovar = totByCh2Covar[h->first];
-
-
-				for (int b = 1, nb = target->GetNbinsX(); b <= nb; ++b)
-				{
-					double deltaBi = h->second->GetBinContent(b) - reference->GetBinContent(b);
-
-					target->AddBinContent(b, std::pow(deltaBi, 2));
-
-					int binX = b - 1;
-					TString xLabel = Form("%s_%d", h->first.c_str(), binX);
-					
-					// Fill also the overall histogram contents 
-					double Xi = h->second->GetBinContent(b);
-					totM1->Fill(xLabel,Xi);
-					totM3->Fill(xLabel,std::pow(Xi,3));
-					// ----------------------
-					for (int bj = 1; bj <= b; bj++)
-					{
-						int binY = bj - 1;
-						TString yLabel = Form("%s_%d", h->first.c_str(), binY);
-						
-						double Xj = h->second->GetBinContent(bj);
-						double deltaBj = Xj - reference->GetBinContent(bj);
-
-						targetCovar->AddBinContent(targetCovar->GetBin(b, bj), deltaBj * deltaBi); // covariance
-						totOverall2Covar->Fill(xLabel, yLabel, deltaBj * deltaBi);
-						totM2->Fill(xLabel,yLabel,Xj*Xi);
-
-
-						if (b != bj)
-						{
-							targetCovar->AddBinContent(targetCovar->GetBin(bj, b), deltaBj * deltaBi); // covariance
-							totOverall2Covar->Fill(yLabel, xLabel, deltaBj * deltaBi);
-							totM2->Fill(yLabel,xLabel,Xj*Xi);
-						}
-					}
-				}
+				procBinOffset[i] = nProcBins;
+				procOverallOffset[i] = chBinOffset[pair->second.channel];
+				nProcBins += bins[i];
 			}
-			// deviations across channels in this toy
-			if (saveOverallShapes_)
+		}
+		SampleMoments normMoments(nproc + 3 * nch), shapeMoments(nProcBins + 2 * nOverall);
+		SampleMoments totMoments(nOverall, /*covariance=*/true, /*thirdMoment=*/true);
+		// the covariance across channels is only needed for the overall shapes
+		totMoments.setBlocks(blockStart, /*full=*/saveOverallShapes_);
+
+		auto sampleToys = [&](int first, int last) {
+			std::vector<double> xnorm(normMoments.size()), xshape(shapeMoments.size()), xtot(totMoments.size());
+			for (int t = first; t < last; ++t)
 			{
-				for (IH h = totByCh1.begin(), eh = totByCh1.end(); h != eh; ++h)
+				std::fill(xnorm.begin(), xnorm.end(), 0.);
+				std::fill(xshape.begin(), xshape.end(), 0.);
+				std::fill(xtot.begin(), xtot.end(), 0.);
+				// randomize numbers
+				params->assignValueOnly(sampler.get(t));
+				IT ipair; int ip;
+				for (ipair = bg, ip = 0; ipair != ed; ++ipair, ++ip)
 				{
-					TH1 *reference = totByCh[h->first];
-					for (IH h2 = totByCh1.begin(); h2 != h; ++h2)
+					double norm = ipair->second.norm->getVal();
+					xnorm[ip] = norm;
+					xnorm[nproc + procCh[ip]] += norm;
+					xnorm[nproc + (ipair->second.signal ? 1 : 2) * nch + procCh[ip]] += norm;
+					if (procBinOffset[ip] < 0) continue;
+					RooRealVar *x = (RooRealVar *)ipair->second.obs.at(0);
+					std::unique_ptr<TH1> hist(ipair->second.pdf->createHistogram(ipair->second.pdf->GetName(), *x,
+													ipair->second.isfunc ? RooFit::Extended(false) : RooCmdArg::none()));
+					hist->Scale(norm / hist->Integral("width"));
+					double *xproc = &xshape[procBinOffset[ip]];
+					double *xpart = &xshape[nProcBins + (sig[ip] ? 0 : nOverall) + procOverallOffset[ip]];
+					double *xall  = &xtot[procOverallOffset[ip]];
+					for (int b = 0; b < bins[ip]; ++b)
 					{
-						TH1 *reference2 = totByCh[h2->first];
-						for (int b = 1, nb = reference->GetNbinsX(); b <= nb; ++b)
-						{
-							double Xi      = h->second->GetBinContent(b);
-							double deltaBi = Xi - reference->GetBinContent(b);
-							int binX = b - 1;
-							TString xLabel = Form("%s_%d", h->first.c_str(), binX);
-							for (int bj = 1, nb2 = reference2->GetNbinsX(); bj <= nb2; ++bj)
-							{
-								int binY = bj - 1;
-								double Xj      = h2->second->GetBinContent(bj); 
-								double deltaBj = Xj - reference2->GetBinContent(bj);
-								TString yLabel = Form("%s_%d", h2->first.c_str(), binY);
-								totOverall2Covar->Fill(xLabel, yLabel, deltaBj * deltaBi);
-								totOverall2Covar->Fill(yLabel, xLabel, deltaBj * deltaBi);
-
-								totM2->Fill(xLabel, yLabel, Xi * Xj);
-								totM2->Fill(yLabel, xLabel, Xi * Xj);
-							}
-						}
+						double val = hist->GetBinContent(b + 1);
+						xproc[b] = val;
+						xpart[b] += val;
+						xall[b] += val;
 					}
 				}
+				normMoments.add(xnorm);
+				shapeMoments.add(xshape);
+				totMoments.add(xtot);
 			}
-			for (IH h = sigByCh1.begin(), eh = sigByCh1.end(); h != eh; ++h)
+		};
+
+		// Split the toys in contiguous blocks: the first is done here, the others in forked
+		// workers (each with its own copy of the model) that send back their moments to be merged
+		std::vector<int> firstToy(nworkers + 1);
+		for (int w = 0; w <= nworkers; ++w)
+			firstToy[w] = (long(ntoys) * w) / nworkers;
+		std::vector<pid_t> pids;
+		std::vector<int> fds;
+		fflush(stdout); fflush(stderr);
+		for (int w = 1; w < nworkers; ++w)
+		{
+			UInt_t seed = RooRandom::integer(std::numeric_limits<UInt_t>::max() - 1);
+			int fd[2];
+			if (pipe(fd) != 0) throw std::runtime_error("FitDiagnostics: failed to create a pipe for a sampling worker");
+			pid_t pid = fork();
+			if (pid < 0) throw std::runtime_error("FitDiagnostics: failed to fork a sampling worker");
+			if (pid == 0)
 			{
-				TH1 *target = sigByCh2[h->first], *reference = sigByCh[h->first];
-				for (int b = 1, nb = target->GetNbinsX(); b <= nb; ++b)
+				// worker: never return into the caller, which would write to the output file
+				close(fd[0]);
+				bool ok = false;
+				try
 				{
-					target->AddBinContent(b, std::pow(h->second->GetBinContent(b) - reference->GetBinContent(b), 2));
+					RooRandom::randomGenerator()->SetSeed(seed);
+					sampleToys(firstToy[w], firstToy[w + 1]);
+					ok = normMoments.write(fd[1]) && shapeMoments.write(fd[1]) && totMoments.write(fd[1]);
 				}
-			}
-			for (IH h = bkgByCh1.begin(), eh = bkgByCh1.end(); h != eh; ++h)
-			{
-				TH1 *target = bkgByCh2[h->first], *reference = bkgByCh[h->first];
-				for (int b = 1, nb = target->GetNbinsX(); b <= nb; ++b)
+				catch (std::exception &ex)
 				{
-					target->AddBinContent(b, std::pow(h->second->GetBinContent(b) - reference->GetBinContent(b), 2));
+					std::cerr << "FitDiagnostics: sampling worker " << w << " failed: " << ex.what() << std::endl;
 				}
+				close(fd[1]);
+				_exit(ok ? 0 : 1);
 			}
-			// Add diffs to sumx2 -- all in same loop since channels should match
-			for (std::map<std::string, double>::const_iterator it = diff_tot.begin(), et = diff_tot.end(); it != et; ++it)
-			{
-				(t == 0) ? sumx2_tot[it->first] = std::pow(diff_tot[it->first], 2) : sumx2_tot[it->first] += std::pow(diff_tot[it->first], 2);
-				(t == 0) ? sumx2_sig[it->first] = std::pow(diff_sig[it->first], 2) : sumx2_sig[it->first] += std::pow(diff_sig[it->first], 2);
-				(t == 0) ? sumx2_bkg[it->first] = std::pow(diff_bkg[it->first], 2) : sumx2_bkg[it->first] += std::pow(diff_bkg[it->first], 2);
-			}
-		} // end of the toy loop
+			close(fd[1]);
+			pids.push_back(pid);
+			fds.push_back(fd[0]);
+		}
+		sampleToys(firstToy[0], firstToy[1]);
+		for (unsigned int w = 0; w < pids.size(); ++w)
+		{
+			SampleMoments workerNorm(normMoments), workerShape(shapeMoments), workerTot(totMoments);
+			bool ok = workerNorm.read(fds[w]) && workerShape.read(fds[w]) && workerTot.read(fds[w]);
+			close(fds[w]);
+			int status = 0, ret;
+			do { ret = waitpid(pids[w], &status, 0); } while (ret == -1 && errno == EINTR);
+			if (!ok || ret == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+				throw std::runtime_error(Form("FitDiagnostics: sampling worker %u did not complete", w + 1));
+			normMoments.merge(workerNorm);
+			shapeMoments.merge(workerShape);
+			totMoments.merge(workerTot);
+		}
+
 		// now take square roots and such
 		for (pair = bg, i = 0; pair != ed; ++pair, ++i)
 		{
-			sumx2[i] = sqrt(sumx2[i] / ntoys);
-			if (shapes2[i])
+			sumx2[i] = std::sqrt(normMoments.meanProductAbout(i, i, vals[i], vals[i]));
+			if (shapes[i])
 			{
-				for (int b = 1; b <= bins[i]; ++b)
+				for (int b = 0; b < bins[i]; ++b)
 				{
-					shapes[i]->SetBinError(b, std::sqrt(shapes2[i]->GetBinContent(b) / ntoys));
+					double ref = shapes[i]->GetBinContent(b + 1);
+					shapes[i]->SetBinError(b + 1, std::sqrt(shapeMoments.meanProductAbout(procBinOffset[i] + b, procBinOffset[i] + b, ref, ref)));
 				}
-				delete shapes2[i];
-				shapes2[i] = 0;
 			}
 		}
 
-		for (std::map<std::string, double>::const_iterator it = sumx2_tot.begin(), iend = sumx2_tot.end(); it != iend; ++it)
+		for (std::map<std::string, int>::const_iterator it = chIdx.begin(), iend = chIdx.end(); it != iend; ++it)
 		{
-			sumx2_tot[it->first] = sqrt(sumx2_tot[it->first] / ntoys);
-			sumx2_sig[it->first] = sqrt(sumx2_sig[it->first] / ntoys);
-			sumx2_bkg[it->first] = sqrt(sumx2_bkg[it->first] / ntoys);
+			int itot = nproc + it->second, isig = itot + nch, ibkg = isig + nch;
+			sumx2_tot[it->first] = std::sqrt(normMoments.meanProductAbout(itot, itot, norm_tot[it->first], norm_tot[it->first]));
+			sumx2_sig[it->first] = std::sqrt(normMoments.meanProductAbout(isig, isig, norm_sig[it->first], norm_sig[it->first]));
+			sumx2_bkg[it->first] = std::sqrt(normMoments.meanProductAbout(ibkg, ibkg, norm_bkg[it->first], norm_bkg[it->first]));
 		}
 
-		// and the same for the total histograms
+		// and the same for the total histograms, including the covariance within each channel
 		for (IH h = totByCh.begin(), eh = totByCh.end(); h != eh; ++h)
 		{
-			TH1 *sum2 = totByCh2[h->first];
-			for (int b = 1, nb = sum2->GetNbinsX(); b <= nb; ++b)
+			TH1 *reference = h->second;
+			TH2 *covar = totByCh2Covar[h->first];
+			int offset = chBinOffset[h->first];
+			for (int b = 1, nb = reference->GetNbinsX(); b <= nb; ++b)
 			{
-				TString xLabel = Form("%s_%d", h->first.c_str(), b - 1);
-				totOverall->SetBinError(binMap[xLabel], std::sqrt(sum2->GetBinContent(b) / ntoys));
-				h->second->SetBinError(b, std::sqrt(sum2->GetBinContent(b) / ntoys));
-			}
-			delete sum2;
-			delete totByCh1[h->first];
-		}
-		// same for covariance matrix 
-		// First clone three moments 
-		TH1D *m1Clone = (TH1D*) totM1->Clone(); m1Clone->SetName("m1Clone");
-		TH2D *m2Clone = (TH2D*) totM2->Clone(); m2Clone->SetName("m1Clone");
-		TH1D *m3Clone = (TH1D*) totM3->Clone(); m3Clone->SetName("m1Clone");
-
-		for (int b = 1, nb = totOverall2Covar->GetNbinsX(); b <= nb; ++b)
-		{
-
-			double m1 = m1Clone->GetBinContent(b)   / ntoys; // X
-			double m2 = m2Clone->GetBinContent(b,b) / ntoys; // X^2
-			double m3 = m3Clone->GetBinContent(b)   / ntoys; // X^3
-
-			// Determine the central moments as needed 
-			for (int bj = 1, nbj = totOverall2Covar->GetNbinsY(); bj <= nbj; ++bj)
-			{
-				totOverall2Covar->SetBinContent(b, bj, (totOverall2Covar->GetBinContent(b, bj) / ntoys));
-				double m2_ij =  m2Clone->GetBinContent(b,bj) / ntoys;
-				double m1_j  =  m1Clone->GetBinContent(bj)   / ntoys; 
-				totM2->SetBinContent(b,bj, m2_ij - m1*m1_j);
+				double refi = reference->GetBinContent(b);
+				for (int bj = 1; bj <= nb; ++bj)
+				{
+					covar->SetBinContent(b, bj, totMoments.meanProductAbout(offset + b - 1, offset + bj - 1, refi, reference->GetBinContent(bj)));
+				}
+				double err = std::sqrt(covar->GetBinContent(b, b));
+				totOverall->SetBinError(offset + b, err);
+				h->second->SetBinError(b, err);
 			}
-			
-			// this should be set after setting the covariance above 
-			totM1->SetBinContent(b, m1);
-			totM3->SetBinContent(b, m3 + 2*std::pow(m1,3) - 3*m1*m2);
 		}
-		delete m1Clone;
-		delete m2Clone;
-		delete m3Clone;
-		
-		for (IH2 h = totByCh2Covar.begin(), eh = totByCh2Covar.end(); h != eh; ++h)
+		// same for covariance matrix and the central moments over all bins
+		for (int b = 1; b <= nOverall; ++b)
 		{
-			TH2 *covar2 = h->second;
-			for (int b = 1, nb = covar2->GetNbinsX(); b <= nb; ++b)
+			double refi = totOverall->GetBinContent(b);
+			for (int bj = 1; bj <= nOverall; ++bj)
 			{
-				for (int bj = 1, nbj = covar2->GetNbinsY(); bj <= nbj; ++bj)
-				{
-					h->second->SetBinContent(b, bj, (covar2->GetBinContent(b, bj) / ntoys));
-				}
+				if (!totMoments.tracked(b - 1, bj - 1)) continue;
+				totOverall2Covar->SetBinContent(b, bj, totMoments.meanProductAbout(b - 1, bj - 1, refi, totOverall->GetBinContent(bj)));
+				totM2->SetBinContent(b, bj, totMoments.covariance(b - 1, bj - 1));
 			}
+			totM1->SetBinContent(b, totMoments.mean(b - 1));
+			totM3->SetBinContent(b, totMoments.thirdMoment(b - 1));
 		}
-		
 
 		for (IH h = sigByCh.begin(), eh = sigByCh.end(); h != eh; ++h)
 		{
-			TH1 *sum2 = sigByCh2[h->first];
-			for (int b = 1, nb = sum2->GetNbinsX(); b <= nb; ++b)
+			int offset = nProcBins + chBinOffset[h->first];
+			for (int b = 1, nb = h->second->GetNbinsX(); b <= nb; ++b)
 			{
-				h->second->SetBinError(b, std::sqrt(sum2->GetBinContent(b) / ntoys));
-				TString xLabel = Form("%s_%d", h->first.c_str(), b - 1);
-				sigOverall->SetBinError(binMap[xLabel], std::sqrt(sum2->GetBinContent(b) / ntoys));
+				double ref = h->second->GetBinContent(b);
+				double err = std::sqrt(shapeMoments.meanProductAbout(offset + b - 1, offset + b - 1, ref, ref));
+				h->second->SetBinError(b, err);
+				sigOverall->SetBinError(chBinOffset[h->first] + b, err);
 			}
-			delete sum2;
-			delete sigByCh1[h->first];
 		}
 		for (IH h = bkgByCh.begin(), eh = bkgByCh.end(); h != eh; ++h)
 		{
-			TH1 *sum2 = bkgByCh2[h->first];
-			for (int b = 1, nb = sum2->GetNbinsX(); b <= nb; ++b)
+			int offset = nProcBins + nOverall + chBinOffset[h->first];
+			for (int b = 1, nb = h->second->GetNbinsX(); b <= nb; ++b)
 			{
-				h->second->SetBinError(b, std::sqrt(sum2->GetBinContent(b) / ntoys));
-				TString xLabel = Form("%s_%d", h->first.c_str(), b - 1);
-				bkgOverall->SetBinError(binMap[xLabel], std::sqrt(sum2->GetBinContent(b) / ntoys));
+				double ref = h->second->GetBinContent(b);
+				double err = std::sqrt(shapeMoments.meanProductAbout(offset + b - 1, offset + b - 1, ref, ref));
+				h->second->SetBinError(b, err);
+				bkgOverall->SetBinError(chBinOffset[h->first] + b, err);
 			}
-			delete sum2;
-			delete bkgByCh1[h->first];
 		}
-		totByCh1.clear();
-		totByCh2.clear();
-		sigByCh1.clear();
-		sigByCh2.clear();
-		bkgByCh1.clear();
-		bkgByCh2.clear();
-		totByCh2.clear();
 		// finally reset parameters
 		params->assignValueOnly(sampler.centralValues());
 	}
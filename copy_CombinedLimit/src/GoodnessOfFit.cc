@@ -8,6 +8,7 @@
 #include <RooProdPdf.h>
 #include <RooSimultaneous.h>
 #include <RooAddPdf.h>
+#include <RooRealSumPdf.h>
 #include <RooConstVar.h>
 #include <RooDataHist.h>
 #include <RooHistPdf.h>
@@ -24,6 +25,9 @@
 #include "../interface/RooSimultaneousOpt.h"
 #include "../interface/utils.h"
 #include "../interface/CachingNLL.h"
+#include "../interface/CMSHistSum.h"
+#include "../interface/CMSHistErrorPropagator.h"
+#include "../interface/ProfilingTools.h"
 
 #include <ROOT/RConfig.hxx> // for ROOT_VERSION
 
@@ -121,6 +125,19 @@ void GoodnessOfFit::initKSandAD(RooStats::ModelConfig *mc_s) {
 
 bool GoodnessOfFit::runSaturatedModel(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint) { 
   RooAbsPdf *pdf_nominal = mc_s->GetPdf();
+
+  CloseCoutSentry sentry(verbose < 2);
+
+  RooArgSet const *cPars = withSystematics ? mc_s->GetNuisanceParameters() : nullptr;
+  auto nominal_nll = combineCreateNLL(*pdf_nominal, data, /*constrain=*/cPars, /*offset=*/false);
+
+  // For binned Poisson channels the saturated NLL is known in closed form, so
+  // they are left out of the saturated pdf and only the rest gets minimised
+  cacheutils::CachingSimNLL *nominal_simnll = dynamic_cast<cacheutils::CachingSimNLL*>(nominal_nll.get());
+  std::vector<std::string> analyticChannels;
+  static bool analyticSaturated = runtimedef::get("GOF_SATURATED_ANALYTIC");
+  if (analyticSaturated && nominal_simnll) analyticChannels = nominal_simnll->binnedChannels();
+
   // now I need to make the saturated pdf
   std::unique_ptr<RooAbsPdf> saturated;
   // factorize away constraints anyway
@@ -130,6 +147,16 @@ bool GoodnessOfFit::runSaturatedModel(RooWorkspace *w, RooStats::ModelConfig *mc
   RooSimultaneous *sim = dynamic_cast<RooSimultaneous *>(obsOnlyPdf);
   if (sim) {
       RooAbsCategoryLValue *cat = (RooAbsCategoryLValue *) sim->indexCat().Clone();
+      if (!analyticChannels.empty()) {
+          // keep at least one channel in the saturated pdf, so that it's never empty
+          int nchannels = 0;
+          for (int ic = 0, nc = cat->numBins((const char *)0); ic < nc; ++ic) {
+              cat->setBin(ic);
+              if (sim->getPdf(cat->getLabel())) ++nchannels;
+          }
+          if (int(analyticChannels.size()) >= nchannels) analyticChannels.erase(analyticChannels.begin());
+          if (verbose > 1) std::cout << "Saturated model computed in closed form for " << analyticChannels.size() << " of " << nchannels << " channels" << std::endl;
+      }
 #if ROOT_VERSION_CODE >= ROOT_VERSION(6,37,00)
       std::vector<std::unique_ptr<RooAbsData>> datasets{data.split(*cat, true)};
 #else
@@ -143,6 +170,7 @@ bool GoodnessOfFit::runSaturatedModel(RooWorkspace *w, RooStats::ModelConfig *mc
           cat->setBin(ic);
           RooAbsPdf *pdfi = sim->getPdf(cat->getLabel());
           if (pdfi == 0) continue;
+          if (std::find(analyticChannels.begin(), analyticChannels.end(), cat->getLabel()) != analyticChannels.end()) continue;
 #if ROOT_VERSION_CODE >= ROOT_VERSION(6,37,00)
           auto found = std::find_if(datasets.begin(), datasets.end(), [&](auto const &item) {
             return std::string{cat->getLabel()} == item->GetName();
@@ -183,10 +211,6 @@ bool GoodnessOfFit::runSaturatedModel(RooWorkspace *w, RooStats::ModelConfig *mc
       saturated.reset(saturatedPdfi);
   }
 
-  CloseCoutSentry sentry(verbose < 2);
-
-  RooArgSet const *cPars = withSystematics ? mc_s->GetNuisanceParameters() : nullptr;
-  auto nominal_nll = combineCreateNLL(*pdf_nominal, data, /*constrain=*/cPars, /*offset=*/false);
   auto saturated_nll = combineCreateNLL(*saturated, data, /*constrain=*/cPars, /*offset=*/false);
 
   if (setParametersForFit_ != "") {
@@ -221,6 +245,7 @@ bool GoodnessOfFit::runSaturatedModel(RooWorkspace *w, RooStats::ModelConfig *mc
     utils::setModelParameters(setParametersForEval_, w->allVars());
   }
   double nll_saturated = saturated_nll->getVal();
+  if (!analyticChannels.empty()) nll_saturated += nominal_simnll->saturatedNLL(analyticChannels);
 
   sentry.clear();
 
@@ -323,10 +348,17 @@ bool GoodnessOfFit::runKSandAD(RooWorkspace *w, RooStats::ModelConfig *mc_s, Roo
 }
 
 Double_t GoodnessOfFit::EvaluateADDistance(RooAbsPdf& pdf, RooAbsData& data, RooRealVar& observable, bool kolmo) {
+    // Fast path for binned template channels: the model CDF is a prefix sum
+    // over the bin yields already cached by CMSHistSum/CMSHistErrorPropagator
+    static bool cdfFromCache = runtimedef::get("GOF_KSAD_FROM_CACHE");
+    if (cdfFromCache && fillCdfFromCache(pdf, data, observable)) {
+        if (verbose >= 2) std::cout << "Using cached bin yields for the CDF of " << pdf.GetName() << std::endl;
+        return EvaluateADDistanceFromCdf(data, observable, kolmo);
+    }
+
     typedef std::pair<double, double> double_pair;
     std::vector<double_pair> data_points;
     Int_t n_data = data.numEntries();
-    Double_t s_data = data.sumEntries();
 
     const RooArgSet* datavals;
     RooRealVar* observable_val;
@@ -341,6 +373,87 @@ Double_t GoodnessOfFit::EvaluateADDistance(RooAbsPdf& pdf, RooAbsData& data, Roo
            return i.first < j.first;
          });
 
+    // CDF of the PDF
+    // If RooFit needs to use the scanning technique then increase the number
+    // of sampled bins from 1000 to 10000
+    std::unique_ptr<RooAbsReal> cdf(pdf.createCdf(observable, RooFit::ScanAllCdf(), RooFit::ScanParameters(10000, 2)));
+
+    ksadObs_.resize(data_points.size());
+    ksadWeights_.resize(data_points.size());
+    ksadCdf_.resize(data_points.size());
+    for (unsigned int i = 0, n = data_points.size(); i < n; ++i) {
+        // observableval = ((d+1)->first + d->first)/2.; // d->first is middle of bin, want upper edge.
+
+        // This is a better way to get the upper bin edge in the case where we
+        // have variable bin widths (I hope)
+        double observableval = observable.getBinning().binHigh(
+            observable.getBinning().binNumber(data_points[i].first));
+        observable.setVal(observableval);
+        ksadObs_[i] = observableval;
+        ksadWeights_[i] = data_points[i].second;
+        ksadCdf_[i] = cdf->getVal();
+    }
+
+    return EvaluateADDistanceFromCdf(data, observable, kolmo);
+}
+
+bool GoodnessOfFit::fillCdfFromCache(RooAbsPdf& pdf, RooAbsData& data, RooRealVar& observable) {
+    RooRealSumPdf *sumpdf = dynamic_cast<RooRealSumPdf *>(&pdf);
+    if (sumpdf == 0) return false;
+    int nbins = observable.getBins();
+    ksadBinYields_.assign(nbins, 0.);
+    for (int i = 0, n = sumpdf->funcList().getSize(); i < n; ++i) {
+        RooAbsReal *funci = dynamic_cast<RooAbsReal *>(sumpdf->funcList().at(i));
+        RooAbsReal *coeff = dynamic_cast<RooAbsReal *>(sumpdf->coefList().at(i));
+        if (funci == 0 || coeff == 0) return false;
+        FastHisto const* cache = 0;
+        // getVal() makes sure the cache is up-to-date with the current parameters
+        if (CMSHistSum const* hs = dynamic_cast<CMSHistSum const*>(funci)) {
+            hs->getVal();
+            cache = &hs->cache();
+        } else if (CMSHistErrorPropagator const* hep = dynamic_cast<CMSHistErrorPropagator const*>(funci)) {
+            hep->getVal();
+            cache = &hep->cache();
+        } else {
+            return false;
+        }
+        if (int(cache->size()) != nbins) return false;
+        double c = coeff->getVal();
+        for (int b = 0; b < nbins; ++b) ksadBinYields_[b] += c * (*cache)[b] * cache->GetWidth(b);
+    }
+    // turn the yields into the cumulative distribution
+    double total = 0.;
+    for (int b = 0; b < nbins; ++b) {
+        total += ksadBinYields_[b];
+        ksadBinYields_[b] = total;
+    }
+    if (!(total > 0)) return false;
+
+    // EDF from the binned data: we need at most one entry per bin, otherwise
+    // the result would differ from the per-event computation of the generic path
+    ksadBinWeights_.assign(nbins, 0.);
+    ksadBinHits_.assign(nbins, 0);
+    const RooAbsBinning &binning = observable.getBinning();
+    for (int i = 0, n = data.numEntries(); i < n; ++i) {
+        double x = data.get(i)->getRealValue(observable.GetName());
+        int b = binning.binNumber(x);
+        if (b < 0 || b >= nbins || ksadBinHits_[b]++) return false;
+        ksadBinWeights_[b] = data.weight();
+    }
+
+    ksadObs_.clear(); ksadWeights_.clear(); ksadCdf_.clear();
+    for (int b = 0; b < nbins; ++b) {
+        if (!ksadBinHits_[b]) continue;
+        ksadObs_.push_back(binning.binHigh(b));
+        ksadWeights_.push_back(ksadBinWeights_[b]);
+        ksadCdf_.push_back(ksadBinYields_[b]/total);
+    }
+    return true;
+}
+
+Double_t GoodnessOfFit::EvaluateADDistanceFromCdf(RooAbsData& data, RooRealVar& observable, bool kolmo) {
+    Double_t s_data = data.sumEntries();
+
     double test_stat = 0.;
     double current_cdf_val = 0.;
     double last_cdf_val = 0.;
@@ -349,10 +462,6 @@ Double_t GoodnessOfFit::EvaluateADDistance(RooAbsPdf& pdf, RooAbsData& data, Roo
     double bin_prob = 0.;
     double distance = 0.;
 
-    // CDF of the PDF
-    // If RooFit needs to use the scanning technique then increase the number
-    // of sampled bins from 1000 to 10000
-    std::unique_ptr<RooAbsReal> cdf(pdf.createCdf(observable, RooFit::ScanAllCdf(), RooFit::ScanParameters(10000, 2)));
     TH1 * hCdf = nullptr;
     TH1 * hEdf = nullptr;
     TH1 * hDiff = nullptr;
@@ -365,22 +474,14 @@ Double_t GoodnessOfFit::EvaluateADDistance(RooAbsPdf& pdf, RooAbsData& data, Roo
       hDiff->SetName((std::string(data.GetName())+"_diff").c_str());
     }
 
-    int bin = 0;
-    for (std::vector<double_pair>::const_iterator d = data_points.begin();
-         d != data_points.end(); d++, ++bin) {
-        // observableval = ((d+1)->first + d->first)/2.; // d->first is middle of bin, want upper edge.
-      
-        // This is a better way to get the upper bin edge in the case where we
-        // have variable bin widths (I hope)
-        observableval = observable.getBinning().binHigh(
-            observable.getBinning().binNumber(d->first));
-        observable.setVal(observableval);
-        // observable.bin
-        current_cdf_val = cdf->getVal();
-        if (d->second==0 && s_data ==0){
+    for (int bin = 0, n = ksadCdf_.size(); bin < n; ++bin) {
+        observableval = ksadObs_[bin];
+        current_cdf_val = ksadCdf_[bin];
+        double weight = ksadWeights_[bin];
+        if (weight==0 && s_data ==0){
           empirical_df = -1.;
         } else {
-          empirical_df += d->second/s_data;
+          empirical_df += weight/s_data;
         }
 
         if (plotDir_ && makePlots_) {
@@ -391,7 +492,7 @@ Double_t GoodnessOfFit::EvaluateADDistance(RooAbsPdf& pdf, RooAbsData& data, Roo
         if (kolmo){
             distance = std::abs(empirical_df-current_cdf_val);
             if (verbose >= 3) {
-              std::cout << "Observable: " << observableval << "\tdata: " << d->second << "\tedf: " << empirical_df << "\tcdf: " << current_cdf_val << "\tdistance: " << distance << "\n";
+              std::cout << "Observable: " << observableval << "\tdata: " << weight << "\tedf: " << empirical_df << "\tcdf: " << current_cdf_val << "\tdistance: " << distance << "\n";
             }
             if (distance > test_stat) test_stat = distance;
             if (empirical_df < 0.){
@@ -407,7 +508,7 @@ Double_t GoodnessOfFit::EvaluateADDistance(RooAbsPdf& pdf, RooAbsData& data, Roo
               distance = 0.;
             }
             if (verbose >= 3) {
-              std::cout << "Observable: " << observableval << "\tdata: " << d->second << "\tedf: " << empirical_df << "\tcdf: " << current_cdf_val << "\tdistance: " << distance << "\n";
+              std::cout << "Observable: " << observableval << "\tdata: " << weight << "\tedf: " << empirical_df << "\tcdf: " << current_cdf_val << "\tdistance: " << distance << "\n";
             }
             // from L. Demortier, CDF/ANAL/JET/CDFR/3419
             test_stat += distance;
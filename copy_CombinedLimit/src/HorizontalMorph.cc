@@ -0,0 +1,150 @@
+#include "../interface/HorizontalMorph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+void HorizontalMorph::init(int nb1, const double *edges1, const double *cdf1,
+                           int nb2, const double *edges2, const double *cdf2,
+                           int nbn, const double *outEdges, Convention convention) {
+    convention_ = convention;
+    nbn_ = nbn;
+    edges_.assign(outEdges, outEdges + nbn + 1);
+    widths_.resize(nbn);
+    for (int i = 0; i < nbn; ++i) widths_[i] = edges_[i+1] - edges_[i];
+
+    // Reference width at each output edge: CMSHistFunc takes the output bin found by FastHisto::FindBin,
+    // i.e. the one whose upper edge this is, th1fmorph the bin of the second template that contains it
+    dx_.resize(nbn + 1);
+    for (int ix = 0; ix <= nbn; ++ix) {
+        if (convention == HistFunc) {
+            int bin = std::lower_bound(edges_.begin(), edges_.end(), edges_[ix]) - edges_.begin() - 1;
+            bin = std::min(std::max(bin, 0), nbn - 1);
+            dx_[ix] = widths_[bin];
+        } else {
+            int bin = std::upper_bound(edges2, edges2 + nb2 + 1, edges_[ix]) - edges2 - 1;
+            bin = std::min(std::max(bin, 0), nb2 - 1);
+            dx_[ix] = 1.1 * (edges2[bin+1] - edges2[bin]);
+        }
+    }
+
+    // ......Step through all the edges of both input cdfs ordered by increasing y, from the first
+    //       non-zero points from below (ix1, ix2) to the first points from above that have the same
+    //       integral as the last edge (ix1l, ix2l).
+    x1_.clear(); x2_.clear(); y_.clear();
+    int ix1l = nb1, ix2l = nb2;
+    while (cdf1[ix1l - 1] >= cdf1[ix1l]) --ix1l;
+    while (cdf2[ix2l - 1] >= cdf2[ix2l]) --ix2l;
+    int ix1 = -1, ix2 = -1;
+    do { ++ix1; } while (cdf1[ix1 + 1] <= cdf1[0]);
+    do { ++ix2; } while (cdf2[ix2 + 1] <= cdf2[0]);
+
+    double x1 = edges1[ix1], x2 = edges2[ix2], y = 0, yprev = -1;
+    x1_.push_back(x1); x2_.push_back(x2); y_.push_back(0.);
+    // CMSHistFunc only skips decreasing steps of the first cdf, th1fmorph also the flat ones
+    const bool strict = (convention == HistFunc);
+    while ((ix1 < ix1l) | (ix2 < ix2l)) {
+        int i12type = -1;
+        // (the bounds are checked first, as cdf[nb + 1] is past the end)
+        if (ix1 < ix1l && (ix2 == ix2l || cdf1[ix1 + 1] <= cdf2[ix2 + 1])) {
+            ++ix1;
+            while (ix1 < ix1l && (strict ? cdf1[ix1 + 1] < cdf1[ix1] : cdf1[ix1 + 1] <= cdf1[ix1])) ++ix1;
+            i12type = 1;
+        } else if (ix2 < ix2l) {
+            ++ix2;
+            while (ix2 < ix2l && cdf2[ix2 + 1] <= cdf2[ix2]) ++ix2;
+            i12type = 2;
+        }
+        // ......Where the cumulative probability y of one distribution intersects the segment of the
+        //       other one which brackets it
+        if (i12type == 1) {
+            x1 = edges1[ix1];
+            y = cdf1[ix1];
+            double x20 = edges2[ix2], y20 = cdf2[ix2], x21 = x20, y21 = y20;
+            if (ix2 < ix2l) { x21 = edges2[ix2 + 1]; y21 = cdf2[ix2 + 1]; }
+            x2 = (y21 > y20 ? x20 + (x21 - x20) * (y - y20) / (y21 - y20) : x20);
+        } else {
+            x2 = edges2[ix2];
+            y = cdf2[ix2];
+            double x10 = edges1[ix1], y10 = cdf1[ix1], x11 = x10, y11 = y10;
+            if (ix1 < ix1l) { x11 = edges1[ix1 + 1]; y11 = cdf1[ix1 + 1]; }
+            x1 = (y11 > y10 ? x10 + (x11 - x10) * (y - y10) / (y11 - y10) : x10);
+        }
+        if (y > yprev) {
+            yprev = y;
+            x1_.push_back(x1); x2_.push_back(x2); y_.push_back(y);
+        }
+    }
+
+    xdisn_.resize(y_.size());
+    sigdisf_.resize(nbn + 1);
+}
+
+void HorizontalMorph::clear() {
+    nbn_ = 0;
+    edges_.clear(); widths_.clear(); dx_.clear();
+    x1_.clear(); x2_.clear(); y_.clear();
+    xdisn_.clear(); sigdisf_.clear();
+}
+
+bool HorizontalMorph::weights(double par1, double par2, double parinterp, double &wt1, double &wt2) {
+    if (par2 != par1) {
+        wt1 = 1. - (parinterp - par1) / (par2 - par1);
+        wt2 = 1. + (parinterp - par2) / (par2 - par1);
+    } else {
+        wt1 = 0.5;
+        wt2 = 0.5;
+    }
+    return !(wt1 < 0 || wt1 > 1. || wt2 < 0. || wt2 > 1. || std::abs(1 - (wt1 + wt2)) > 1.0e-4);
+}
+
+void HorizontalMorph::morph(double wt1, double wt2, double *out, bool density) const {
+    const int last = y_.size() - 1;
+    const double *x1 = &x1_[0], *x2 = &x2_[0], *ys = &y_[0], *edges = &edges_[0];
+    double *xdisn = &xdisn_[0], *sigdisf = &sigdisf_[0];
+
+    // ......The morphed cdf, at the levels of the table
+    for (int i = 0; i <= last; ++i) xdisn[i] = wt1 * x1[i] + wt2 * x2[i];
+
+    // ......Its value at the output edges: the last level after its last point, the first one up to
+    //       the first edge above its first point, and in between a linear interpolation found by
+    //       walking the two monotonic sequences together
+    int ix = nbn_;
+    while (ix >= 0 && edges[ix] >= xdisn[last]) sigdisf[ix--] = ys[last];
+    const int ixl = ix + 1;
+    ix = 0;
+    while (ix < nbn_ && edges[ix + 1] <= xdisn[0]) sigdisf[ix++] = ys[0];
+    const int ixf = ix;
+
+    const bool histfunc = (convention_ == HistFunc);
+    int ix3 = 0;
+    for (ix = ixf; ix < ixl; ++ix) {
+        double x = edges[ix], y;
+        if (x < xdisn[0]) {
+            y = 0;
+        } else if (x > xdisn[last]) {
+            y = 1.;
+        } else {
+            while (ix3 < last && xdisn[ix3 + 1] <= x) ++ix3;
+            double next = xdisn[ix3 + 1];
+            if (histfunc ? next - x >= dx_[ix] : next - x > dx_[ix]) {  // Empty bin treatment
+                y = histfunc ? ys[ix3] : ys[ix3 + 1];
+            } else if (next > xdisn[ix3]) {  // Normal bins
+                y = ys[ix3] + (ys[ix3 + 1] - ys[ix3]) * (x - xdisn[ix3]) / (next - xdisn[ix3]);
+            } else {
+                y = 0;
+                std::cout << "Warning - th1fmorph: This probably shoudn't happen! " << std::endl;
+                std::cout << "Warning - th1fmorph: Zero slope solving x(y)" << std::endl;
+            }
+        }
+        sigdisf[ix] = y;
+    }
+
+    // ......Differentiate the projected cdf
+    if (density) {
+        const double *widths = &widths_[0];
+        for (int i = 0; i < nbn_; ++i) out[i] = (sigdisf[i + 1] - sigdisf[i]) / widths[i];
+    } else {
+        for (int i = 0; i < nbn_; ++i) out[i] = sigdisf[i + 1] - sigdisf[i];
+    }
+}
@@ -46,6 +46,7 @@
 #include "../interface/Significance.h"
 #include "../interface/ProfilingTools.h"
 #include "../interface/CombineLogger.h"
+#include "../interface/JacknifeQuantile.h"
 
 using namespace RooStats;
 using namespace std;
@@ -1221,6 +1222,25 @@ std::pair<double,double> HybridNew::eval(const RooStats::HypoTestResult &hcres,
     }
 }
 
+namespace {
+    /// test statistic at the given quantile of the toys, i.e. the element floor(quantile * ntoys + 0.5) of the sorted toys.
+    /// With --X-rtd HYBRIDNEW_QUANTILE_SKETCH=<compression>, it is estimated from a QuantileSketch of the weighted toys instead.
+    double toyQuantile(const RooStats::SamplingDistribution &dist, double quantile) {
+        const std::vector<Double_t> &values = dist.GetSamplingDistribution();
+        if (values.empty()) throw std::runtime_error("HybridNew: can't compute a quantile of an empty distribution of toys");
+        if (int compression = runtimedef::get("HYBRIDNEW_QUANTILE_SKETCH")) {
+            // unit weights, as in the exact quantile below
+            QuantileSketch sketch(compression, 1);
+            for (Double_t v : values) sketch.add(v);
+            return sketch.quantile(quantile);
+        }
+        std::vector<Double_t> toys(values);
+        std::vector<Double_t>::iterator nth = toys.begin() + std::min<int>(floor(quantile * toys.size()+0.5), toys.size()-1);
+        std::nth_element(toys.begin(), nth, toys.end());
+        return *nth;
+    }
+}
+
 void HybridNew::applyExpectedQuantile(RooStats::HypoTestResult &hcres) {
   if (expectedFromGrid_) {
       if (workingMode_ == MakeSignificance || workingMode_ == MakeSignificanceTestStatistics) {
@@ -1228,9 +1248,7 @@ void HybridNew::applyExpectedQuantile(RooStats::HypoTestResult &hcres) {
       } else if (clsQuantiles_) {
           applyClsQuantile(hcres);
       } else {
-          std::vector<Double_t> btoys = hcres.GetNullDistribution()->GetSamplingDistribution();
-          std::sort(btoys.begin(), btoys.end());
-          Double_t testStat = btoys[std::min<int>(floor((1.-quantileForExpectedFromGrid_) * btoys.size()+0.5), btoys.size())];
+          Double_t testStat = toyQuantile(*hcres.GetNullDistribution(), 1.-quantileForExpectedFromGrid_);
           if (verbose > 0) CombineLogger::instance().log("HybridNew.cc",__LINE__,std::string(Form("Test statistic for %.3f quantile: %.3f",quantileForExpectedFromGrid_,testStat)),__func__);
           hcres.SetTestStatisticData(testStat);
           //std::cout << "CLs quantile = " << (CLs_ ? hcres.CLs() : hcres.CLsplusb()) << " for test stat = " << testStat << std::endl;
@@ -1316,9 +1334,7 @@ void HybridNew::applyClsQuantile(RooStats::HypoTestResult &hcres) {
 }
 
 void HybridNew::applySignalQuantile(RooStats::HypoTestResult &hcres) {
-    std::vector<Double_t> stoys = hcres.GetAltDistribution()->GetSamplingDistribution();
-    std::sort(stoys.begin(), stoys.end());
-    Double_t testStat = stoys[std::min<int>(floor(quantileForExpectedFromGrid_ * stoys.size()+0.5), stoys.size())];
+    Double_t testStat = toyQuantile(*hcres.GetAltDistribution(), quantileForExpectedFromGrid_);
     if (verbose > 0)  CombineLogger::instance().log("HybridNew.cc",__LINE__,std::string(Form("Test statistic for %.3f quantile: %.3f",quantileForExpectedFromGrid_,testStat)),__func__);
     hcres.SetTestStatisticData(testStat);
 }
@@ -162,3 +162,203 @@ void QuantileCalculator::quantiles(double quantile, bool doJacknife)
         }
     }
 }
+
+QuantileSketch::QuantileSketch(double compression, unsigned int sections) :
+    compression_(compression), next_(0), sections_(sections)
+{
+    if (sections == 0 || compression < 10) throw std::invalid_argument("QuantileSketch: needs at least one section and a compression of at least 10");
+}
+
+QuantileSketch::QuantileSketch(const std::vector<double> &serialized) :
+    next_(0)
+{
+    // version, compression, number of sections, next section, then for each section
+    // sum of weights, min, max, number of centroids and (mean, weight) of each centroid
+    if (serialized.size() < 4 || serialized[0] != 1) throw std::invalid_argument("QuantileSketch: unsupported serialized data");
+    compression_ = serialized[1];
+    if (!(compression_ >= 10) || std::isinf(compression_)) throw std::invalid_argument("QuantileSketch: invalid compression in serialized data");
+    // the counts are stored as doubles: reject anything that is not a small non-negative integer
+    auto count = [&serialized](unsigned int k) -> unsigned int {
+        double c = serialized[k];
+        if (!(c >= 0 && c <= serialized.size() && c == std::floor(c))) throw std::invalid_argument("QuantileSketch: invalid count in serialized data");
+        return c;
+    };
+    unsigned int sections = count(2);
+    next_ = count(3);
+    if (sections == 0 || next_ >= sections) throw std::invalid_argument("QuantileSketch: invalid sections in serialized data");
+    sections_.resize(sections);
+    unsigned int k = 4;
+    for (Digest &d : sections_) {
+        if (k + 4 > serialized.size()) throw std::invalid_argument("QuantileSketch: truncated serialized data");
+        d.sumw = serialized[k]; d.min = serialized[k+1]; d.max = serialized[k+2];
+        unsigned int n = count(k+3);
+        k += 4;
+        if (k + 2*n > serialized.size()) throw std::invalid_argument("QuantileSketch: truncated serialized data");
+        d.centroids.resize(n);
+        for (unsigned int i = 0; i < n; ++i, k += 2) d.centroids[i] = std::make_pair(serialized[k], serialized[k+1]);
+    }
+    if (k != serialized.size()) throw std::invalid_argument("QuantileSketch: trailing serialized data");
+}
+
+void QuantileSketch::add(double x, double w)
+{
+    if (w <= 0) return;
+    sections_[next_].add(x, w, compression_);
+    if (++next_ == sections_.size()) next_ = 0;
+}
+
+void QuantileSketch::merge(const QuantileSketch &other)
+{
+    if (other.sections_.size() != sections_.size()) throw std::invalid_argument("QuantileSketch: can't merge sketches with a different number of sections");
+    other.flush();
+    for (unsigned int j = 0, m = sections_.size(); j < m; ++j) sections_[j].absorb(other.sections_[j], compression_);
+}
+
+void QuantileSketch::flush() const
+{
+    for (Digest &d : sections_) d.flush(compression_);
+}
+
+QuantileSketch::Digest QuantileSketch::mergedExcept(int skip) const
+{
+    flush();
+    Digest ret;
+    for (int j = 0, m = sections_.size(); j < m; ++j) {
+        if (j != skip) ret.absorb(sections_[j], compression_);
+    }
+    ret.flush(compression_);
+    return ret;
+}
+
+double QuantileSketch::quantile(double quantile) const
+{
+    if (sections_.size() == 1) { flush(); return sections_[0].quantile(quantile); }
+    return mergedExcept(-1).quantile(quantile);
+}
+
+std::pair<double,double> QuantileSketch::quantileAndError(double quantile, QuantileCalculator::Method method) const
+{
+    if (method == QuantileCalculator::Simple) {
+        return std::pair<double,double>(this->quantile(quantile), 0);
+    }
+    int m = sections_.size();
+    if (m < 2) throw std::logic_error("QuantileSketch: at least two sections are needed to estimate the error");
+    std::vector<double> values(m);
+    if (method == QuantileCalculator::Sectioning) {
+        flush();
+        for (int j = 0; j < m; ++j) values[j] = sections_[j].quantile(quantile);
+    } else if (method == QuantileCalculator::Jacknife) {
+        // pseudo-values m * quantile(all) - (m-1) * quantile(all but section j)
+        double all = this->quantile(quantile);
+        for (int j = 0; j < m; ++j) values[j] = m * all - (m-1) * mergedExcept(j).quantile(quantile);
+    } else {
+        return std::pair<double,double>(0,-1);
+    }
+    double avg = 0;
+    for (int j = 0; j < m; ++j) avg += values[j];
+    avg /= m;
+    double rms = 0;
+    for (int j = 0; j < m; ++j) rms += (values[j] - avg)*(values[j] - avg);
+    rms = sqrt(rms/(m*(m-1)));
+    double onesigma = ROOT::Math::tdistribution_quantile_c(0.16, m-1);
+    return std::pair<double,double>(avg, rms * onesigma);
+}
+
+double QuantileSketch::sumOfWeights() const
+{
+    double ret = 0;
+    for (const Digest &d : sections_) ret += d.sumw;
+    return ret;
+}
+
+unsigned int QuantileSketch::size() const
+{
+    flush();
+    unsigned int ret = 0;
+    for (const Digest &d : sections_) ret += d.centroids.size();
+    return ret;
+}
+
+std::vector<double> QuantileSketch::serialize() const
+{
+    flush();
+    std::vector<double> ret = { 1, compression_, double(sections_.size()), double(next_) };
+    for (const Digest &d : sections_) {
+        ret.push_back(d.sumw); ret.push_back(d.min); ret.push_back(d.max); ret.push_back(d.centroids.size());
+        for (const auto &c : d.centroids) { ret.push_back(c.first); ret.push_back(c.second); }
+    }
+    return ret;
+}
+
+void QuantileSketch::Digest::add(double x, double w, double compression)
+{
+    if (sumw == 0 && buffer.empty()) { min = max = x; }
+    else { min = std::min(min, x); max = std::max(max, x); }
+    buffer.push_back(std::make_pair(x, w));
+    sumw += w;
+    if (buffer.size() >= 5*compression) flush(compression);
+}
+
+void QuantileSketch::Digest::absorb(const Digest &other, double compression)
+{
+    if (other.sumw == 0) return;
+    if (sumw == 0) { min = other.min; max = other.max; }
+    else { min = std::min(min, other.min); max = std::max(max, other.max); }
+    buffer.insert(buffer.end(), other.centroids.begin(), other.centroids.end());
+    buffer.insert(buffer.end(), other.buffer.begin(), other.buffer.end());
+    sumw += other.sumw;
+    if (buffer.size() >= 5*compression) flush(compression);
+}
+
+void QuantileSketch::Digest::flush(double compression)
+{
+    if (buffer.empty()) return;
+    buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+    std::sort(buffer.begin(), buffer.end());
+    centroids.clear();
+    // merge neighbours as long as the centroid spans less than one unit of the scale function
+    // k(q) = compression/(2 pi) * asin(2q-1), so that the centroids are small in the tails
+    const double norm = compression / (2*M_PI);
+    double sofar = 0, qlimit = 0;
+    auto limit = [&](double q) { return 0.5 * (1 + sin(std::min(asin(2*q - 1) + 1/norm, 0.5*M_PI))); };
+    std::pair<double,double> current = buffer.front();
+    qlimit = limit(0);
+    for (unsigned int i = 1, n = buffer.size(); i < n; ++i) {
+        const std::pair<double,double> &next = buffer[i];
+        if ((sofar + current.second + next.second) / sumw <= qlimit) {
+            current.second += next.second;
+            current.first  += (next.first - current.first) * next.second / current.second;
+        } else {
+            sofar += current.second;
+            centroids.push_back(current);
+            qlimit = limit(sofar / sumw);
+            current = next;
+        }
+    }
+    centroids.push_back(current);
+    buffer.clear();
+}
+
+double QuantileSketch::Digest::quantile(double q) const
+{
+    if (centroids.empty()) return 0;
+    if (centroids.size() == 1) return min + q * (max - min);
+    // each centroid is taken to sit at the middle of its weight, with linear interpolation in between
+    double target = q * sumw;
+    const std::pair<double,double> &first = centroids.front(), &last = centroids.back();
+    if (target <= 0.5 * first.second) {
+        return min + (first.first - min) * (first.second > 0 ? target / (0.5 * first.second) : 1);
+    }
+    if (target >= sumw - 0.5 * last.second) {
+        return last.first + (max - last.first) * (target - (sumw - 0.5 * last.second)) / (0.5 * last.second);
+    }
+    double left = 0.5 * first.second;
+    for (unsigned int i = 0, n = centroids.size(); i + 1 < n; ++i) {
+        double right = left + 0.5 * (centroids[i].second + centroids[i+1].second);
+        if (target <= right) {
+            return centroids[i].first + (centroids[i+1].first - centroids[i].first) * (target - left) / (right - left);
+        }
+        left = right;
+    }
+    return last.first;
+}
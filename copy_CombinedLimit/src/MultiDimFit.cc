@@ -62,6 +62,7 @@ bool        MultiDimFit::robustHesse_ = false;
 std::string MultiDimFit::robustHesseLoad_ = "";
 std::string MultiDimFit::robustHesseSave_ = "";
 int MultiDimFit::pointsRandProf_ = 0;
+int MultiDimFit::pointsRandProfWorkers_ = 1;
 int MultiDimFit::randPointsSeed_ = 0;
 std::string MultiDimFit::setParameterRandomInitialValueRanges_;
 
@@ -117,6 +118,7 @@ MultiDimFit::MultiDimFit() :
         ("robustHesseLoad",  boost::program_options::value<std::string>(&robustHesseLoad_)->default_value(robustHesseLoad_),  "Load the pre-calculated Hessian")
         ("robustHesseSave",  boost::program_options::value<std::string>(&robustHesseSave_)->default_value(robustHesseSave_),  "Save the calculated Hessian")
         ("pointsRandProf",  boost::program_options::value<int>(&pointsRandProf_)->default_value(pointsRandProf_),  "Number of random start points to try for the profiled POIs")
+        ("pointsRandProfWorkers",  boost::program_options::value<int>(&pointsRandProfWorkers_)->default_value(pointsRandProfWorkers_),  "Minimise the start points of the profiled POIs in this many forked processes at a time")
         ("randPointsSeed",  boost::program_options::value<int>(&randPointsSeed_)->default_value(randPointsSeed_),  "Seed to use when generating random start points to try for the profiled POIs")
         ("setParameterRandomInitialValueRanges",  boost::program_options::value<std::string>(&setParameterRandomInitialValueRanges_)->default_value(""),  "Range from which to draw random start points for the profiled POIs. This range should be equal to or smaller than the max and min values for the profiled POIs. Does not override max/min ranges for the given POIs. E.g. usage: c1=-5,5:c2=-1,1")
         ;
@@ -721,7 +723,8 @@ void MultiDimFit::doGrid(RooWorkspace *w, RooAbsReal &nll)
 		    specifiedCatNames_,
 		    specifiedCat_,
 		    specifiedCatVals_,
-		    nOtherFloatingPoi_);
+		    nOtherFloatingPoi_,
+		    pointsRandProfWorkers_);
             randStartPt.doRandomStartPt1DGridScan(x, n, poiVals_, poiVars_, params, snap, deltaNLL_, nll0, minim);
 
         } // End of the loop over scan points
@@ -824,7 +827,8 @@ void MultiDimFit::doGrid(RooWorkspace *w, RooAbsReal &nll)
 			specifiedCatNames_,
 			specifiedCat_,
 			specifiedCatVals_,
-			nOtherFloatingPoi_);
+			nOtherFloatingPoi_,
+			pointsRandProfWorkers_);
                 randStartPt.doRandomStartPt2DGridScan(x, y, n, poiVals_, poiVars_, params, snap, deltaNLL_, nll0, gridType_, deltaX, deltaY, minim);
             } //End of loop over y scan points
         } //End of loop over x scan points
@@ -0,0 +1,110 @@
+#include "../interface/ProcessNormalizationBank.h"
+#include "../interface/ProcessNormalization.h"
+#include "../interface/CombineMathFuncs.h"
+
+#include <cmath>
+
+ProcessNormalizationBank::ProcessNormalizationBank() :
+    sentry_("ProcessNormalizationBank_sentry", ""),
+    first_(true),
+    symStart_(1, 0), asymStart_(1, 0), otherStart_(1, 0)
+{
+}
+
+unsigned int ProcessNormalizationBank::column(const RooAbsReal &arg) {
+    auto found = argIndex_.find(&arg);
+    if (found != argIndex_.end()) return found->second;
+    unsigned int col = args_.size();
+    argIndex_[&arg] = col;
+    args_.push_back(&arg);
+    argVals_.push_back(0.);
+    argRows_.emplace_back();
+    sentry_.addArg(arg);
+    return col;
+}
+
+unsigned int ProcessNormalizationBank::add(const ProcessNormalization &norm) {
+    unsigned int row = values_.size();
+    nominal_.push_back(norm.nominalValue());
+    // keep the terms in the same order as in ProcessNormalization::evaluate, so that the result is the same
+    const RooArgList &thetas = norm.thetaList();
+    for (int i = 0, n = thetas.getSize(); i < n; ++i) {
+        symCol_.push_back(column(static_cast<const RooAbsReal &>(thetas[i])));
+        symLogKappa_.push_back(norm.logKappa()[i]);
+    }
+    symStart_.push_back(symCol_.size());
+    const RooArgList &asymmThetas = norm.asymmThetaList();
+    for (int i = 0, n = asymmThetas.getSize(); i < n; ++i) {
+        asymCol_.push_back(column(static_cast<const RooAbsReal &>(asymmThetas[i])));
+        asymLogKappaLo_.push_back(norm.logAsymmKappa()[i].first);
+        asymLogKappaHi_.push_back(norm.logAsymmKappa()[i].second);
+    }
+    asymStart_.push_back(asymCol_.size());
+    const RooArgList &others = norm.otherFactorList();
+    for (int i = 0, n = others.getSize(); i < n; ++i) {
+        otherCol_.push_back(column(static_cast<const RooAbsReal &>(others[i])));
+    }
+    otherStart_.push_back(otherCol_.size());
+
+    // the rows that depend on each input (once, even if the input appears in several terms)
+    for (unsigned int k = symStart_[row]; k < symStart_[row+1]; ++k) {
+        if (argRows_[symCol_[k]].empty() || argRows_[symCol_[k]].back() != row) argRows_[symCol_[k]].push_back(row);
+    }
+    for (unsigned int k = asymStart_[row]; k < asymStart_[row+1]; ++k) {
+        if (argRows_[asymCol_[k]].empty() || argRows_[asymCol_[k]].back() != row) argRows_[asymCol_[k]].push_back(row);
+    }
+    for (unsigned int k = otherStart_[row]; k < otherStart_[row+1]; ++k) {
+        if (argRows_[otherCol_[k]].empty() || argRows_[otherCol_[k]].back() != row) argRows_[otherCol_[k]].push_back(row);
+    }
+
+    values_.push_back(0.);
+    dirty_.push_back(1);
+    first_ = true;
+    return row;
+}
+
+void ProcessNormalizationBank::evaluateRow(unsigned int row) {
+    // same as RooFit::Detail::MathFuncs::processNormalization, reading the inputs through the column indices
+    const double *vals = argVals_.data();
+    double logVal = 0.0;
+    for (unsigned int k = symStart_[row], end = symStart_[row+1]; k < end; ++k) {
+        logVal += vals[symCol_[k]] * symLogKappa_[k];
+    }
+    for (unsigned int k = asymStart_[row], end = asymStart_[row+1]; k < end; ++k) {
+        double x = vals[asymCol_[k]];
+        logVal += x * RooFit::Detail::MathFuncs::logKappaForX(x, asymLogKappaLo_[k], asymLogKappaHi_[k]);
+    }
+    double norm = nominal_[row];
+    norm *= std::exp(logVal);
+    for (unsigned int k = otherStart_[row], end = otherStart_[row+1]; k < end; ++k) {
+        norm *= vals[otherCol_[k]];
+    }
+    values_[row] = norm;
+}
+
+void ProcessNormalizationBank::update() {
+    if (!first_ && sentry_.good()) return;
+
+    // gather each input once, and find which rows are affected by the ones that changed
+    dirtyRows_.clear();
+    for (unsigned int col = 0, ncol = args_.size(); col < ncol; ++col) {
+        double val = args_[col]->getVal();
+        if (val == argVals_[col] && !first_) continue;
+        argVals_[col] = val;
+        for (unsigned int row : argRows_[col]) {
+            if (!dirty_[row]) { dirty_[row] = 1; dirtyRows_.push_back(row); }
+        }
+    }
+    if (first_) {
+        // also rows without any input, and those added since the last update
+        dirtyRows_.clear();
+        for (unsigned int row = 0, nrow = values_.size(); row < nrow; ++row) { dirty_[row] = 1; dirtyRows_.push_back(row); }
+    }
+
+    for (unsigned int row : dirtyRows_) {
+        evaluateRow(row);
+        dirty_[row] = 0;
+    }
+    first_ = false;
+    sentry_.reset();
+}
@@ -8,7 +8,13 @@
 #include <unistd.h>
 
 #include <cassert>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <unordered_map>
+#include <vector>
 
 void (*igProfRequestDump_)(const char *);
 int igProfDumpNumber_ = 0;
@@ -70,3 +76,150 @@ namespace runtimedef {
     }
 }
 
+
+namespace profiler {
+    std::atomic<bool> enabled_(false);
+
+    namespace {
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point start_ = Clock::now();
+        std::atomic<unsigned long> maxTraceEvents_(2000000);
+
+        inline unsigned long long now() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_).count();
+        }
+
+        struct Node {
+            const char *name;
+            int parent;
+            std::vector<int> children;
+            unsigned long long total = 0, calls = 0;
+            Node(const char *n, int p) : name(n), parent(p) {}
+        };
+        struct Event {
+            const char *name;
+            unsigned long long begin, duration;
+        };
+        struct ThreadBuffer {
+            int tid;
+            std::vector<Node> nodes;   // call tree, nodes[0] is the root
+            std::vector<std::pair<int, unsigned long long> > open; // node and start time of the open regions
+            std::vector<Event> events;
+            unsigned long long dropped = 0;
+            ThreadBuffer(int id) : tid(id) { nodes.emplace_back("", -1); }
+        };
+
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<ThreadBuffer> > buffers_;
+        std::set<std::string> names_;
+
+        ThreadBuffer & buffer() {
+            thread_local ThreadBuffer *buf = nullptr;
+            if (buf == nullptr) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                buffers_.emplace_back(new ThreadBuffer(buffers_.size()));
+                buf = buffers_.back().get();
+            }
+            return *buf;
+        }
+
+        std::string escapeJSON(const char *name) {
+            std::string ret;
+            for (const char *c = name; *c; ++c) {
+                if (*c == '"' || *c == '\\') ret += '\\';
+                if (static_cast<unsigned char>(*c) < 0x20) { ret += ' '; continue; }
+                ret += *c;
+            }
+            return ret;
+        }
+
+        void foldStacks(const ThreadBuffer &buf, int node, const std::string &prefix, std::map<std::string, unsigned long long> &out) {
+            const Node &n = buf.nodes[node];
+            std::string path = prefix;
+            if (node != 0) {
+                std::string name(n.name);
+                for (char &c : name) if (c == ';' || c == ' ') c = '_';
+                path += (prefix.empty() ? "" : ";") + name;
+                unsigned long long self = n.total;
+                for (int child : n.children) self -= std::min(self, buf.nodes[child].total);
+                if (self >= 1000) out[path] += self / 1000;
+            }
+            for (int child : n.children) foldStacks(buf, child, path, out);
+        }
+    }
+
+    void enable(bool on, unsigned long maxTraceEvents) {
+        maxTraceEvents_ = maxTraceEvents;
+        enabled_ = on;
+    }
+
+    const char * intern(const std::string &name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return names_.insert(name).first->c_str();
+    }
+
+    void begin(const char *name) {
+        ThreadBuffer &buf = buffer();
+        int parent = buf.open.empty() ? 0 : buf.open.back().first, node = -1;
+        for (int child : buf.nodes[parent].children) {
+            if (buf.nodes[child].name == name) { node = child; break; }
+        }
+        if (node == -1) {
+            node = buf.nodes.size();
+            buf.nodes.emplace_back(name, parent);
+            buf.nodes[parent].children.push_back(node);
+        }
+        buf.open.emplace_back(node, now());
+    }
+
+    void end() {
+        unsigned long long stop = now();
+        ThreadBuffer &buf = buffer();
+        if (buf.open.empty()) return;
+        int node = buf.open.back().first;
+        unsigned long long start = buf.open.back().second;
+        buf.open.pop_back();
+        Node &n = buf.nodes[node];
+        n.total += stop - start;
+        n.calls++;
+        if (buf.events.size() < maxTraceEvents_.load(std::memory_order_relaxed)) {
+            buf.events.push_back(Event{n.name, start, stop - start});
+        } else {
+            buf.dropped++;
+        }
+    }
+
+    bool writeChromeTrace(const std::string &fileName) {
+        FILE *f = fopen(fileName.c_str(), "w");
+        if (f == nullptr) return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        int pid = getpid();
+        fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        bool first = true;
+        for (const auto &buf : buffers_) {
+            fprintf(f, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"thread %d\"}}", first ? "" : ",\n", pid, buf->tid, buf->tid);
+            first = false;
+            for (const Event &e : buf->events) {
+                fprintf(f, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d}",
+                        escapeJSON(e.name).c_str(), e.begin * 1e-3, e.duration * 1e-3, pid, buf->tid);
+            }
+            if (buf->dropped) {
+                fprintf(stderr, "Profiler: %llu regions of thread %d not written to the trace (maximum number of events reached)\n", buf->dropped, buf->tid);
+            }
+        }
+        fprintf(f, "\n]}\n");
+        return fclose(f) == 0;
+    }
+
+    bool writeFoldedStacks(const std::string &fileName) {
+        FILE *f = fopen(fileName.c_str(), "w");
+        if (f == nullptr) return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<std::string, unsigned long long> stacks;
+        for (const auto &buf : buffers_) foldStacks(*buf, 0, "", stacks);
+        for (const auto &stack : stacks) {
+            fprintf(f, "%s %llu\n", stack.first.c_str(), stack.second);
+        }
+        return fclose(f) == 0;
+    }
+}
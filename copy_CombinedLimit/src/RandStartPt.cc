@@ -2,16 +2,24 @@
 #include "../interface/Combine.h"
 #include "../interface/utils.h"
 #include "../interface/CascadeMinimizer.h"
+#include "../interface/Significance.h"
+#include "../interface/CombineLogger.h"
 
 #include <vector>
 #include <iostream>
 #include <cmath>
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include "TMath.h"
+#include "TString.h"
 #include "TFile.h"
 #include "RooArgSet.h"
 #include "RooArgList.h"
 #include "RooRealVar.h"
+#include "RooCategory.h"
 #include "RooMinimizer.h"
 
 #include <Math/Minimizer.h>
@@ -19,7 +27,7 @@
 #include <Math/QuantFuncMathCore.h>
 #include <Math/ProbFunc.h>
 
-RandStartPt::RandStartPt(RooAbsReal& nll, std::vector<RooRealVar* > &specifiedvars, std::vector<float> &specifiedvals, bool skipdefaultstart, std::string parameterRandInitialValranges, int numrandpts, int verbose, bool fastscan, bool hasmaxdeltaNLLforprof, float maxdeltaNLLforprof, std::vector<std::string> &specifiednuis, std::vector<std::string> &specifiedfuncnames, std::vector<RooAbsReal*> &specifiedfunc, std::vector<float> &specifiedfuncvals, std::vector<std::string> &specifiedcatnames, std::vector<RooCategory*> &specifiedcat, std::vector<int> &specifiedcatvals, unsigned int nOtherFloatingPOI) :
+RandStartPt::RandStartPt(RooAbsReal& nll, std::vector<RooRealVar* > &specifiedvars, std::vector<float> &specifiedvals, bool skipdefaultstart, std::string parameterRandInitialValranges, int numrandpts, int verbose, bool fastscan, bool hasmaxdeltaNLLforprof, float maxdeltaNLLforprof, std::vector<std::string> &specifiednuis, std::vector<std::string> &specifiedfuncnames, std::vector<RooAbsReal*> &specifiedfunc, std::vector<float> &specifiedfuncvals, std::vector<std::string> &specifiedcatnames, std::vector<RooCategory*> &specifiedcat, std::vector<int> &specifiedcatvals, unsigned int nOtherFloatingPOI, int numworkers) :
     nll_(nll),
     specifiedvars_(specifiedvars),
     specifiedvals_(specifiedvals),
@@ -37,10 +45,47 @@ RandStartPt::RandStartPt(RooAbsReal& nll, std::vector<RooRealVar* > &specifiedva
     specifiedcatnames_(specifiedcatnames),
     specifiedcat_(specifiedcat),
     specifiedcatvals_(specifiedcatvals),
-    nOtherFloatingPOI_(nOtherFloatingPOI)
+    nOtherFloatingPOI_(nOtherFloatingPOI),
+    numworkers_(numworkers)
 
     {}
 
+namespace {
+    bool writeAll(int fd, const void *buf, size_t len) {
+        const char *p = static_cast<const char *>(buf);
+        while (len > 0) {
+            ssize_t ret = ::write(fd, p, len);
+            if (ret < 0 && errno == EINTR) continue;
+            if (ret <= 0) return false;
+            p += ret; len -= ret;
+        }
+        return true;
+    }
+    bool readAll(int fd, void *buf, size_t len) {
+        char *p = static_cast<char *>(buf);
+        while (len > 0) {
+            ssize_t ret = ::read(fd, p, len);
+            if (ret < 0 && errno == EINTR) continue;
+            if (ret <= 0) return false;
+            p += ret; len -= ret;
+        }
+        return true;
+    }
+    void readValues(const RooAbsCollection &params, std::vector<double> &vals) {
+        vals.assign(params.getSize(), 0.);
+        for (int i = 0; i < params.getSize(); ++i) {
+            if (RooRealVar *rrv = dynamic_cast<RooRealVar *>(params[i])) vals[i] = rrv->getVal();
+            else if (RooCategory *rc = dynamic_cast<RooCategory *>(params[i])) vals[i] = rc->getIndex();
+        }
+    }
+    void writeValues(const RooAbsCollection &params, const std::vector<double> &vals) {
+        for (int i = 0; i < params.getSize(); ++i) {
+            if (RooRealVar *rrv = dynamic_cast<RooRealVar *>(params[i])) rrv->setVal(vals[i]);
+            else if (RooCategory *rc = dynamic_cast<RooCategory *>(params[i])) rc->setIndex(int(vals[i]));
+        }
+    }
+}
+
 std::vector<std::vector<float>> RandStartPt::vectorOfPointsToTry (){
     std::vector<std::vector<float>> wc_vals_vec_of_vec = {};
     int n_prof_params = specifiedvars_.size();
@@ -148,17 +193,117 @@ void RandStartPt::setValSpecifiedObjs(){
     }
 }
 
+RandStartPt::StartResult RandStartPt::minimizeOneStart(unsigned int startptIdx, const std::function<void(unsigned int)> &setStart, RooArgSet &param, double nll_init, bool hasBest, double bestNll, CascadeMinimizer &minimObj){
+    StartResult res;
+    setStart(startptIdx);
+    nll_.clearEvalErrorLog();
+    double nllStart = nll_.getVal();
+    // the start points that are not minimised are left to the main process
+    if (nll_.numEvalErrors() > 0 || (hasmaxdeltaNLLforprof_ && (nllStart - nll_init) > maxdeltaNLLforprof_)) return res;
+    res.done = true;
+    if (hasmaxdeltaNLLforprof_ && hasBest) {
+        // early abort: a pre-fit with a looser tolerance, and no full minimisation if that is still far above the best start
+        std::string type(ROOT::Math::MinimizerOptions::DefaultMinimizerType()), algo(ROOT::Math::MinimizerOptions::DefaultMinimizerAlgo());
+        {
+            Significance::MinimizerSentry minimizerConfig(type+","+algo, 10*ROOT::Math::MinimizerOptions::DefaultTolerance());
+            minimObj.improve(verbosity_-2, /*cascade=*/false);
+        }
+        res.aborted = (nll_.getVal() - bestNll) > maxdeltaNLLforprof_;
+    }
+    res.ok = !res.aborted && minimObj.minimize(verbosity_-1);
+    res.nll = nll_.getVal();
+    readValues(param, res.vals);
+    return res;
+}
+
+void RandStartPt::minimizeStartsInParallel(unsigned int nstarts, const std::function<void(unsigned int)> &setStart, RooArgSet &param, double nll_init, CascadeMinimizer &minimObj){
+    startResults_.assign(nstarts, StartResult());
+    if (numworkers_ <= 1 || nstarts < 2 || fastscan_ || utils::countFloating(param) == 0) return;
+    unsigned int nvals = param.getSize();
+    // The start points are taken in rounds of numworkers_, and the reference for the early abort is the best
+    // result of the previous rounds: what is done does not depend on which worker finishes first.
+    bool hasBest = false;
+    double bestNll = 0;
+    fflush(stdout); fflush(stderr);
+    for (unsigned int first = 0; first < nstarts; first += numworkers_) {
+        unsigned int last = std::min<unsigned int>(nstarts, first + numworkers_);
+        std::vector<pid_t> pids;
+        std::vector<int> fds;
+        for (unsigned int idx = first; idx < last; ++idx) {
+            int fd[2];
+            if (pipe(fd) != 0) throw std::runtime_error("RandStartPt: failed to create a pipe for a start point worker");
+            pid_t pid = fork();
+            if (pid < 0) throw std::runtime_error("RandStartPt: failed to fork a start point worker");
+            if (pid == 0) {
+                // worker: never return into the caller, which would write to the output file
+                close(fd[0]);
+                bool ok = false;
+                try {
+                    StartResult res = minimizeOneStart(idx, setStart, param, nll_init, hasBest, bestNll, minimObj);
+                    int flags[3] = { res.done, res.ok, res.aborted };
+                    res.vals.resize(nvals);
+                    ok = writeAll(fd[1], flags, sizeof(flags)) && writeAll(fd[1], &res.nll, sizeof(double)) &&
+                         writeAll(fd[1], res.vals.data(), nvals * sizeof(double));
+                } catch (std::exception &ex) {
+                    std::cerr << "RandStartPt: worker for start point " << idx << " failed: " << ex.what() << std::endl;
+                }
+                close(fd[1]);
+                _exit(ok ? 0 : 1);
+            }
+            close(fd[1]);
+            pids.push_back(pid);
+            fds.push_back(fd[0]);
+        }
+        for (unsigned int w = 0; w < pids.size(); ++w) {
+            StartResult &res = startResults_[first + w];
+            int flags[3] = { 0, 0, 0 };
+            res.vals.resize(nvals);
+            bool ok = readAll(fds[w], flags, sizeof(flags)) && readAll(fds[w], &res.nll, sizeof(double)) &&
+                      readAll(fds[w], res.vals.data(), nvals * sizeof(double));
+            close(fds[w]);
+            int status = 0, ret;
+            do { ret = waitpid(pids[w], &status, 0); } while (ret == -1 && errno == EINTR);
+            if (!ok || ret == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                // not fatal: this start point is then minimised in this process
+                if (verbosity_ > 0) CombineLogger::instance().log("RandStartPt.cc",__LINE__,std::string(Form("Worker for start point %u did not complete, minimising it here",first + w)),__func__);
+                res = StartResult();
+                continue;
+            }
+            res.done = flags[0]; res.ok = flags[1]; res.aborted = flags[2];
+            if (res.aborted && verbosity_ > 1) std::cout << "\tStart pt idx " << first + w << " aborted after the pre-fit" << std::endl;
+        }
+        for (unsigned int idx = first; idx < last; ++idx) {
+            const StartResult &res = startResults_[idx];
+            if (res.done && res.ok && (!hasBest || res.nll < bestNll)) { hasBest = true; bestNll = res.nll; }
+        }
+    }
+}
+
+bool RandStartPt::minimizeStart(unsigned int startptIdx, RooArgSet &param, CascadeMinimizer &minimObj){
+    if (startptIdx < startResults_.size() && startResults_[startptIdx].done) {
+        const StartResult &res = startResults_[startptIdx];
+        // an aborted start is committed at its pre-fit values, as the serial loop commits the starts that are too far to minimise
+        if (res.ok || res.aborted) writeValues(param, res.vals);
+        return res.ok || res.aborted;
+    }
+    return minimObj.minimize(verbosity_-1);
+}
+
 void RandStartPt::doRandomStartPt1DGridScan(double &xval, unsigned int poiSize, std::vector<float> &poival, std::vector<RooRealVar* > &poivars, std::unique_ptr <RooArgSet> &param, RooArgSet &snap, float &deltaNLL, double &nll_init, CascadeMinimizer &minimObj){
     float current_best_nll = 0;
     //the nested vector to hold random starting points to try
     std::vector<std::vector<float>> nested_vector_of_wc_vals =  vectorOfPointsToTry ();
-    for (unsigned int start_pt_idx = 0; start_pt_idx<nested_vector_of_wc_vals.size(); start_pt_idx++){
+    auto setStart = [&](unsigned int start_pt_idx) {
         *param = snap;
         poival[0] = xval;
         poivars[0]->setVal(xval);
 
         //Loop over prof POIs and set their values
         setProfPOIvalues(start_pt_idx, nested_vector_of_wc_vals);
+    };
+    minimizeStartsInParallel(nested_vector_of_wc_vals.size(), setStart, *param, nll_init, minimObj);
+    for (unsigned int start_pt_idx = 0; start_pt_idx<nested_vector_of_wc_vals.size(); start_pt_idx++){
+        setStart(start_pt_idx);
 
         //now we minimize
         nll_.clearEvalErrorLog();
@@ -171,7 +316,7 @@ void RandStartPt::doRandomStartPt1DGridScan(double &xval, unsigned int poiSize,
          }
          bool ok = fastscan_ || (hasmaxdeltaNLLforprof_ && (nll_.getVal() - nll_init) > maxdeltaNLLforprof_) || utils::countFloating(*param)==0 ?
                             true :
-                            minimObj.minimize(verbosity_-1);
+                            minimizeStart(start_pt_idx, *param, minimObj);
          if (ok) {
              deltaNLL = nll_.getVal() - nll_init;
              double qN = 2*(deltaNLL);
@@ -187,7 +332,7 @@ void RandStartPt::doRandomStartPt2DGridScan(double &xval, double &yval, unsigned
     float current_best_nll = 0;
     //the nested vector to hold random starting points to try
     std::vector<std::vector<float>> nested_vector_of_wc_vals =  vectorOfPointsToTry ();
-    for (unsigned int start_pt_idx = 0; start_pt_idx<nested_vector_of_wc_vals.size(); start_pt_idx++){
+    auto setStart = [&](unsigned int start_pt_idx) {
         *param = snap;
         poival[0] = xval;
         poival[1] = yval;
@@ -196,6 +341,10 @@ void RandStartPt::doRandomStartPt2DGridScan(double &xval, double &yval, unsigned
 
         //Loop over prof POIs and set their values
         setProfPOIvalues(start_pt_idx, nested_vector_of_wc_vals);
+    };
+    minimizeStartsInParallel(nested_vector_of_wc_vals.size(), setStart, *param, nll_init, minimObj);
+    for (unsigned int start_pt_idx = 0; start_pt_idx<nested_vector_of_wc_vals.size(); start_pt_idx++){
+        setStart(start_pt_idx);
        
         //now we minimize
         nll_.clearEvalErrorLog();
@@ -221,7 +370,7 @@ void RandStartPt::doRandomStartPt2DGridScan(double &xval, double &yval, unsigned
         bool ok = fastscan_ || (hasmaxdeltaNLLforprof_ && (nll_.getVal() - nll_init) > maxdeltaNLLforprof_) ||
                           utils::countFloating(*param) == 0
                       ? true
-                      : minimObj.minimize(verbosity_ - 1);
+                      : minimizeStart(start_pt_idx, *param, minimObj);
         if (ok) {
             deltaNLL = nll_.getVal() - nll_init;
             double qN = 2*(deltaNLL);
@@ -258,6 +407,8 @@ void RandStartPt::doRandomStartPt2DGridScan(double &xval, double &yval, unsigned
                     commitBestNLLVal(start_pt_idx, current_best_nll, prob);
                 }
             }
+            // the next start points are at the centre again
+            xval = x0; yval = y0;
         }
     }
 }
@@ -0,0 +1,234 @@
+#include "../interface/ResultStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char kHeaderMagic[8] = { 'C', 'M', 'B', 'R', 'S', 'L', 'T', '1' };
+    const char kFooterMagic[8] = { 'C', 'M', 'B', 'R', 'S', 'L', 'T', 'E' };
+    // magic, chunk size, rows, columns and schema size
+    const size_t kHeaderSize = 8 + 8 + 8 + 4 + 4;
+
+    inline size_t padded(size_t size) { return (size + 7) & ~size_t(7); }
+
+    template<typename T> void put(std::vector<char> &buffer, size_t &pos, const T &value) {
+        memcpy(&buffer[pos], &value, sizeof(T)); pos += sizeof(T);
+    }
+    template<typename T> T get(const char *ptr) {
+        T ret; memcpy(&ret, ptr, sizeof(T)); return ret;
+    }
+
+    // size of the chunk at the start of the avail bytes at chunk, or 0 if it is incomplete or inconsistent:
+    // all its sizes and offsets must be within the chunk, and its footer must match the header
+    uint64_t checkChunk(const char *chunk, size_t avail) {
+        if (avail < kHeaderSize || memcmp(chunk, kHeaderMagic, sizeof(kHeaderMagic)) != 0) return 0;
+        uint64_t chunkSize = get<uint64_t>(chunk + 8), rows = get<uint64_t>(chunk + 16);
+        uint32_t ncol = get<uint32_t>(chunk + 24), schemaSize = get<uint32_t>(chunk + 28);
+        uint64_t dataStart = kHeaderSize + uint64_t(schemaSize), footerSize = 8*uint64_t(ncol) + 8 + sizeof(kFooterMagic);
+        if (chunkSize < dataStart + footerSize || chunkSize > avail || chunkSize % 8 != 0) return 0;
+        if (memcmp(chunk + chunkSize - sizeof(kFooterMagic), kFooterMagic, sizeof(kFooterMagic)) != 0) return 0;
+        if (get<uint64_t>(chunk + chunkSize - sizeof(kFooterMagic) - 8) != chunkSize) return 0;
+        uint64_t dataEnd = chunkSize - footerSize;
+        const char *schema = chunk + kHeaderSize, *schemaEnd = schema + schemaSize, *footer = chunk + dataEnd;
+        for (uint32_t i = 0; i < ncol; ++i) {
+            if (schemaEnd - schema < 4) return 0;
+            unsigned int size = ResultStoreWriter::typeSize(schema[0]);
+            uint16_t len = get<uint16_t>(schema + 2);
+            if (size == 0 || uint64_t(schemaEnd - schema - 4) < len) return 0;
+            schema += 4 + len;
+            uint64_t offset = get<uint64_t>(footer + 8*i);
+            if (offset < dataStart || offset > dataEnd || rows > (dataEnd - offset) / size) return 0;
+        }
+        return chunkSize;
+    }
+}
+
+ResultStoreWriter::ResultStoreWriter(const std::string &file, unsigned int chunkRows) :
+    file_(file), out_(fopen(file.c_str(), "wb")), chunkRows_(chunkRows ? chunkRows : 1), rows_(0), good_(out_ != 0)
+{
+    if (out_ == 0) throw std::runtime_error("ResultStoreWriter: can't open "+file+" for writing");
+}
+
+ResultStoreWriter::~ResultStoreWriter()
+{
+    close();
+}
+
+unsigned int ResultStoreWriter::typeSize(char type) {
+    switch (type) {
+        case 'D': case 'L': case 'l': return 8;
+        case 'F': case 'I': case 'i': return 4;
+        case 'O': return 1;
+        default:  return 0;
+    }
+}
+
+void ResultStoreWriter::addColumn(const std::string &name, char type, const void *address) {
+    if (typeSize(type) == 0) throw std::invalid_argument(std::string("ResultStoreWriter: unsupported type '")+type+"' for column "+name);
+    if (name.size() > 0xFFFF) throw std::invalid_argument("ResultStoreWriter: column name too long: "+name);
+    if (rows_) flush();
+    columns_.push_back(Column());
+    Column &col = columns_.back();
+    col.name = name; col.type = type; col.address = address;
+    col.data.reserve(size_t(chunkRows_) * typeSize(type));
+}
+
+void ResultStoreWriter::clearColumns() {
+    if (rows_) flush();
+    columns_.clear();
+}
+
+void ResultStoreWriter::fill() {
+    if (columns_.empty() || out_ == 0) return;
+    for (Column &col : columns_) {
+        const char *src = static_cast<const char *>(col.address);
+        col.data.insert(col.data.end(), src, src + typeSize(col.type));
+    }
+    if (++rows_ >= chunkRows_) flush();
+}
+
+void ResultStoreWriter::flush() {
+    if (rows_ == 0 || out_ == 0) return;
+    size_t ncol = columns_.size(), schemaSize = 0;
+    for (const Column &col : columns_) schemaSize += 4 + col.name.size();
+    schemaSize = padded(schemaSize);
+    size_t dataSize = 0;
+    for (const Column &col : columns_) dataSize += padded(col.data.size());
+    uint64_t chunkSize = kHeaderSize + schemaSize + dataSize + 8*ncol + 8 + sizeof(kFooterMagic);
+
+    // the whole chunk is built in memory and written at once, so that it is either complete or at the end of the file
+    std::vector<char> buffer(chunkSize, 0);
+    size_t pos = 0;
+    memcpy(&buffer[pos], kHeaderMagic, sizeof(kHeaderMagic)); pos += sizeof(kHeaderMagic);
+    put<uint64_t>(buffer, pos, chunkSize);
+    put<uint64_t>(buffer, pos, rows_);
+    put<uint32_t>(buffer, pos, ncol);
+    put<uint32_t>(buffer, pos, schemaSize);
+    size_t schemaStart = pos;
+    for (const Column &col : columns_) {
+        buffer[pos++] = col.type;
+        buffer[pos++] = 0;
+        put<uint16_t>(buffer, pos, col.name.size());
+        memcpy(&buffer[pos], col.name.data(), col.name.size()); pos += col.name.size();
+    }
+    pos = schemaStart + schemaSize;
+    std::vector<uint64_t> offsets;
+    for (const Column &col : columns_) {
+        offsets.push_back(pos);
+        memcpy(&buffer[pos], col.data.data(), col.data.size());
+        pos += padded(col.data.size());
+    }
+    for (uint64_t offset : offsets) put<uint64_t>(buffer, pos, offset);
+    put<uint64_t>(buffer, pos, chunkSize);
+    memcpy(&buffer[pos], kFooterMagic, sizeof(kFooterMagic));
+
+    if (fwrite(&buffer[0], 1, chunkSize, out_) != chunkSize || fflush(out_) != 0) good_ = false;
+    for (Column &col : columns_) col.data.clear();
+    rows_ = 0;
+}
+
+bool ResultStoreWriter::close() {
+    if (out_ == 0) return good_;
+    flush();
+    if (fclose(out_) != 0) good_ = false;
+    out_ = 0;
+    return good_;
+}
+
+double ResultStoreReader::Column::operator[](uint64_t i) const {
+    const char *ptr = static_cast<const char *>(data);
+    switch (type) {
+        case 'D': return get<double>(ptr + 8*i);
+        case 'F': return get<float>(ptr + 4*i);
+        case 'I': return get<int32_t>(ptr + 4*i);
+        case 'i': return get<uint32_t>(ptr + 4*i);
+        case 'L': return get<int64_t>(ptr + 8*i);
+        case 'l': return get<uint64_t>(ptr + 8*i);
+        case 'O': return ptr[i] != 0;
+        default:  return 0;
+    }
+}
+
+ResultStoreReader::ResultStoreReader(const std::string &file) :
+    base_(0), size_(0), truncated_(false)
+{
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("ResultStoreReader: can't open "+file);
+    struct stat st;
+    if (fstat(fd, &st) != 0) { ::close(fd); throw std::runtime_error("ResultStoreReader: can't stat "+file); }
+    size_ = st.st_size;
+    if (size_ > 0) {
+        void *map = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) { ::close(fd); throw std::runtime_error("ResultStoreReader: can't map "+file); }
+        base_ = static_cast<const char *>(map);
+    }
+    ::close(fd);
+
+    if (size_ > 0 && memcmp(base_, kHeaderMagic, std::min(size_, sizeof(kHeaderMagic))) != 0) {
+        munmap(const_cast<char *>(base_), size_);
+        throw std::runtime_error("ResultStoreReader: "+file+" is not a result store, or is corrupted");
+    }
+    size_t pos = 0;
+    while (pos < size_) {
+        const char *chunk = base_ + pos;
+        uint64_t chunkSize = checkChunk(chunk, size_ - pos);
+        if (chunkSize == 0) {
+            // a partially written chunk, possibly followed by the chunks of another file: resume at the next header
+            truncated_ = true;
+            const char *next = std::search(chunk + 1, base_ + size_, kHeaderMagic, kHeaderMagic + sizeof(kHeaderMagic));
+            pos = next - base_;
+            continue;
+        }
+        Chunk c;
+        c.rows = get<uint64_t>(chunk + 16);
+        uint32_t ncol = get<uint32_t>(chunk + 24);
+        const char *schema = chunk + kHeaderSize, *footer = chunk + chunkSize - sizeof(kFooterMagic) - 8 - 8*ncol;
+        for (uint32_t i = 0; i < ncol; ++i) {
+            c.types.push_back(schema[0]);
+            uint16_t len = get<uint16_t>(schema + 2);
+            c.names.push_back(std::string(schema + 4, len));
+            schema += 4 + len;
+            c.data.push_back(chunk + get<uint64_t>(footer + 8*i));
+        }
+        chunks_.push_back(c);
+        pos += chunkSize;
+    }
+}
+
+ResultStoreReader::~ResultStoreReader()
+{
+    if (base_) munmap(const_cast<char *>(base_), size_);
+    base_ = 0;
+}
+
+uint64_t ResultStoreReader::entries() const {
+    uint64_t ret = 0;
+    for (const Chunk &c : chunks_) ret += c.rows;
+    return ret;
+}
+
+std::vector<std::string> ResultStoreReader::columnNames(unsigned int chunk) const {
+    return chunks_[chunk].names;
+}
+
+ResultStoreReader::Column ResultStoreReader::column(unsigned int chunk, const std::string &name) const {
+    const Chunk &c = chunks_[chunk];
+    for (unsigned int i = 0, n = c.names.size(); i < n; ++i) {
+        if (c.names[i] == name) return Column{c.types[i], c.rows, c.data[i]};
+    }
+    return Column{0, 0, 0};
+}
+
+std::vector<double> ResultStoreReader::values(const std::string &name) const {
+    std::vector<double> ret;
+    for (unsigned int i = 0, n = chunks_.size(); i < n; ++i) {
+        Column col = column(i, name);
+        for (uint64_t j = 0; j < col.size; ++j) ret.push_back(col[j]);
+    }
+    return ret;
+}
@@ -13,6 +13,9 @@
 #include "RooArgList.h"
 #include "RooRealProxy.h"
 #include "RooListProxy.h"
+#include "RooRealIntegral.h"
+#include "../interface/ProfilingTools.h"
+#include <algorithm>
 
 using namespace std;
 using namespace RooFit;
@@ -33,6 +36,26 @@ namespace {
 }
 #endif
 
+namespace {
+  // nodes and weights of the n-point Gauss-Legendre rule on [-1,1]
+  void gaussLegendre(int n, std::vector<double> &nodes, std::vector<double> &weights) {
+    nodes.resize(n); weights.resize(n);
+    for (int i = 0; i < (n+1)/2; ++i) {
+      double z = cos(M_PI*(i+0.75)/(n+0.5)), dp = 0;
+      for (int iter = 0; iter < 100; ++iter) {
+        double p0 = 1, p1 = 0;
+        for (int j = 0; j < n; ++j) { double p2 = p1; p1 = p0; p0 = ((2*j+1)*z*p1 - j*p2)/(j+1); }
+        dp = n*(z*p0 - p1)/(z*z - 1);
+        double dz = p0/dp;
+        z -= dz;
+        if (fabs(dz) < 1e-15) break;
+      }
+      nodes[i] = -z; nodes[n-1-i] = z;
+      weights[i] = weights[n-1-i] = 2/((1-z*z)*dp*dp);
+    }
+  }
+}
+
 ClassImp(RooParametricShapeBinPdf)
 //---------------------------------------------------------------------------
 
@@ -113,13 +136,72 @@ RooAbsReal* RooParametricShapeBinPdf::getIntegral(int index) const {
   return myintegrals.at(index) ? ((RooAbsReal*)myintegrals.at(index)) : 0;
 }
 //---------------------------------------------------------------------------
+Int_t RooParametricShapeBinPdf::findBin(Double_t xval) const
+{
+  // same bins as x>=xArray[iBin] && x<xArray[iBin+1]
+  Int_t iBin = std::upper_bound(xArray, xArray+xBins+1, xval) - xArray - 1;
+  return (iBin >= 0 && iBin < xBins) ? iBin : -1;
+}
+//---------------------------------------------------------------------------
+void RooParametricShapeBinPdf::checkRanges() const
+{
+  // needed when combining multiple workspaces, and taking variable x from only one of them!
+  for (Int_t iBin=0; iBin<xBins; iBin++) {
+    std::string rangeName  = Form("%s_%s_range_bin%d", GetName(), x.GetName(), iBin);
+    if (!x.arg().hasRange(rangeName.c_str())) {
+      RooRealVar x_rrv = dynamic_cast<const RooRealVar &>(x.arg());
+#if ROOT_VERSION_CODE < ROOT_VERSION(6,24,0)
+      RooRealVarSmart* x_smart(static_cast<RooRealVarSmart*>(&x_rrv));
+      if(x_smart->getHashTableSize()==0) x_smart->setHashTableSize(1);
+#endif
+      x_rrv.setRange(rangeName.c_str(),xArray[iBin],xArray[iBin+1]);
+    }
+  }
+}
+//---------------------------------------------------------------------------
+void RooParametricShapeBinPdf::updateCache() const
+{
+  static int nPoints = runtimedef::get("PARAMETRIC_SHAPE_BIN_GL_POINTS");
+  if (!cacheInit) {
+    RooArgSet obs(x.arg());
+    sentry.addFunc(*getPdf(), &obs);
+    sentry.setValueDirty();
+    binIntegrals.resize(xBins);
+    cacheInit = true;
+  }
+  if (sentry.good()) return;
+
+  RooRealIntegral *firstIntegral = dynamic_cast<RooRealIntegral *>(getIntegral(0));
+  if (firstIntegral && firstIntegral->numIntRealVars().getSize() == 0) {
+    // the bin integrals are analytic
+    checkRanges();
+    for (Int_t iBin=0; iBin<xBins; iBin++) binIntegrals[iBin] = getIntegral(iBin)->getVal();
+  } else {
+    // evaluate the pdf at the nodes of all the bins in one pass, then put x back where it was
+    static std::vector<double> nodes, weights;
+    if (nodes.empty()) gaussLegendre(nPoints > 0 ? nPoints : 16, nodes, weights);
+    RooRealVar &xvar = const_cast<RooRealVar &>(dynamic_cast<const RooRealVar &>(x.arg()));
+    RooAbsPdf *pdf = getPdf();
+    Double_t x0 = xvar.getVal();
+    for (Int_t iBin=0; iBin<xBins; iBin++) {
+      Double_t center = 0.5*(xArray[iBin+1]+xArray[iBin]), halfWidth = 0.5*(xArray[iBin+1]-xArray[iBin]);
+      Double_t sum = 0;
+      for (unsigned int i = 0, n = nodes.size(); i < n; ++i) {
+        xvar.setVal(center + halfWidth*nodes[i]);
+        sum += weights[i]*pdf->getVal();
+      }
+      binIntegrals[iBin] = sum*halfWidth;
+    }
+    xvar.setVal(x0);
+  }
+  sentry.reset();
+}
+//---------------------------------------------------------------------------
 Double_t RooParametricShapeBinPdf::evaluate() const
 {
+  static bool useCache = runtimedef::get("PARAMETRIC_SHAPE_BIN_CACHE");
   Double_t integral = 0.0;
-  Int_t iBin;
-  for(iBin=0; iBin<xBins; iBin++) {  
-    if (x>=xArray[iBin] && x < xArray[iBin+1] ) break;
-  }
+  Int_t iBin = findBin(x);
   
   if(iBin < 0 || iBin >= xBins) {
     //cout << "in bin " << iBin << " which is outside of range" << endl;
@@ -129,6 +211,12 @@ Double_t RooParametricShapeBinPdf::evaluate() const
   Double_t xLow = xArray[iBin];
   Double_t xHigh = xArray[iBin+1];
 
+  if (useCache) {
+    updateCache();
+    integral = binIntegrals[iBin] / (xHigh-xLow);
+    return integral > 0.0 ? integral : 0;
+  }
+
   // check again if x variable has the right range already defined 
   // needed when combining multiple workspaces, and taking variable x from only one of them!
   std::string rangeName  = Form("%s_%s_range_bin%d", GetName(), x.GetName(), iBin);
@@ -169,6 +257,13 @@ Double_t RooParametricShapeBinPdf::analyticalIntegral(Int_t code, const char* ra
   RooListProxy obs;
   obs.add(x.arg());
   
+  static bool useCache = runtimedef::get("PARAMETRIC_SHAPE_BIN_CACHE");
+  if (code==1 && useCache && xRangeMin==xMin && xRangeMax==xMax) {
+    // the bins cover exactly the range of x
+    updateCache();
+    for (Int_t iBin=0; iBin<xBins; iBin++) integral += binIntegrals[iBin];
+    return integral;
+  }
   if (code==1 && xRangeMin<=xMin && xRangeMax>=xMax){
     integral = getIntegral(xBins)->getVal();
     return integral;
@@ -12,6 +12,8 @@
 #include "RooListProxy.h"
 #include "TArrayI.h"
 
+#include <algorithm>
+
 using namespace std;
 
 ClassImp(RooTaylorExpansion);
@@ -41,29 +43,92 @@ RooTaylorExpansion::RooTaylorExpansion(const RooTaylorExpansion& other,
       _terms(other._terms) {}
 
 //_____________________________________________________________________________
-Double_t RooTaylorExpansion::evaluate() const {
-  double fullsum = 0.;
+void RooTaylorExpansion::compile() const {
+  // the terms sorted by their (sorted) indices, so that equal index lists are adjacent
+  // and the lists with a common prefix are next to each other
+  std::vector<std::pair<std::vector<int>, double>> sorted(_trackers.size());
+  for (unsigned i = 0; i < _trackers.size(); ++i) {
+    sorted[i].first = _trackers[i];
+    std::sort(sorted[i].first.begin(), sorted[i].first.end());
+    sorted[i].second = _terms[i];
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const std::pair<std::vector<int>, double>& a,
+                      const std::pair<std::vector<int>, double>& b) {
+                     return a.first < b.first;
+                   });
 
-  unsigned nx = _x.getSize();
-  std::vector<double> dx(nx);
+  _nodeIndex.assign(1, -1);
+  _nodeParent.assign(1, 0);
+  _nodeCoef.assign(1, 0.);
+  // path[d] is the node at depth d along the last index list
+  std::vector<unsigned> path(1, 0);
+  std::vector<int> last;
+  for (auto const& term : sorted) {
+    std::vector<int> const& idx = term.first;
+    unsigned common = 0;
+    while (common < idx.size() && common < last.size() && idx[common] == last[common]) ++common;
+    path.resize(common + 1);
+    for (unsigned d = common; d < idx.size(); ++d) {
+      _nodeIndex.push_back(idx[d]);
+      _nodeParent.push_back(path.back());
+      _nodeCoef.push_back(0.);
+      path.push_back(_nodeIndex.size() - 1);
+    }
+    _nodeCoef[path.back()] += term.second;
+    last = idx;
+  }
+  _nodeValue.resize(_nodeIndex.size());
+  _nodeAdjoint.resize(_nodeIndex.size());
+  _dx.resize(_x.getSize());
+  _grad.resize(_x.getSize());
+  // filled here and not in the constructors, so that a copy tracks its own servers once they are redirected
+  _sentry.addVars(_x);
+  _sentry.addVars(_x0);
+  _sentry.setValueDirty();
+  _init = true;
+}
 
-  for (unsigned i = 0; i < nx; ++i) {
-    dx[i] = ((RooAbsReal*)(_x.at(i)))->getVal() -
-            ((RooAbsReal*)(_x0.at(i)))->getVal();
+//_____________________________________________________________________________
+void RooTaylorExpansion::sync() const {
+  for (unsigned i = 0, nx = _dx.size(); i < nx; ++i) {
+    _dx[i] = ((RooAbsReal*)(_x.at(i)))->getVal() -
+             ((RooAbsReal*)(_x0.at(i)))->getVal();
+  }
+  // children come after their parents, so each node is complete when added to its parent
+  std::copy(_nodeCoef.begin(), _nodeCoef.end(), _nodeValue.begin());
+  for (unsigned n = _nodeIndex.size() - 1; n > 0; --n) {
+    _nodeValue[_nodeParent[n]] += _dx[_nodeIndex[n]] * _nodeValue[n];
   }
+  _gradGood = false;
+  _sentry.reset();
+}
 
-  for (unsigned i = 0; i < _trackers.size(); ++i) {
-    unsigned n = _trackers[i].size();
-    double term = _terms[i];
-    for (unsigned t = 0; t < n; ++t) {
-      term *= dx[_trackers[i][t]];
+//_____________________________________________________________________________
+Double_t RooTaylorExpansion::evaluate() const {
+  if (!_init) compile();
+  if (!_sentry.good()) sync();
+  return _nodeValue[0];
+}
+
+//_____________________________________________________________________________
+void RooTaylorExpansion::gradient(std::vector<double>& grad) const {
+  if (!_init) compile();
+  if (!_sentry.good()) sync();
+  if (!_gradGood) {
+    // reverse mode: the adjoint of a node is the product of the dx along its path from the root
+    std::fill(_grad.begin(), _grad.end(), 0.);
+    _nodeAdjoint[0] = 1.;
+    for (unsigned n = 1, nn = _nodeIndex.size(); n < nn; ++n) {
+      double parent = _nodeAdjoint[_nodeParent[n]];
+      _nodeAdjoint[n] = parent * _dx[_nodeIndex[n]];
+      _grad[_nodeIndex[n]] += parent * _nodeValue[n];
     }
-    fullsum += term;
+    _gradGood = true;
   }
-  return fullsum;
+  grad = _grad;
 }
 
-
 void RooTaylorExpansion::printMultiline(std::ostream& os, Int_t contents,
                                  Bool_t verbose, TString indent) const {
   RooAbsReal::printMultiline(os, contents, verbose, indent);
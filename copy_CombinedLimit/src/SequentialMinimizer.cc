@@ -5,11 +5,13 @@
 #include <memory>
 #include <algorithm>
 #include <limits>
+#include <map>
 #include "TString.h"
 #include "RooRealVar.h"
 #include "RooAbsReal.h"
 #include "RooLinkedListIter.h"
 #include <Math/MinimizerOptions.h>
+#include <Math/IOptions.h>
 #include <Math/Factory.h>
 #include "../interface/ProfilingTools.h"
 
@@ -297,6 +299,28 @@ void cmsmath::OneDimMinimizer::moveTo(double x) {
     }
 }
 
+namespace {
+    std::map<int, cmsmath::SeparableFunction *> &separableFunctions() {
+        static std::map<int, cmsmath::SeparableFunction *> functions;
+        return functions;
+    }
+}
+
+cmsmath::SeparableFunction::SeparableFunction() {
+    static int lastId = 0;
+    id_ = ++lastId;
+    separableFunctions()[id_] = this;
+}
+
+cmsmath::SeparableFunction::~SeparableFunction() {
+    separableFunctions().erase(id_);
+}
+
+cmsmath::SeparableFunction *cmsmath::SeparableFunction::find(int id) {
+    auto match = separableFunctions().find(id);
+    return match == separableFunctions().end() ? nullptr : match->second;
+}
+
 void cmsmath::SequentialMinimizer::SetFunction(const ROOT::Math::IMultiGenFunction & func) {
     DEBUG_SM_printf("SequentialMinimizer::SetFunction: nDim = %u\n", func.NDim());
     func_.reset(new MinimizerContext(&func));
@@ -304,6 +328,7 @@ void cmsmath::SequentialMinimizer::SetFunction(const ROOT::Math::IMultiGenFuncti
     // create dummy workers
     workers_.clear();
     workers_.resize(nDim_);
+    workerTerms_.clear();
     // reset states
     Clear();
 }
@@ -346,6 +371,10 @@ bool cmsmath::SequentialMinimizer::SetFixedVariable(unsigned int ivar, const std
 }
 
 bool cmsmath::SequentialMinimizer::Minimize() {
+    // the description of the function as a sum of terms can also come with the options (see SeparableFunction::id)
+    int id;
+    const ROOT::Math::IOptions *extra = Options().ExtraOptions();
+    if (extra && extra->GetIntValue("SeparableFunction", id)) separable_ = SeparableFunction::find(id);
     return minimize();
 }
 
@@ -354,8 +383,16 @@ bool cmsmath::SequentialMinimizer::minimize(int smallsteps)
     for (unsigned int i = 0; i < nDim_; ++i) {
         Worker &w = workers_[i];
         if (!w.isInit() || w.state == Unknown) throw std::runtime_error(Form("SequentialMinimizer::worker[%u/%u] not initialized!\n", i, nDim_));
+    }
+    setupTerms();
+    // make sure the function is at the current point before evaluating it partially
+    if (!workerTerms_.empty()) func_->eval();
+    for (unsigned int i = 0; i < nDim_; ++i) {
+        Worker &w = workers_[i];
         if (w.state != Fixed) {
+            if (!workerTerms_.empty()) { func_->terms = &workerTerms_[i]; func_->termsIdx = i; func_->termsPar = workerPar_[i]; }
             w.minimize(1); 
+            if (!workerTerms_.empty()) { separable_->set(workerPar_[i], func_->x[i]); func_->terms = nullptr; }
             w.state = Ready; 
         }
     }
@@ -363,6 +400,45 @@ bool cmsmath::SequentialMinimizer::minimize(int smallsteps)
     return improve(smallsteps);
 }
 
+void cmsmath::SequentialMinimizer::setupTerms()
+{
+    workerTerms_.clear();
+    workerPar_.clear();
+    if (separable_ == nullptr) return;
+
+    std::vector<std::string> names;
+    std::vector<unsigned int> par(nDim_, 0);
+    for (unsigned int i = 0; i < nDim_; ++i) {
+        if (workers_[i].state == Fixed) continue;
+        par[i] = names.size();
+        names.push_back(workers_[i].name());
+    }
+    std::vector<std::vector<unsigned int> > terms;
+    if (!separable_->terms(names, terms) || terms.size() != names.size()) {
+        DEBUG_SM_printf("SequentialMinimizer: the structure of the function is not known, will evaluate it fully\n");
+        return;
+    }
+    workerTerms_.resize(nDim_);
+    workerPar_ = par;
+    func_->separable = separable_;
+    for (unsigned int i = 0; i < nDim_; ++i) {
+        if (workers_[i].state != Fixed) workerTerms_[i] = terms[par[i]];
+    }
+    DEBUG_SM_printf("SequentialMinimizer: %u parameters, evaluating only the terms that depend on each of them\n", unsigned(names.size()));
+}
+
+cmsmath::OneDimMinimizer::ImproveRet cmsmath::SequentialMinimizer::improveWorker(Worker &w, int steps, double ytol, bool force)
+{
+    if (workerTerms_.empty()) return w.improve(steps, ytol, 0, force);
+    unsigned int i = &w - &workers_[0];
+    func_->terms = &workerTerms_[i]; func_->termsIdx = i; func_->termsPar = workerPar_[i];
+    OneDimMinimizer::ImproveRet ret = w.improve(steps, ytol, 0, force);
+    // leave the parameter at the chosen point, so that the terms of the next workers are evaluated there
+    separable_->set(workerPar_[i], func_->x[i]);
+    func_->terms = nullptr;
+    return ret;
+}
+
 bool cmsmath::SequentialMinimizer::improve(int smallsteps)
 {
     static int nFailWakeUpAttempts = runtimedef::get("SeqMinimizer_nFailWakeUpAttempts");
@@ -387,10 +463,12 @@ bool cmsmath::SequentialMinimizer::improve(int smallsteps)
         DEBUG_SM_printf("Start of loop. Strategy %d, State is %s\n",Strategy(),(state_ == Done ? "DONE" : "ACTIVE"));
         State newstate = Done;
         int oldActiveWorkers = 0, newActiveWorkers = 0;
+        // bring all the parameters of the function to the current point before evaluating it partially
+        if (!workerTerms_.empty()) func_->eval();
         for(Worker &w : workers_) {
             OneDimMinimizer::ImproveRet iret = OneDimMinimizer::Unchanged;
             if (w.state == Done || w.state == Fixed) continue;
-            iret = w.improve(smallsteps,ytol); 
+            iret = improveWorker(w,smallsteps,ytol); 
             oldActiveWorkers++; 
             if (iret == OneDimMinimizer::Unchanged) {
                 DEBUGV_SM_printf("\tMinimized %s:  Unchanged. NLL = %.8f\n", w.cname(), func_->eval());
@@ -421,7 +499,7 @@ bool cmsmath::SequentialMinimizer::improve(int smallsteps)
             while( it != doneWorkers.end()) {
                 Worker &w = **it;
                 if (nFailWakeUpAttempts && w.nUnaffected >= nFailWakeUpAttempts) { ++it; continue; }
-                OneDimMinimizer::ImproveRet iret = w.improve(smallsteps,ytol,0,/*force=*/true);
+                OneDimMinimizer::ImproveRet iret = improveWorker(w,smallsteps,ytol,/*force=*/true);
                 oldActiveWorkers++;
                 if (iret == OneDimMinimizer::Unchanged) {
                     DEBUGV_SM_printf("\tMinimized %s:  Unchanged. NLL = %.8f\n", w.cname(), func_->eval());
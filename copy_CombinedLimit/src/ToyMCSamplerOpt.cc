@@ -1,6 +1,7 @@
 #include "../interface/ToyMCSamplerOpt.h"
 #include "../interface/utils.h"
 #include "../interface/CombineLogger.h"
+#include <cmath>
 #include <memory>
 #include <stdexcept>
 #include <TH1.h>
@@ -13,6 +14,8 @@
 #include <RooDataHist.h>
 #include <RooDataSet.h>
 #include <RooRandom.h>
+#include <RooRealSumPdf.h>
+#include "../interface/CMSHistSum.h"
 #include "../interface/ProfilingTools.h"
 #include "RooStats/DetailedOutputAggregator.h"
 
@@ -191,6 +194,10 @@ RooDataSet *
 toymcoptutils::SinglePdfGenInfo::generateWithHisto(RooRealVar *&weightVar, bool asimov, double weightScale, int verbose) 
 {
     if (mode_ == Counting) return generateCountingAsimov();
+    if (asimov && observables_.getSize() == 1 && runtimedef::get("TMCSO_ASIMOV_FROM_CACHE")) {
+        RooDataSet *data = generateAsimovFromCache(weightVar, weightScale, verbose);
+        if (data) return data;
+    }
     if (observables_.getSize() > 3) throw std::invalid_argument(std::string("ERROR in SinglePdfGenInfo::generateWithHisto for ") + pdf_->GetName() + ", more than 3 observable");
     RooArgList obs(observables_);
     RooRealVar *x = (RooRealVar*)obs.at(0);
@@ -260,6 +267,42 @@ toymcoptutils::SinglePdfGenInfo::generateWithHisto(RooRealVar *&weightVar, bool
 }
 
 
+RooDataSet *  
+toymcoptutils::SinglePdfGenInfo::generateAsimovFromCache(RooRealVar *&weightVar, double weightScale, int verbose) 
+{
+    // the channel pdf made by text2workspace with --use-histsum: a RooRealSumPdf of one CMSHistSum with coefficient 1,
+    // for which the expected events in each bin are just the cached bin content times the bin width
+    RooRealSumPdf *sumpdf = dynamic_cast<RooRealSumPdf *>(pdf_);
+    if (sumpdf == 0 || sumpdf->funcList().getSize() != 1 || sumpdf->coefList().getSize() != 1) return 0;
+    const CMSHistSum *hsum = dynamic_cast<const CMSHistSum *>(sumpdf->funcList().at(0));
+    const RooAbsReal *coef = dynamic_cast<const RooAbsReal *>(sumpdf->coefList().at(0));
+    if (hsum == 0 || coef == 0 || coef->getVal() != 1.0) return 0;
+    RooRealVar *x = dynamic_cast<RooRealVar *>(observables_.first());
+    if (x == 0 || &hsum->getXVar() != x) return 0;
+    hsum->analyticalIntegral(1); // brings the cache up to date
+    const FastHisto &cache = hsum->cache();
+    const RooAbsBinning &binning = x->getBinning();
+    if (int(cache.size()) != binning.numBins()) return 0;
+    for (unsigned int i = 0, n = cache.size(); i < n; ++i) {
+        // negative bins are left to the generic path, where the pdf deals with them
+        if (cache.GetBinContent(i) < 0) return 0;
+        if (std::abs(cache.GetEdge(i) - binning.binLow(i)) > 1e-9 * std::max(1.0, std::abs(binning.binLow(i)))) return 0;
+    }
+
+    if (verbose > 0) CombineLogger::instance().log("ToyMCSamplerOpt.cc",__LINE__,std::string(Form("Generating asimov from the cache of %s: in %d x-bins",hsum->GetName(),int(cache.size()))),__func__);
+    if (weightVar == 0) weightVar = new RooRealVar("_weight_","",1.0);
+    RooArgSet obsPlusW(observables_); obsPlusW.add(*weightVar);
+    RooDataSet *data = new RooDataSet(TString::Format("%sData", pdf_->GetName()), "", obsPlusW, RooFit::WeightVar(weightVar->GetName()));
+    RooAbsArg::setDirtyInhibit(true); // don't propagate dirty flags while filling the dataset
+    for (unsigned int i = 0, n = cache.size(); i < n; ++i) {
+        x->setVal(binning.binCenter(i));
+        data->add(observables_, weightScale * cache.GetBinContent(i) * cache.GetWidth(i));
+    }
+    RooAbsArg::setDirtyInhibit(false); // restore proper propagation of dirty flags
+    return data;
+}
+
+
 RooDataSet *  
 toymcoptutils::SinglePdfGenInfo::generateCountingAsimov() 
 {
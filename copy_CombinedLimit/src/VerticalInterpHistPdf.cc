@@ -10,9 +10,10 @@
 #include "RooMsgService.h"
 #include "RooAbsData.h"
 
+#include "../interface/ProfilingTools.h"
+
 //#define TRACE_CALLS
 #ifdef TRACE_CALLS
-#include "../interface/ProfilingTools.h"
 #define TRACEME()   PerfCounter::add( __PRETTY_FUNCTION__ );
 #else
 #define TRACEME() 
@@ -625,16 +626,19 @@ FastVerticalInterpHistPdfV::FastVerticalInterpHistPdfV(const FastVerticalInterpH
     if (hpdf._cache.size() == 0) hpdf.setupCaches();
     if (!hpdf._sentry.good() || !hpdf._init) hpdf.syncTotal();
     // find bins
-    std::vector<int> bins;
+    std::vector<double> xvals;
     RooArgSet obs(hpdf._x.arg());
     const RooRealVar &x = static_cast<const RooRealVar &>(*obs.first());
-    bool aligned = true;
     for (int i = 0, n = data.numEntries(); i < n; ++i) {
         obs = *data.get(i);
         if (data.weight() == 0 && !includeZeroWeights) continue;
-        int idx = hpdf._cache.FindBin(x.getVal());
-        if (!bins.empty() && idx != bins.back() + 1) aligned = false;
-        bins.push_back(idx);
+        xvals.push_back(x.getVal());
+    }
+    std::vector<int> bins(xvals.size());
+    if (!xvals.empty()) hpdf._cache.FindBins(xvals.size(), &xvals[0], &bins[0]);
+    bool aligned = true;
+    for (int i = 1, n = bins.size(); i < n; ++i) {
+        if (bins[i] != bins[i-1] + 1) { aligned = false; break; }
     }
     if (aligned) {
         begin_ = bins.front();
@@ -762,6 +766,7 @@ FastVerticalInterpHistPdf2Base::FastVerticalInterpHistPdf2Base(const FastVertica
 Bool_t FastVerticalInterpHistPdf2Base::importWorkspaceHook(RooWorkspace& ws) {
   _initBase = false;
   _morphParams.clear();
+  clearMorphMatrix();
   _sentry.reset();
   return kFALSE;
 }
@@ -778,6 +783,7 @@ FastVerticalInterpHistPdf2Base::initBase() const
 {
     if (_initBase) return;
 
+    clearMorphMatrix();
     for (RooAbsArg *coef : _coefList) {
         const RooAbsReal *rrv = dynamic_cast<RooAbsReal*>(coef);
         if (!rrv) {
@@ -841,6 +847,7 @@ FastVerticalInterpHistPdf2::FastVerticalInterpHistPdf2(const FastVerticalInterpH
     initBase();
     other.getVal(_x.arg());
     _morphs = other._morphs;
+    clearMorphMatrix();
     _cache = other._cache;
     _cacheNominal = other._cacheNominal;
     _cacheNominalLog = other._cacheNominalLog;
@@ -860,6 +867,7 @@ FastVerticalInterpHistPdf2D2::FastVerticalInterpHistPdf2D2(const FastVerticalInt
     normSet.add(_y.arg());
     other.getVal(normSet);
     _morphs = other._morphs;
+    clearMorphMatrix();
     _cache = other._cache;
     _cacheNominal = other._cacheNominal;
     _cacheNominalLog = other._cacheNominalLog;
@@ -896,6 +904,7 @@ void FastVerticalInterpHistPdf2::setActiveBins(unsigned int bins) {
     m.sum.SetActiveSize(bins);
     m.diff.SetActiveSize(bins);
   }
+  clearMorphMatrix();
   //printf("Setting the number of active bins to be %d/%d for %s\n", bins, _cacheNominal.fullsize(), GetName());
 }
 
@@ -1003,6 +1012,7 @@ void FastVerticalInterpHistPdf2Base::initMorph(Morph &out, const FastTemplate &n
         //printf("Differences for dimension %d: \n", dim);  hi.Dump(); lo.Dump();
     }
     FastTemplate::SumDiff(hi, lo, out.sum, out.diff);
+    clearMorphMatrix();
     //printf("Sum and diff for dimension %d: \n", dim);  out.sum.Dump(); out.diff.Dump();
 }
 
@@ -1031,12 +1041,17 @@ void FastVerticalInterpHistPdf2Base::syncTotal(FastTemplate &cache, const FastTe
     cache.CopyValues(_smoothAlgo < 0 ? cacheNominalLog : cacheNominal);
     //printf("Cache initialized to nominal template: \n");  cacheNominal.Dump();
 
-    // apply all morphs one by one
-    for (int i = 0, ndim = _coefList.getSize(); i < ndim; ++i) {
-        double x = _morphParams[i]->getVal();
-        double a = 0.5*x, b = smoothStepFunc(x);
-        cache.Meld(_morphs[i].diff, _morphs[i].sum, a, b);    
-        //printf("Merged transformation for dimension %d, x = %+5.3f, step = %.3f: \n", i, x, b);  cache.Dump();
+    static const bool matrixMorph = runtimedef::get("FAST_VERTICAL_MORPH_MATRIX");
+    if (matrixMorph && _coefList.getSize() > 1) {
+        syncTotalMatrix(cache);
+    } else {
+        // apply all morphs one by one
+        for (int i = 0, ndim = _coefList.getSize(); i < ndim; ++i) {
+            double x = _morphParams[i]->getVal();
+            double a = 0.5*x, b = smoothStepFunc(x);
+            cache.Meld(_morphs[i].diff, _morphs[i].sum, a, b);    
+            //printf("Merged transformation for dimension %d, x = %+5.3f, step = %.3f: \n", i, x, b);  cache.Dump();
+        }
     }
 
     // if necessary go back to linear scale
@@ -1051,6 +1066,89 @@ void FastVerticalInterpHistPdf2Base::syncTotal(FastTemplate &cache, const FastTe
     _sentry.reset();
 }
 
+namespace {
+    // number of bins in each block of the morph matrix: the running total for a block
+    // stays in L1 cache while the diff and sum templates of all morphs are streamed
+    const unsigned int kMorphBlockSize = 256;
+
+    typedef FastTemplate::T MT;
+    // out += w[0]*(diff + w[1]*sum) on n bins, as FastTemplate::Meld
+    inline void meldBlock(MT * __restrict__ out, unsigned int n, const MT * __restrict__ diff, const MT * __restrict__ sum, const MT *w) {
+        const MT a = w[0], b = w[1];
+        for (unsigned int i = 0; i < n; ++i) {
+            out[i] += a*(diff[i] + b*sum[i]);
+        }
+    }
+    // the same for four morphs at once, adding them in order so that the result is unchanged
+    // m[j] points to the diff template of morph j, followed by its sum template
+    inline void meldBlock4(MT * __restrict__ out, unsigned int n, const MT * __restrict__ m0, const MT * __restrict__ m1, const MT * __restrict__ m2, const MT * __restrict__ m3, const MT *w) {
+        const MT a0 = w[0], b0 = w[1], a1 = w[2], b1 = w[3], a2 = w[4], b2 = w[5], a3 = w[6], b3 = w[7];
+        for (unsigned int i = 0; i < n; ++i) {
+            MT v = out[i];
+            v += a0*(m0[i] + b0*m0[n+i]);
+            v += a1*(m1[i] + b1*m1[n+i]);
+            v += a2*(m2[i] + b2*m2[n+i]);
+            v += a3*(m3[i] + b3*m3[n+i]);
+            out[i] = v;
+        }
+    }
+}
+
+void FastVerticalInterpHistPdf2Base::packMorphMatrix(unsigned int nbins) const {
+    /* Layout: for each block of kMorphBlockSize bins, the diff and then the sum template of
+     * the first morph restricted to the bins of the block, then those of the second morph, ...
+     * so that syncTotalMatrix reads the whole matrix once and in order.
+     * The last block can be shorter than kMorphBlockSize. */
+    unsigned int ndim = _morphs.size();
+    _morphMatrix.resize(2 * std::size_t(ndim) * nbins);
+    FastTemplate::T *out = &_morphMatrix[0];
+    for (unsigned int begin = 0; begin < nbins; begin += kMorphBlockSize) {
+        unsigned int len = std::min(kMorphBlockSize, nbins - begin);
+        for (unsigned int i = 0; i < ndim; ++i) {
+            out = std::copy(_morphs[i].diff.data() + begin, _morphs[i].diff.data() + begin + len, out);
+            out = std::copy(_morphs[i].sum.data() + begin, _morphs[i].sum.data() + begin + len, out);
+        }
+    }
+    _morphMatrixBins = nbins;
+}
+
+void FastVerticalInterpHistPdf2Base::syncTotalMatrix(FastTemplate &cache) const {
+    // The total is cache += M * w, with M the matrix of all the diff and sum templates and w
+    // the interpolation weights. Each morph still contributes a*(diff + b*sum) to each bin as in
+    // FastTemplate::Meld, in the same order, so that the result is identical to the loop in syncTotal.
+    unsigned int nbins = cache.size(), ndim = _morphs.size();
+    if (nbins == 0) return;
+    if (_morphMatrixBins != nbins || _morphMatrix.size() != 2 * std::size_t(ndim) * nbins) packMorphMatrix(nbins);
+
+    // compute all the weights first, and skip the morphs whose parameter is at zero
+    _morphWeights.resize(2 * ndim);
+    _morphActive.clear();
+    for (unsigned int i = 0; i < ndim; ++i) {
+        double x = _morphParams[i]->getVal();
+        if (x == 0) continue;
+        _morphWeights[2 * _morphActive.size()] = 0.5*x;
+        _morphWeights[2 * _morphActive.size() + 1] = smoothStepFunc(x);
+        _morphActive.push_back(i);
+    }
+    if (_morphActive.empty()) return;
+
+    FastTemplate::T *total = cache.data();
+    const FastTemplate::T *weights = &_morphWeights[0];
+    const unsigned int *active = &_morphActive[0], nactive = _morphActive.size();
+    for (unsigned int begin = 0; begin < nbins; begin += kMorphBlockSize) {
+        unsigned int len = std::min(kMorphBlockSize, nbins - begin), stride = 2 * len, j = 0;
+        const FastTemplate::T *block = &_morphMatrix[2 * std::size_t(ndim) * begin];
+        for (; j + 4 <= nactive; j += 4) {
+            meldBlock4(total + begin, len, block + active[j] * stride, block + active[j+1] * stride,
+                       block + active[j+2] * stride, block + active[j+3] * stride, weights + 2*j);
+        }
+        for (; j < nactive; ++j) {
+            const FastTemplate::T *m = block + active[j] * stride;
+            meldBlock(total + begin, len, m, m + len, weights + 2*j);
+        }
+    }
+}
+
 void FastVerticalInterpHistPdf2::syncTotal() const {
     FastVerticalInterpHistPdf2Base::syncTotal(_cache, _cacheNominal, _cacheNominalLog);
 
@@ -1115,16 +1213,19 @@ FastVerticalInterpHistPdf2V::FastVerticalInterpHistPdf2V(const FastVerticalInter
     if (hpdf._cache.size() == 0) hpdf._cache = hpdf._cacheNominal;
     if (!hpdf._sentry.good()) hpdf.syncTotal();
     // find bins
-    std::vector<int> bins;
+    std::vector<double> xvals;
     RooArgSet obs(hpdf._x.arg());
     const RooRealVar &x = static_cast<const RooRealVar &>(*obs.first());
-    bool aligned = true;
     for (int i = 0, n = data.numEntries(); i < n; ++i) {
         obs = *data.get(i);
         if (data.weight() == 0 && !includeZeroWeights) continue;
-        int idx = hpdf._cache.FindBin(x.getVal());
-        if (!bins.empty() && idx != bins.back() + 1) aligned = false;
-        bins.push_back(idx);
+        xvals.push_back(x.getVal());
+    }
+    std::vector<int> bins(xvals.size());
+    if (!xvals.empty()) hpdf._cache.FindBins(xvals.size(), &xvals[0], &bins[0]);
+    bool aligned = true;
+    for (int i = 1, n = bins.size(); i < n; ++i) {
+        if (bins[i] != bins[i-1] + 1) { aligned = false; break; }
     }
     if (bins.empty()) {
         // nothing to do.
@@ -120,6 +120,10 @@ void utils::printPdf(RooWorkspace *w, const char *pdfName) {
 }
 
 RooAbsPdf *utils::factorizePdf(const RooArgSet &observables, RooAbsPdf &pdf, RooArgList &constraints) {
+    return factorizePdf(observables, pdf, constraints, [&observables](const RooAbsPdf &term) { return term.dependsOn(observables); });
+}
+
+RooAbsPdf *utils::factorizePdf(const RooArgSet &observables, RooAbsPdf &pdf, RooArgList &constraints, const std::function<bool(const RooAbsPdf &)> &obsDependent) {
     //assert(&pdf);
     const std::type_info & id = typeid(pdf);
     if (id == typeid(RooProdPdf)) {
@@ -130,7 +134,7 @@ RooAbsPdf *utils::factorizePdf(const RooArgSet &observables, RooAbsPdf &pdf, Roo
         bool needNew = false;
         for (int i = 0, n = list.getSize(); i < n; ++i) {
             RooAbsPdf *pdfi = (RooAbsPdf *) list.at(i);
-            RooAbsPdf *newpdf = factorizePdf(observables, *pdfi, constraints);
+            RooAbsPdf *newpdf = factorizePdf(observables, *pdfi, constraints, obsDependent);
             //std::cout << "    for " << pdfi->GetName() << "   newpdf  " << (newpdf == 0 ? "null" : (newpdf == pdfi ? "old" : "new"))  << std::endl;
             if (newpdf == 0) { needNew = true; continue; }
             if (newpdf != pdfi) { needNew = true; newOwned.add(*newpdf); }
@@ -156,7 +160,7 @@ RooAbsPdf *utils::factorizePdf(const RooArgSet &observables, RooAbsPdf &pdf, Roo
         for (int ic = 0, nc = nbins; ic < nc; ++ic) {
             cat->setBin(ic);
             RooAbsPdf *pdfi = sim->getPdf(cat->getLabel());
-            RooAbsPdf *newpdf = factorizePdf(observables, *pdfi, constraints);
+            RooAbsPdf *newpdf = factorizePdf(observables, *pdfi, constraints, obsDependent);
             factorizedPdfs[ic] = newpdf;
             if (newpdf == 0) { throw std::runtime_error(std::string("ERROR: channel ") + cat->getLabel() + " factorized to zero."); }
             if (newpdf != pdfi) { needNew = true; newOwned.add(*newpdf); }
@@ -185,7 +189,7 @@ RooAbsPdf *utils::factorizePdf(const RooArgSet &observables, RooAbsPdf &pdf, Roo
         delete cat;
         copyAttributes(pdf, *ret);
         return ret;
-    } else if (pdf.dependsOn(observables)) {
+    } else if (obsDependent(pdf)) {
         return &pdf;
     } else {
         if (!constraints.contains(pdf) && (!pdf.getAttribute("ignoreConstraint"))) constraints.add(pdf);
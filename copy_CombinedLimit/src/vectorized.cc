@@ -1,119 +1,178 @@
 #include "vectorized.h"
 #include "./MathHeaders.h"
 #include "../interface/Accumulators.h"
+#include "../interface/ProfilingTools.h"
+#include "../interface/CombineLogger.h"
+#include <atomic>
+#include <string>
+#include <TString.h>
+
+// The kernel bodies in vectorized_kernels.h are compiled once with the default flags of the build
+// and, on x86-64, once more for each of SSE4.2, AVX2 and AVX-512, with a target attribute on each
+// kernel. Floating point contraction is switched off for this file by the build (-ffp-contract=off),
+// so that the wider instruction sets don't introduce fused multiply-adds, and all versions give the
+// same results.
+#if defined(__x86_64__) && defined(__GNUC__) && defined(__linux__) && !defined(COMBINE_NO_ISA_DISPATCH)
+#define COMBINE_ISA_DISPATCH
+#endif
 
-void vectorized::mul_add(const uint32_t size, double coeff, double const * __restrict__ iarray, double* __restrict__ oarray) {
-    for (uint32_t i = 0; i < size; ++i) {
-        oarray[i] += coeff * iarray[i];
-    } 
+namespace vectorized {
+#define VECTORIZED_KERNEL
+namespace generic {
+#include "vectorized_kernels.h"
 }
-
-void vectorized::mul_add_sqr(const uint32_t size, double coeff, double const * __restrict__ iarray, double* __restrict__ oarray) {
-    for (uint32_t i = 0; i < size; ++i) {
-        oarray[i] += (coeff * coeff * iarray[i] * iarray[i]);
-    } 
+#undef VECTORIZED_KERNEL
+#ifdef COMBINE_ISA_DISPATCH
+#define VECTORIZED_KERNEL __attribute__((target("sse4.2")))
+namespace sse42 {
+#include "vectorized_kernels.h"
 }
+#undef VECTORIZED_KERNEL
+#define VECTORIZED_KERNEL __attribute__((target("avx2")))
+namespace avx2 {
+#include "vectorized_kernels.h"
+}
+#undef VECTORIZED_KERNEL
+#define VECTORIZED_KERNEL __attribute__((target("avx512f")))
+namespace avx512 {
+#include "vectorized_kernels.h"
+}
+#undef VECTORIZED_KERNEL
+#endif
 
-void vectorized::mul_inplace(const uint32_t size, double const * __restrict__ iarray, double* __restrict__ oarray) {
-    for (uint32_t i = 0; i < size; ++i) {
-        oarray[i] *= iarray[i];
-    } 
+namespace {
+    struct Kernels {
+        vectorized::ISA isa;
+        decltype(&generic::mul_add) mul_add;
+        decltype(&generic::mul_add_sqr) mul_add_sqr;
+        decltype(&generic::mul_inplace) mul_inplace;
+        decltype(&generic::sqrt) sqrt;
+        decltype(&generic::nll_reduce) nll_reduce;
+        decltype(&generic::gaussians) gaussians;
+        decltype(&generic::exponentials) exponentials;
+        decltype(&generic::powers) powers;
+        decltype(&generic::dot_product) dot_product;
+    };
+
+#define VECTORIZED_KERNELS(ns, isa) { isa, &ns::mul_add, &ns::mul_add_sqr, &ns::mul_inplace, &ns::sqrt, &ns::nll_reduce, \
+                                      &ns::gaussians, &ns::exponentials, &ns::powers, &ns::dot_product }
+    const Kernels kernels_[] = {
+        VECTORIZED_KERNELS(generic, ISA::Generic),
+#ifdef COMBINE_ISA_DISPATCH
+        VECTORIZED_KERNELS(sse42, ISA::SSE42),
+        VECTORIZED_KERNELS(avx2, ISA::AVX2),
+        VECTORIZED_KERNELS(avx512, ISA::AVX512),
+#endif
+    };
+#undef VECTORIZED_KERNELS
+    const unsigned int nKernels_ = sizeof(kernels_)/sizeof(kernels_[0]);
+
+    // resolved on first use rather than at load time, as the runtime defines are only set later
+    std::atomic<const Kernels *> active_(nullptr);
+
+    bool cpuSupports(ISA isa) {
+#ifdef COMBINE_ISA_DISPATCH
+        __builtin_cpu_init();
+        switch (isa) {
+            case ISA::Generic: return true;
+            case ISA::SSE42:   return __builtin_cpu_supports("sse4.2");
+            case ISA::AVX2:    return __builtin_cpu_supports("avx2");
+            case ISA::AVX512:  return __builtin_cpu_supports("avx512f");
+        }
+        return false;
+#else
+        return isa == ISA::Generic;
+#endif
+    }
+
+    const Kernels * resolve() {
+        const Kernels *best = &kernels_[0];
+        for (unsigned int i = 1; i < nKernels_; ++i) {
+            if (cpuSupports(kernels_[i].isa)) best = &kernels_[i];
+        }
+        int requested = runtimedef::get("VECTORIZED_ISA");
+        if (requested > 0) {
+            ISA isa = ISA(requested - 1);
+            if (requested <= 4 && isaAvailable(isa)) {
+                best = &kernels_[requested - 1];
+            } else {
+                CombineLogger::instance().log("vectorized.cc",__LINE__,std::string(Form("VECTORIZED_ISA=%d is not available on this machine, using %s", requested, isaName(best->isa))),__func__);
+            }
+        }
+        return best;
+    }
+
+    inline const Kernels & kernels() {
+        const Kernels *ret = active_.load(std::memory_order_acquire);
+        if (ret == nullptr) {
+            const Kernels *expected = nullptr;
+            ret = resolve();
+            if (!active_.compare_exchange_strong(expected, ret, std::memory_order_acq_rel)) ret = expected;
+        }
+        return *ret;
+    }
+}
 }
 
-void vectorized::sqrt(const uint32_t size, double const * __restrict__ iarray, double* __restrict__ oarray) {
-    for (uint32_t i = 0; i < size; ++i) {
-        oarray[i] = std::sqrt(iarray[i]);
+const char * vectorized::isaName(ISA isa) {
+    switch (isa) {
+        case ISA::Generic: return "generic";
+        case ISA::SSE42:   return "sse4.2";
+        case ISA::AVX2:    return "avx2";
+        case ISA::AVX512:  return "avx512";
     }
+    return "unknown";
 }
 
+bool vectorized::isaAvailable(ISA isa) {
+    return unsigned(isa) < nKernels_ && cpuSupports(isa);
+}
 
-double vectorized::nll_reduce(const uint32_t size, double* __restrict__ pdfvals, double const * __restrict__ weights, double sumcoeff,  double *  __restrict__ workingArea) {
-    double invsum = 1.0/sumcoeff;
-#ifndef COMBINE_NO_VDT
-    for (uint32_t i = 0; i < size; ++i) {
-        pdfvals[i] *= invsum;
-    }
+vectorized::ISA vectorized::activeISA() {
+    return kernels().isa;
+}
 
-    vdt::fast_logv(size, pdfvals, workingArea);
+bool vectorized::setISA(ISA isa) {
+    if (!isaAvailable(isa)) return false;
+    active_.store(&kernels_[unsigned(isa)], std::memory_order_release);
+    return true;
+}
 
-    for (uint32_t i = 0; i < size; ++i) {
-        pdfvals[i] = weights[i] * workingArea[i];
-    }
-#else
-    for (uint32_t i = 0; i < size; ++i) {
-        pdfvals[i] = weights[i] * std::log(invsum * pdfvals[i]);
-    }
-#endif
+void vectorized::mul_add(const uint32_t size, double coeff, double const * __restrict__ iarray, double* __restrict__ oarray) {
+    kernels().mul_add(size, coeff, iarray, oarray);
+}
 
+void vectorized::mul_add_sqr(const uint32_t size, double coeff, double const * __restrict__ iarray, double* __restrict__ oarray) {
+    kernels().mul_add_sqr(size, coeff, iarray, oarray);
+}
 
-    DefaultAccumulator<double> ret = 0;
-    for (uint32_t i = 0; i < size; ++i) {
-        ret += pdfvals[i];
-    }
+void vectorized::mul_inplace(const uint32_t size, double const * __restrict__ iarray, double* __restrict__ oarray) {
+    kernels().mul_inplace(size, iarray, oarray);
+}
 
-    return ret.sum();
+void vectorized::sqrt(const uint32_t size, double const * __restrict__ iarray, double* __restrict__ oarray) {
+    kernels().sqrt(size, iarray, oarray);
+}
+
+double vectorized::nll_reduce(const uint32_t size, double* __restrict__ pdfvals, double const * __restrict__ weights, double sumcoeff,  double *  __restrict__ workingArea) {
+    return kernels().nll_reduce(size, pdfvals, weights, sumcoeff, workingArea);
 }
 
 void vectorized::gaussians(const uint32_t size, double mean, double sigma, double norm, const double* __restrict__ xvals, double * __restrict__ out, double * __restrict__ workingArea, double * __restrict__ workingArea2)
 {
-    double xscale = -0.5/(sigma*sigma);
-    const double inorm = 1.0/norm;
-#ifndef COMBINE_NO_VDT
-    for (uint32_t i = 0; i < size; ++i) {
-        const double arg = xvals[i] - mean;
-        workingArea[i] = xscale * arg * arg;
-    }
-    vdt::fast_expv(size, workingArea, workingArea2);
-    for (uint32_t i = 0; i < size; ++i) {
-        out[i] = inorm*workingArea2[i];
-    }
-#else
-    for (uint32_t i = 0; i < size; ++i) {
-        const double arg = xvals[i] - mean;
-        out[i] = inorm * std::exp(xscale * arg * arg);
-    }
-#endif
+    kernels().gaussians(size, mean, sigma, norm, xvals, out, workingArea, workingArea2);
 }
 
 void vectorized::exponentials(const uint32_t size, double lambda, double norm, const double* __restrict__ xvals, double * __restrict__ out, double * __restrict__ workingArea)
 {
-    //out[i] = std::exp(xvals[i]*lambda) * nfact; nfact = 1.0/norm
-    double lognfact = -std::log(norm);
-#ifndef COMBINE_NO_VDT
-    for (uint32_t i = 0; i < size; ++i) {
-        workingArea[i] = xvals[i] * lambda + lognfact;
-    }
-    vdt::fast_expv(size, workingArea, out);
-#else
-    for (uint32_t i = 0; i < size; ++i) {
-        out[i] = std::exp(xvals[i] * lambda + lognfact);
-    }
-#endif
+    kernels().exponentials(size, lambda, norm, xvals, out, workingArea);
 }
 
 void vectorized::powers(const uint32_t size, double exponent, double norm, const double* __restrict__ xvals, double * __restrict__ out, double * __restrict__ workingArea)
 {
-    //out[i] = std::pow(xvals[i],exponent) * nfact; // nfact = 1.0/norm
-    double lognfact = -std::log(norm);
-#ifndef COMBINE_NO_VDT
-    vdt::fast_logv(size, xvals, workingArea);
-    for (uint32_t i = 0; i < size; ++i) {
-        workingArea[i] = workingArea[i]*exponent + lognfact;
-    }
-    vdt::fast_expv(size, workingArea, out);
-#else
-    for (uint32_t i = 0; i < size; ++i) {
-        out[i] = std::exp(std::log(xvals[i]) * exponent + lognfact);
-    }
-#endif
+    kernels().powers(size, exponent, norm, xvals, out, workingArea);
 }
 
 double vectorized::dot_product(const uint32_t size, double const * __restrict__ vec1, double const *  __restrict__ vec2) {
-    DefaultAccumulator<double> ret = 0;
-    for (uint32_t i = 0; i < size; ++i) {
-        ret += vec1[i]*vec2[i];
-    }
-    return ret.sum();
+    return kernels().dot_product(size, vec1, vec2);
 }
-
-
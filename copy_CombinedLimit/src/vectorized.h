@@ -25,7 +25,20 @@ namespace vectorized {
     // powers
     void powers(const uint32_t size, double lambda, double norm, const double* __restrict__ xvals, double * __restrict__ out, double * __restrict__ workingArea) ;
 
-    // dot product of two vectors 
+    // dot product of two vectors
     double dot_product(const uint32_t size, double const * __restrict__ iarray, double const * __restrict__ iarray2) ;
+
+    // The kernels above are compiled once per instruction set and the best one supported by the
+    // cpu is used, unless overridden with --X-rtd VECTORIZED_ISA=N (N = 1 + the ISA value below).
+    // Results are the same for all instruction sets (no fused multiply-add contraction).
+    enum class ISA { Generic = 0, SSE42 = 1, AVX2 = 2, AVX512 = 3 };
+
+    const char * isaName(ISA isa) ;
+    // true if the kernels were built for this instruction set and the cpu supports it
+    bool isaAvailable(ISA isa) ;
+    // instruction set currently used by the kernels
+    ISA activeISA() ;
+    // use the kernels for this instruction set; returns false (and changes nothing) if not available
+    bool setISA(ISA isa) ;
 }
 
@@ -0,0 +1,120 @@
+// Bodies of the vectorized:: kernels.
+// This file has no include guard on purpose: vectorized.cc includes it once per instruction set,
+// inside a different namespace and with VECTORIZED_KERNEL defined to a different target attribute
+// each time, so that the same loops get compiled for SSE4.2, AVX2 and AVX-512 and the best one can
+// be picked at run time.
+// It must not include anything itself (MathHeaders.h and Accumulators.h are included before).
+
+VECTORIZED_KERNEL void mul_add(const uint32_t size, double coeff, double const * __restrict__ iarray, double* __restrict__ oarray) {
+    for (uint32_t i = 0; i < size; ++i) {
+        oarray[i] += coeff * iarray[i];
+    }
+}
+
+VECTORIZED_KERNEL void mul_add_sqr(const uint32_t size, double coeff, double const * __restrict__ iarray, double* __restrict__ oarray) {
+    for (uint32_t i = 0; i < size; ++i) {
+        oarray[i] += (coeff * coeff * iarray[i] * iarray[i]);
+    }
+}
+
+VECTORIZED_KERNEL void mul_inplace(const uint32_t size, double const * __restrict__ iarray, double* __restrict__ oarray) {
+    for (uint32_t i = 0; i < size; ++i) {
+        oarray[i] *= iarray[i];
+    }
+}
+
+VECTORIZED_KERNEL void sqrt(const uint32_t size, double const * __restrict__ iarray, double* __restrict__ oarray) {
+    for (uint32_t i = 0; i < size; ++i) {
+        oarray[i] = std::sqrt(iarray[i]);
+    }
+}
+
+
+VECTORIZED_KERNEL double nll_reduce(const uint32_t size, double* __restrict__ pdfvals, double const * __restrict__ weights, double sumcoeff,  double *  __restrict__ workingArea) {
+    double invsum = 1.0/sumcoeff;
+#ifndef COMBINE_NO_VDT
+    for (uint32_t i = 0; i < size; ++i) {
+        pdfvals[i] *= invsum;
+    }
+
+    vdt::fast_logv(size, pdfvals, workingArea);
+
+    for (uint32_t i = 0; i < size; ++i) {
+        pdfvals[i] = weights[i] * workingArea[i];
+    }
+#else
+    for (uint32_t i = 0; i < size; ++i) {
+        pdfvals[i] = weights[i] * std::log(invsum * pdfvals[i]);
+    }
+#endif
+
+
+    DefaultAccumulator<double> ret = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        ret += pdfvals[i];
+    }
+
+    return ret.sum();
+}
+
+VECTORIZED_KERNEL void gaussians(const uint32_t size, double mean, double sigma, double norm, const double* __restrict__ xvals, double * __restrict__ out, double * __restrict__ workingArea, double * __restrict__ workingArea2)
+{
+    double xscale = -0.5/(sigma*sigma);
+    const double inorm = 1.0/norm;
+#ifndef COMBINE_NO_VDT
+    for (uint32_t i = 0; i < size; ++i) {
+        const double arg = xvals[i] - mean;
+        workingArea[i] = xscale * arg * arg;
+    }
+    vdt::fast_expv(size, workingArea, workingArea2);
+    for (uint32_t i = 0; i < size; ++i) {
+        out[i] = inorm*workingArea2[i];
+    }
+#else
+    for (uint32_t i = 0; i < size; ++i) {
+        const double arg = xvals[i] - mean;
+        out[i] = inorm * std::exp(xscale * arg * arg);
+    }
+#endif
+}
+
+VECTORIZED_KERNEL void exponentials(const uint32_t size, double lambda, double norm, const double* __restrict__ xvals, double * __restrict__ out, double * __restrict__ workingArea)
+{
+    //out[i] = std::exp(xvals[i]*lambda) * nfact; nfact = 1.0/norm
+    double lognfact = -std::log(norm);
+#ifndef COMBINE_NO_VDT
+    for (uint32_t i = 0; i < size; ++i) {
+        workingArea[i] = xvals[i] * lambda + lognfact;
+    }
+    vdt::fast_expv(size, workingArea, out);
+#else
+    for (uint32_t i = 0; i < size; ++i) {
+        out[i] = std::exp(xvals[i] * lambda + lognfact);
+    }
+#endif
+}
+
+VECTORIZED_KERNEL void powers(const uint32_t size, double exponent, double norm, const double* __restrict__ xvals, double * __restrict__ out, double * __restrict__ workingArea)
+{
+    //out[i] = std::pow(xvals[i],exponent) * nfact; // nfact = 1.0/norm
+    double lognfact = -std::log(norm);
+#ifndef COMBINE_NO_VDT
+    vdt::fast_logv(size, xvals, workingArea);
+    for (uint32_t i = 0; i < size; ++i) {
+        workingArea[i] = workingArea[i]*exponent + lognfact;
+    }
+    vdt::fast_expv(size, workingArea, out);
+#else
+    for (uint32_t i = 0; i < size; ++i) {
+        out[i] = std::exp(std::log(xvals[i]) * exponent + lognfact);
+    }
+#endif
+}
+
+VECTORIZED_KERNEL double dot_product(const uint32_t size, double const * __restrict__ vec1, double const *  __restrict__ vec2) {
+    DefaultAccumulator<double> ret = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        ret += vec1[i]*vec2[i];
+    }
+    return ret.sum();
+}
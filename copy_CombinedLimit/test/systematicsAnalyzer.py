@@ -101,6 +101,7 @@ options.optimizeBoundNuisances = False
 options.useHistPdf = False
 options.optimizeExistingTemplates = False
 options.packAsymPows = False
+options.bulkChannels = False
 options.noBOnly = True
 options.moreOptimizeSimPdf = "none"
 options.doMasks = False
@@ -0,0 +1,97 @@
+// Throughput of the vectorized:: kernels for each instruction set supported by this machine.
+// Usage: benchmarkVectorized.exe [length1 length2 ...]
+// For each kernel, instruction set and array length it prints the time per element and the
+// throughput, and checks that the results are identical to the generic version.
+#include "vectorized.h"
+#include "HiggsAnalysis/CombinedLimit/interface/ProfilingTools.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include <TRandom3.h>
+
+struct Arrays {
+    std::vector<double> x, y, w, out, out2, work, work2;
+    Arrays(unsigned int n) : x(n), y(n), w(n), out(n), out2(n), work(n), work2(n) {
+        TRandom3 rnd(37);
+        for (unsigned int i = 0; i < n; ++i) {
+            x[i] = rnd.Uniform(0.1, 10.);
+            y[i] = rnd.Uniform(0.999, 1.001); // close to 1, so that repeated mul_inplace stays finite
+            w[i] = rnd.Poisson(3.);
+        }
+    }
+};
+
+struct Kernel {
+    std::string name;
+    // run the kernel once on the arrays; returns something that depends on the result
+    std::function<double(Arrays &)> run;
+};
+
+std::vector<Kernel> kernels() {
+    std::vector<Kernel> ret;
+    ret.push_back({"mul_add",      [](Arrays &a) { vectorized::mul_add(a.x.size(), 1e-3, &a.x[0], &a.out[0]); return a.out.back(); }});
+    ret.push_back({"mul_add_sqr",  [](Arrays &a) { vectorized::mul_add_sqr(a.x.size(), 1e-3, &a.x[0], &a.out[0]); return a.out.back(); }});
+    ret.push_back({"mul_inplace",  [](Arrays &a) { vectorized::mul_inplace(a.x.size(), &a.y[0], &a.out[0]); return a.out.back(); }});
+    ret.push_back({"sqrt",         [](Arrays &a) { vectorized::sqrt(a.x.size(), &a.x[0], &a.out[0]); return a.out.back(); }});
+    ret.push_back({"nll_reduce",   [](Arrays &a) { std::copy(a.x.begin(), a.x.end(), a.out2.begin());
+                                                   return vectorized::nll_reduce(a.x.size(), &a.out2[0], &a.w[0], 7.0, &a.work[0]); }});
+    ret.push_back({"gaussians",    [](Arrays &a) { vectorized::gaussians(a.x.size(), 5., 2., 3., &a.x[0], &a.out[0], &a.work[0], &a.work2[0]); return a.out.back(); }});
+    ret.push_back({"exponentials", [](Arrays &a) { vectorized::exponentials(a.x.size(), -0.3, 3., &a.x[0], &a.out[0], &a.work[0]); return a.out.back(); }});
+    ret.push_back({"powers",       [](Arrays &a) { vectorized::powers(a.x.size(), -1.7, 3., &a.x[0], &a.out[0], &a.work[0]); return a.out.back(); }});
+    ret.push_back({"dot_product",  [](Arrays &a) { return vectorized::dot_product(a.x.size(), &a.x[0], &a.y[0]); }});
+    return ret;
+}
+
+// run the kernel once from a fixed starting point and return all its outputs
+std::vector<double> reference(const Kernel &k, unsigned int n) {
+    Arrays a(n);
+    std::fill(a.out.begin(), a.out.end(), 1.0);
+    double ret = k.run(a);
+    std::vector<double> all(a.out);
+    all.insert(all.end(), a.out2.begin(), a.out2.end());
+    all.push_back(ret);
+    return all;
+}
+
+int main(int argc, char **argv) {
+    std::vector<unsigned int> lengths;
+    for (int i = 1; i < argc; ++i) lengths.push_back(atoi(argv[i]));
+    if (lengths.empty()) lengths = { 16, 128, 1024, 8192, 65536, 1 << 20 };
+    const double minElements = 2e8; // per measurement, so that short arrays are timed over many calls
+
+    std::vector<vectorized::ISA> isas;
+    for (int i = 0; i <= int(vectorized::ISA::AVX512); ++i) {
+        if (vectorized::isaAvailable(vectorized::ISA(i))) isas.push_back(vectorized::ISA(i));
+    }
+    printf("Default instruction set: %s\n", vectorized::isaName(vectorized::activeISA()));
+    printf("%-13s %-8s %9s %10s %10s %9s %s\n", "kernel", "isa", "length", "ns/elem", "Melem/s", "speedup", "same");
+    for (const Kernel &k : kernels()) {
+        for (unsigned int n : lengths) {
+            double generic = 0;
+            std::vector<double> ref;
+            for (vectorized::ISA isa : isas) {
+                vectorized::setISA(isa);
+                std::vector<double> check = reference(k, n);
+                if (isa == vectorized::ISA::Generic) ref = check;
+                bool same = (check.size() == ref.size()) && !memcmp(&check[0], &ref[0], ref.size() * sizeof(double));
+
+                Arrays a(n);
+                unsigned int calls = std::max(1., minElements / n);
+                for (unsigned int i = 0; i < std::min(calls, 10u); ++i) profiler::doNotOptimize(k.run(a)); // warm up
+                std::fill(a.out.begin(), a.out.end(), 1.0);
+                auto start = std::chrono::steady_clock::now();
+                for (unsigned int i = 0; i < calls; ++i) profiler::doNotOptimize(k.run(a));
+                double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                double perElement = ns / (double(calls) * n);
+                if (isa == vectorized::ISA::Generic) generic = perElement;
+                printf("%-13s %-8s %9u %10.3f %10.1f %9.2f %s\n", k.name.c_str(), vectorized::isaName(isa), n, perElement,
+                        1e3 / perElement, generic / perElement, same ? "yes" : "NO");
+            }
+        }
+    }
+    return 0;
+}
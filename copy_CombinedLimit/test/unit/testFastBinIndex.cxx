@@ -0,0 +1,121 @@
+// FastBinIndex_t against std::upper_bound and std::lower_bound on the bin edges.
+// Usage: testFastBinIndex.exe
+// 8000 random axes of float and double edges: uniform ones (also with edges off by a rounding
+// error, so that the computed position must be corrected), which take the uniform path, and
+// non-uniform ones with repeated edges or infinite outer edges, which take the Eytzinger path.
+// They are queried at and next to every edge, inside and outside the axis, and at NaN and +-inf.
+#include "HiggsAnalysis/CombinedLimit/interface/FastBinIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+template <typename U>
+std::vector<U> randomAxis(std::mt19937 &rng, int kind) {
+    std::uniform_int_distribution<int> nbins(1, 2000), quarters(-400, 400), powers(-6, 4);
+    unsigned int n = nbins(rng) + 1;
+    // exact in float as well, so that these uniform axes are uniform also after the conversion
+    double lo = 0.25 * quarters(rng), width = std::ldexp(1.0, powers(rng));
+    std::vector<U> edges(n);
+    if (kind <= 1) {
+        for (unsigned int i = 0; i < n; ++i) edges[i] = U(lo + i * width);
+        if (kind == 1) {
+            // edges off by a few units in the last place: still uniform within the tolerance
+            std::uniform_int_distribution<int> ulps(-3, 3);
+            for (unsigned int i = 1; i + 1 < n; ++i) {
+                for (int k = ulps(rng); k != 0; k += (k > 0 ? -1 : 1)) {
+                    edges[i] = std::nextafter(edges[i], k > 0 ? std::numeric_limits<U>::max() : -std::numeric_limits<U>::max());
+                }
+            }
+        }
+    } else {
+        std::uniform_real_distribution<double> spread(lo, lo + n * width);
+        for (unsigned int i = 0; i < n; ++i) edges[i] = U(spread(rng));
+        if (kind == 3) {
+            // repeated edges
+            std::uniform_int_distribution<unsigned int> pick(0, n - 1);
+            for (unsigned int i = 0; i < n / 4 + 1; ++i) edges[pick(rng)] = edges[pick(rng)];
+        }
+        std::sort(edges.begin(), edges.end());
+        if (kind == 4 && n >= 2) {
+            edges.front() = -std::numeric_limits<U>::infinity();
+            edges.back() = std::numeric_limits<U>::infinity();
+        }
+    }
+    return edges;
+}
+
+template <typename U>
+bool checkAxis(const std::vector<U> &edges, int kind, std::mt19937 &rng, unsigned int &nuniform) {
+    FastBinIndex_t<U> index;
+    index.build(&edges[0], edges.size());
+    if (index.uniform()) nuniform++;
+    // a few units in the last place of a float edge can be more than the tolerance on the bin width,
+    // so those axes may take either path; two distinct finite edges are always uniform
+    bool expectUniform = (kind == 0 || kind == 1) ? edges.size() >= 2 :
+                         (edges.size() == 2 && edges[0] < edges[1] && std::isfinite(double(edges[1]) - double(edges[0])));
+    if (kind == 1 && sizeof(U) == sizeof(float)) expectUniform = index.uniform();
+    if (index.uniform() != expectUniform) {
+        printf("ERROR: axis of %u edges of kind %d is%s taken as uniform\n", unsigned(edges.size()), kind, index.uniform() ? "" : " not");
+        return false;
+    }
+
+    const U inf = std::numeric_limits<U>::infinity();
+    std::vector<U> xs = { std::numeric_limits<U>::quiet_NaN(), inf, -inf, std::numeric_limits<U>::max(), -std::numeric_limits<U>::max() };
+    for (unsigned int i = 0; i < edges.size(); ++i) {
+        xs.push_back(edges[i]);
+        xs.push_back(std::nextafter(edges[i], inf));
+        xs.push_back(std::nextafter(edges[i], -inf));
+        if (i + 1 < edges.size()) xs.push_back(edges[i] + U(0.5) * (edges[i+1] - edges[i]));
+    }
+    double lo = std::isfinite(double(edges.front())) ? edges.front() : -1e3, hi = std::isfinite(double(edges.back())) ? edges.back() : 1e3;
+    std::uniform_real_distribution<double> flat(lo - 0.1 * (hi - lo) - 1, hi + 0.1 * (hi - lo) + 1);
+    for (int i = 0; i < 200; ++i) xs.push_back(U(flat(rng)));
+
+    std::vector<int> ubins(xs.size()), lbins(xs.size());
+    index.upperBins(xs.size(), &xs[0], &ubins[0]);
+    index.lowerBins(xs.size(), &xs[0], &lbins[0]);
+    for (unsigned int i = 0; i < xs.size(); ++i) {
+        unsigned int up = std::upper_bound(edges.begin(), edges.end(), xs[i]) - edges.begin();
+        unsigned int low = std::lower_bound(edges.begin(), edges.end(), xs[i]) - edges.begin();
+        if (index.upperBound(xs[i]) != up || index.lowerBound(xs[i]) != low || ubins[i] != int(up) - 1 || lbins[i] != int(low) - 1) {
+            printf("ERROR: %s axis of %u edges of kind %d, x = %.9g: upper %u lower %u instead of %u %u\n",
+                   sizeof(U) == sizeof(float) ? "float" : "double", unsigned(edges.size()), kind, double(xs[i]),
+                   index.upperBound(xs[i]), index.lowerBound(xs[i]), up, low);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    std::mt19937 rng(4357);
+    bool ok = true;
+    unsigned int nuniform = 0, naxes = 0;
+    // kinds: 0 uniform, 1 uniform within rounding, 2 random, 3 random with repeated edges, 4 random with infinite ends
+    for (int itry = 0; itry < 800 && ok; ++itry) {
+        for (int kind = 0; kind < 5 && ok; ++kind) {
+            ok = checkAxis(randomAxis<float>(rng, kind), kind, rng, nuniform) && ok;
+            ok = checkAxis(randomAxis<double>(rng, kind), kind, rng, nuniform) && ok;
+            naxes += 2;
+        }
+    }
+    // a single edge and no edges at all
+    for (unsigned int n = 0; n <= 1 && ok; ++n) {
+        std::vector<double> edges(n, 1.0);
+        FastBinIndex_t<double> index;
+        index.build(edges.data(), n);
+        for (double x : { 0.0, 1.0, 2.0, std::numeric_limits<double>::quiet_NaN() }) {
+            unsigned int up = std::upper_bound(edges.begin(), edges.end(), x) - edges.begin();
+            unsigned int low = std::lower_bound(edges.begin(), edges.end(), x) - edges.begin();
+            if (index.upperBound(x) != up || index.lowerBound(x) != low) {
+                printf("ERROR: axis of %u edges, x = %g: upper %u lower %u instead of %u %u\n", n, x, index.upperBound(x), index.lowerBound(x), up, low);
+                ok = false;
+            }
+        }
+    }
+    printf("checked %u axes, %u of them uniform\n", naxes, nuniform);
+    return ok ? 0 : 1;
+}
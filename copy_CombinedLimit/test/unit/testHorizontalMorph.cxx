@@ -0,0 +1,330 @@
+// Accuracy and speed of the horizontal morphing of HorizontalMorph (used by CMSHistFunc and th1fmorph).
+// Usage: testHorizontalMorph.exe [bins1 bins2 ...]
+// Two gaussian templates of different mean and width are morphed to intermediate points, and compared
+// with the binned gaussian of interpolated mean and width, which is what the cdf interpolation gives
+// exactly for a continuous distribution. It prints, for each number of bins, the largest deviation
+// in units of the peak bin content, the largest difference between the CMSHistFunc and th1fmorph
+// conventions, and the time for the tables and for each morphing step. The deviation must be below
+// 4/bins (it is about 3/bins, from the linear interpolation of the cdf within the bins).
+// Then random templates (uniform and variable binning, empty bins, different binnings of the two
+// inputs of th1fmorph) are morphed by HorizontalMorph and th1fmorph, and by the copies below of the
+// implementations of CMSHistFunc::cdfMorph and th1fmorph that preceded HorizontalMorph: the results
+// must be the same.
+#include "HiggsAnalysis/CombinedLimit/interface/HorizontalMorph.h"
+#include "HiggsAnalysis/CombinedLimit/interface/th1fmorph.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <TH1D.h>
+#include <TMath.h>
+
+std::vector<double> gaussian(const std::vector<double> &edges, double mean, double sigma) {
+    std::vector<double> ret(edges.size() - 1);
+    for (unsigned int i = 0; i < ret.size(); ++i) {
+        ret[i] = 0.5 * (TMath::Erf((edges[i+1] - mean) / (sigma * M_SQRT2)) - TMath::Erf((edges[i] - mean) / (sigma * M_SQRT2)));
+    }
+    return ret;
+}
+
+namespace reference {
+    // CMSHistFunc::prepareInterpCache and CMSHistFunc::cdfMorph: both templates have the binning of
+    // the edges, cdf1 and cdf2 are their cumulative distributions, the result is a density
+    std::vector<double> histFuncMorph(const std::vector<double> &edges, std::vector<double> cdf1, std::vector<double> cdf2, double wt1, double wt2) {
+        int nbn = edges.size() - 1;
+        // the original read one element past the end of the cdfs, here it has the last value
+        cdf1.push_back(cdf1.back()); cdf2.push_back(cdf2.back());
+        std::vector<double> tx1, tx2, ty;
+        int ix1l = nbn, ix2l = nbn;
+        while (cdf1[ix1l - 1] >= cdf1[ix1l]) ix1l = ix1l - 1;
+        while (cdf2[ix2l - 1] >= cdf2[ix2l]) ix2l = ix2l - 1;
+        int ix1 = -1, ix2 = -1;
+        do { ix1 = ix1 + 1; } while (cdf1[ix1 + 1] <= cdf1[0]);
+        do { ix2 = ix2 + 1; } while (cdf2[ix2 + 1] <= cdf2[0]);
+        double x1 = edges[ix1], x2 = edges[ix2];
+        tx1.push_back(x1); tx2.push_back(x2); ty.push_back(0.);
+        double yprev = -1, y = 0;
+        while ((ix1 < ix1l) | (ix2 < ix2l)) {
+            int i12type = -1;
+            if ((cdf1[ix1 + 1] <= cdf2[ix2 + 1] || ix2 == ix2l) && ix1 < ix1l) {
+                ix1 = ix1 + 1;
+                while (cdf1[ix1 + 1] < cdf1[ix1] && ix1 < ix1l) ix1 = ix1 + 1;
+                i12type = 1;
+            } else if (ix2 < ix2l) {
+                ix2 = ix2 + 1;
+                while (cdf2[ix2 + 1] <= cdf2[ix2] && ix2 < ix2l) ix2 = ix2 + 1;
+                i12type = 2;
+            }
+            if (i12type == 1) {
+                x1 = edges[ix1]; y = cdf1[ix1];
+                double x20 = edges[ix2], y20 = cdf2[ix2], x21 = x20, y21 = y20;
+                if (ix2 < ix2l) { x21 = edges[ix2 + 1]; y21 = cdf2[ix2 + 1]; }
+                x2 = (y21 > y20 ? x20 + (x21 - x20) * (y - y20) / (y21 - y20) : x20);
+            } else {
+                x2 = edges[ix2]; y = cdf2[ix2];
+                double x10 = edges[ix1], y10 = cdf1[ix1], x11 = x10, y11 = y10;
+                if (ix1 < ix1l) { x11 = edges[ix1 + 1]; y11 = cdf1[ix1 + 1]; }
+                x1 = (y11 > y10 ? x10 + (x11 - x10) * (y - y10) / (y11 - y10) : x10);
+            }
+            if (y > yprev) {
+                yprev = y;
+                tx1.push_back(x1); tx2.push_back(x2); ty.push_back(y);
+            }
+        }
+
+        int nx3 = ty.size();
+        std::vector<double> xdisn(nx3), sigdisf(nbn + 1, 0.);
+        for (int i = 0; i < nx3; ++i) xdisn[i] = wt1 * tx1[i] + wt2 * tx2[i];
+        nx3 = nx3 - 1;
+        int ix = nbn;
+        double x = edges[ix];
+        while (x >= xdisn[nx3]) { sigdisf[ix] = ty[nx3]; ix = ix - 1; x = edges[ix]; }
+        int ixl = ix + 1;
+        ix = 0; x = edges[ix + 1];
+        while (x <= xdisn[0]) { sigdisf[ix] = ty[0]; ix = ix + 1; x = edges[ix + 1]; }
+        int ixf = ix, ix3 = 0;
+        for (ix = ixf; ix < ixl; ix++) {
+            x = edges[ix];
+            if (x < xdisn[0]) {
+                y = 0;
+            } else if (x > xdisn[nx3]) {
+                y = 1.;
+            } else {
+                while (xdisn[ix3 + 1] <= x && ix3 < 2 * nbn) ix3 = ix3 + 1;
+                // FastHisto::FindBin
+                int bin = std::lower_bound(edges.begin(), edges.end(), x) - edges.begin() - 1;
+                if (bin == -1) bin = 0;
+                double dx2 = edges[bin + 1] - edges[bin];
+                if (xdisn[ix3 + 1] - x >= 1.0 * dx2) {
+                    y = ty[ix3];
+                } else if (xdisn[ix3 + 1] > xdisn[ix3]) {
+                    y = ty[ix3] + (ty[ix3 + 1] - ty[ix3]) * (x - xdisn[ix3]) / (xdisn[ix3 + 1] - xdisn[ix3]);
+                } else {
+                    y = 0;
+                }
+            }
+            sigdisf[ix] = y;
+        }
+        std::vector<double> ret(nbn);
+        for (ix = nbn - 1; ix > -1; ix--) ret[ix] = (sigdisf[ix + 1] - sigdisf[ix]) / (edges[ix + 1] - edges[ix]);
+        return ret;
+    }
+
+    // th1fmorph, for the contents dist1 (dist2) with the edges edges1 (edges2), projected on the union of the edges
+    std::vector<double> th1fMorph(const std::vector<double> &edges1, const std::vector<double> &dist1,
+                                  const std::vector<double> &edges2, const std::vector<double> &dist2,
+                                  const std::vector<double> &edgesn, double wt1, double wt2) {
+        int nb1 = dist1.size(), nb2 = dist2.size(), nbn = edgesn.size() - 1;
+        // the original read one element past the end of sigdis1 and sigdis2, here it has the last value
+        std::vector<double> sigdis1(nb1 + 2), sigdis2(nb2 + 2), sigdisn(2 + nb1 + nb2), xdisn(2 + nb1 + nb2, 0.), sigdisf(nbn + 1);
+        for (int i = 1; i < nb1 + 1; i++) sigdis1[i] = dist1[i - 1];
+        for (int i = 1; i < nb2 + 1; i++) sigdis2[i] = dist2[i - 1];
+        double total = 0;
+        for (int i = 0; i < nb1 + 1; i++) total += sigdis1[i];
+        for (int i = 1; i < nb1 + 1; i++) sigdis1[i] = sigdis1[i] / total + sigdis1[i - 1];
+        total = 0;
+        for (int i = 0; i < nb2 + 1; i++) total += sigdis2[i];
+        for (int i = 1; i < nb2 + 1; i++) sigdis2[i] = sigdis2[i] / total + sigdis2[i - 1];
+        sigdis1[nb1 + 1] = sigdis1[nb1]; sigdis2[nb2 + 1] = sigdis2[nb2];
+        // TAxis::GetBinLowEdge and GetBinUpEdge of the inputs, TAxis::FindBin and GetBinWidth of the second one
+        auto edge1 = [&](int i) { return edges1[std::min(i, nb1)]; };
+        auto edge2 = [&](int i) { return edges2[std::min(i, nb2)]; };
+        auto width2 = [&](double x) {
+            int bin = (x < edges2[0] ? 0 : x >= edges2[nb2] ? nb2 + 1 : std::upper_bound(edges2.begin(), edges2.end(), x) - edges2.begin());
+            bin = std::min(std::max(bin, 1), nb2);
+            return edges2[bin] - edges2[bin - 1];
+        };
+
+        int ix1l = nb1, ix2l = nb2;
+        while (sigdis1[ix1l - 1] >= sigdis1[ix1l]) ix1l = ix1l - 1;
+        while (sigdis2[ix2l - 1] >= sigdis2[ix2l]) ix2l = ix2l - 1;
+        int ix1 = -1, ix2 = -1;
+        do { ix1 = ix1 + 1; } while (sigdis1[ix1 + 1] <= sigdis1[0]);
+        do { ix2 = ix2 + 1; } while (sigdis2[ix2 + 1] <= sigdis2[0]);
+        int nx3 = 0;
+        double x1 = edge1(ix1), x2 = edge2(ix2), x = wt1 * x1 + wt2 * x2;
+        xdisn[nx3] = x; sigdisn[nx3] = 0;
+        double yprev = -1, y = 0;
+        while ((ix1 < ix1l) | (ix2 < ix2l)) {
+            int i12type = -1;
+            if ((sigdis1[ix1 + 1] <= sigdis2[ix2 + 1] || ix2 == ix2l) && ix1 < ix1l) {
+                ix1 = ix1 + 1;
+                while (sigdis1[ix1 + 1] <= sigdis1[ix1] && ix1 < ix1l) ix1 = ix1 + 1;
+                i12type = 1;
+            } else if (ix2 < ix2l) {
+                ix2 = ix2 + 1;
+                while (sigdis2[ix2 + 1] <= sigdis2[ix2] && ix2 < ix2l) ix2 = ix2 + 1;
+                i12type = 2;
+            }
+            if (i12type == 1) {
+                x1 = edge1(ix1); y = sigdis1[ix1];
+                double x20 = edge2(ix2), x21 = edge2(ix2 + 1), y20 = sigdis2[ix2], y21 = sigdis2[ix2 + 1];
+                x2 = (y21 > y20 ? x20 + (x21 - x20) * (y - y20) / (y21 - y20) : x20);
+            } else {
+                x2 = edge2(ix2); y = sigdis2[ix2];
+                double x10 = edge1(ix1), x11 = edge1(ix1 + 1), y10 = sigdis1[ix1], y11 = sigdis1[ix1 + 1];
+                x1 = (y11 > y10 ? x10 + (x11 - x10) * (y - y10) / (y11 - y10) : x10);
+            }
+            x = wt1 * x1 + wt2 * x2;
+            if (y > yprev) {
+                nx3 = nx3 + 1;
+                yprev = y;
+                xdisn[nx3] = x; sigdisn[nx3] = y;
+            }
+        }
+
+        int ix = nbn;
+        x = edgesn[ix];
+        while (x >= xdisn[nx3]) { sigdisf[ix] = sigdisn[nx3]; ix = ix - 1; x = edgesn[ix]; }
+        int ixl = ix + 1;
+        ix = 0; x = edgesn[ix + 1];
+        while (x <= xdisn[0]) { sigdisf[ix] = sigdisn[0]; ix = ix + 1; x = edgesn[ix + 1]; }
+        int ixf = ix, ix3 = 0;
+        for (ix = ixf; ix < ixl; ix++) {
+            x = edgesn[ix];
+            if (x < xdisn[0]) {
+                y = 0;
+            } else if (x > xdisn[nx3]) {
+                y = 1.;
+            } else {
+                while (xdisn[ix3 + 1] <= x && ix3 < 2 * nbn) ix3 = ix3 + 1;
+                if (xdisn[ix3 + 1] - x > 1.1 * width2(x)) {
+                    y = sigdisn[ix3 + 1];
+                } else if (xdisn[ix3 + 1] > xdisn[ix3]) {
+                    y = sigdisn[ix3] + (sigdisn[ix3 + 1] - sigdisn[ix3]) * (x - xdisn[ix3]) / (xdisn[ix3 + 1] - xdisn[ix3]);
+                } else {
+                    y = 0;
+                }
+            }
+            sigdisf[ix] = y;
+        }
+        std::vector<double> ret(nbn);
+        for (ix = 0; ix < nbn; ix++) ret[ix] = sigdisf[ix + 1] - sigdisf[ix];
+        return ret;
+    }
+}
+
+// largest differences from the reference implementations of the CMSHistFunc and th1fmorph morphing
+void compareReference(int trials, double &maxHistFunc, double &maxTh1fMorph) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    maxHistFunc = 0; maxTh1fMorph = 0;
+    for (int trial = 0; trial < trials; ++trial) {
+        int n1 = 2 + rng() % 80, n2 = 2 + rng() % 60;
+        bool variable = trial % 2;
+        std::vector<double> edges1(n1 + 1, 0.), edges2(n2 + 1);
+        for (int i = 1; i <= n1; ++i) edges1[i] = edges1[i-1] + (variable ? 0.5 + uniform(rng) : 1.0);
+        double xmax = edges1[n1];
+        edges2[0] = variable ? uniform(rng) : 0.;
+        for (int i = 1; i <= n2; ++i) edges2[i] = edges2[0] + i * (xmax - edges2[0]) / n2;
+        double mean1 = xmax * (0.2 + 0.3 * uniform(rng)), mean2 = xmax * (0.4 + 0.4 * uniform(rng));
+        double sigma1 = xmax * 0.05 * (1 + uniform(rng)), sigma2 = xmax * 0.05 * (1 + uniform(rng));
+        auto contents = [&](const std::vector<double> &edges, double mean, double sigma, bool holes) {
+            std::vector<double> ret(edges.size() - 1);
+            for (unsigned int i = 0; i < ret.size(); ++i) {
+                double x = 0.5 * (edges[i] + edges[i+1]);
+                ret[i] = (holes && uniform(rng) < 0.2) ? 0. : std::exp(-0.5 * std::pow((x - mean) / sigma, 2));
+            }
+            return ret;
+        };
+        std::vector<double> d1 = contents(edges1, mean1, sigma1, trial % 3 == 0);
+        std::vector<double> d2 = contents(edges1, mean2, sigma2, trial % 5 == 0);
+        std::vector<double> g2 = contents(edges2, mean2, sigma2, trial % 5 == 0);
+        if (*std::max_element(d1.begin(), d1.end()) <= 0 || *std::max_element(d2.begin(), d2.end()) <= 0 ||
+            *std::max_element(g2.begin(), g2.end()) <= 0) continue;
+
+        // CMSHistFunc: the same binning for the two templates and the result
+        std::vector<double> cdf1(n1 + 1), cdf2(n1 + 1), out(n1);
+        HorizontalMorph::cumulative(n1, &d1[0], &cdf1[0]);
+        HorizontalMorph::cumulative(n1, &d2[0], &cdf2[0]);
+        HorizontalMorph hf;
+        hf.init(n1, &edges1[0], &cdf1[0], n1, &edges1[0], &cdf2[0], n1, &edges1[0], HorizontalMorph::HistFunc);
+        for (int k = 0; k <= 20; ++k) {
+            double wt2 = k / 20., wt1 = 1 - wt2;
+            std::vector<double> ref = reference::histFuncMorph(edges1, cdf1, cdf2, wt1, wt2);
+            hf.morph(wt1, wt2, &out[0], true);
+            for (int i = 0; i < n1; ++i) maxHistFunc = std::max(maxHistFunc, std::abs(out[i] - ref[i]));
+        }
+
+        // th1fmorph, with the same and with different binnings
+        for (const std::vector<double> *e2 : { &edges1, &edges2 }) {
+            const std::vector<double> &c2 = (e2 == &edges1 ? d2 : g2);
+            std::vector<double> edgesn(edges1);
+            edgesn.insert(edgesn.end(), e2->begin(), e2->end());
+            std::sort(edgesn.begin(), edgesn.end());
+            edgesn.erase(std::unique(edgesn.begin(), edgesn.end()), edgesn.end());
+            TH1D th1("th1", "", n1, &edges1[0]), th2("th2", "", e2->size() - 1, &(*e2)[0]);
+            for (int i = 0; i < n1; ++i) th1.SetBinContent(i+1, d1[i]);
+            for (unsigned int i = 0; i < c2.size(); ++i) th2.SetBinContent(i+1, c2[i]);
+            for (int k = 0; k <= 10; ++k) {
+                double wt1, wt2;
+                HorizontalMorph::weights(0., 1., k / 10., wt1, wt2);
+                std::vector<double> ref = reference::th1fMorph(edges1, d1, *e2, c2, edgesn, wt1, wt2);
+                TH1D *morphed = th1fmorph("morphed", "", &th1, &th2, 0., 1., k / 10., 1.);
+                for (unsigned int i = 0; i < ref.size(); ++i) maxTh1fMorph = std::max(maxTh1fMorph, std::abs(morphed->GetBinContent(i+1) - ref[i]));
+                delete morphed;
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    std::vector<int> nbins;
+    for (int i = 1; i < argc; ++i) nbins.push_back(atoi(argv[i]));
+    if (nbins.empty()) nbins = { 20, 50, 100, 500, 2000 };
+    const double xmin = 0, xmax = 100, mean1 = 35, sigma1 = 4, mean2 = 60, sigma2 = 7;
+    const int steps = 1000;
+    bool ok = true;
+
+    printf("%6s %12s %12s %10s %10s\n", "bins", "max rel dev", "conventions", "init [us]", "morph [ns]");
+    for (int n : nbins) {
+        std::vector<double> edges(n + 1);
+        for (int i = 0; i <= n; ++i) edges[i] = xmin + i * (xmax - xmin) / n;
+        std::vector<double> h1 = gaussian(edges, mean1, sigma1), h2 = gaussian(edges, mean2, sigma2);
+        std::vector<double> cdf1(n + 1), cdf2(n + 1), out(n), out2(n);
+        HorizontalMorph::cumulative(n, &h1[0], &cdf1[0]);
+        HorizontalMorph::cumulative(n, &h2[0], &cdf2[0]);
+
+        auto t0 = std::chrono::steady_clock::now();
+        HorizontalMorph hf, tf;
+        hf.init(n, &edges[0], &cdf1[0], n, &edges[0], &cdf2[0], n, &edges[0], HorizontalMorph::HistFunc);
+        tf.init(n, &edges[0], &cdf1[0], n, &edges[0], &cdf2[0], n, &edges[0], HorizontalMorph::Th1fMorph);
+        auto t1 = std::chrono::steady_clock::now();
+
+        double maxdev = 0, maxconv = 0;
+        for (int k = 0; k <= 10; ++k) {
+            double wt2 = k / 10., wt1 = 1 - wt2;
+            hf.morph(wt1, wt2, &out[0]);
+            tf.morph(wt1, wt2, &out2[0]);
+            std::vector<double> exact = gaussian(edges, wt1 * mean1 + wt2 * mean2, wt1 * sigma1 + wt2 * sigma2);
+            double peak = *std::max_element(exact.begin(), exact.end());
+            for (int i = 0; i < n; ++i) {
+                maxdev = std::max(maxdev, std::abs(out[i] - exact[i]) / peak);
+                maxconv = std::max(maxconv, std::abs(out[i] - out2[i]));
+            }
+        }
+
+        auto t2 = std::chrono::steady_clock::now();
+        for (int k = 0; k < steps; ++k) hf.morph(1 - (k + 0.5) / steps, (k + 0.5) / steps, &out[0], true);
+        auto t3 = std::chrono::steady_clock::now();
+        double tinit = std::chrono::duration<double, std::micro>(t1 - t0).count() / 2;
+        double tmorph = std::chrono::duration<double, std::nano>(t3 - t2).count() / steps;
+        printf("%6d %12.3g %12.3g %10.2f %10.1f\n", n, maxdev, maxconv, tinit, tmorph);
+        if (maxdev > 4.0 / n) {
+            printf("ERROR: the morphed gaussian deviates by more than 4/bins from the exact one\n");
+            ok = false;
+        }
+    }
+
+    double maxHistFunc, maxTh1fMorph;
+    compareReference(3000, maxHistFunc, maxTh1fMorph);
+    printf("largest difference from the previous implementation: CMSHistFunc %g, th1fmorph %g\n", maxHistFunc, maxTh1fMorph);
+    if (maxHistFunc > 1e-12 || maxTh1fMorph > 1e-12) {
+        printf("ERROR: HorizontalMorph and the previous implementation disagree\n");
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+// Quantiles of QuantileSketch, compared with the exact ones of QuantileCalculator.
+// Usage: testQuantileSketch.exe
+// The sketch is filled with weighted entries in one go and, separately, in two halves that are
+// merged after one of them goes through serialize() and back; both must match the exact quantiles
+// and give the same errors by sectioning and jackknife. Malformed serialized data must be rejected.
+#include "HiggsAnalysis/CombinedLimit/interface/JacknifeQuantile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+bool rejects(const std::vector<double> &serialized, const char *what) {
+    try {
+        QuantileSketch bad(serialized);
+    } catch (const std::invalid_argument &) {
+        return true;
+    }
+    printf("ERROR: serialized data with %s was accepted\n", what);
+    return false;
+}
+
+int main() {
+    const int n = 200000, sections = 5;
+    std::mt19937 rng(1234);
+    std::exponential_distribution<double> expo(1.0);
+    std::uniform_real_distribution<double> flat(0.5, 1.5);
+    std::vector<double> values(n), weights(n);
+    for (int i = 0; i < n; ++i) { values[i] = expo(rng); weights[i] = flat(rng); }
+
+    QuantileSketch all(500, sections), first(500, sections), second(500, sections);
+    for (int i = 0; i < n; ++i) {
+        all.add(values[i], weights[i]);
+        (i < n/2 ? first : second).add(values[i], weights[i]);
+    }
+    // both halves start from the first section, so the entries are not dealt as in 'all'
+    QuantileSketch merged(second.serialize());
+    merged.merge(first);
+
+    bool ok = true;
+    if (std::abs(merged.sumOfWeights() - all.sumOfWeights()) > 1e-9 * all.sumOfWeights()) {
+        printf("ERROR: the merged sketch has a sum of weights %g instead of %g\n", merged.sumOfWeights(), all.sumOfWeights());
+        ok = false;
+    }
+    if (all.size() > 2000 || merged.size() > 2000) {
+        printf("ERROR: the sketches keep %u and %u centroids\n", all.size(), merged.size());
+        ok = false;
+    }
+    QuantileSketch copy(all.serialize());
+    double qs[] = { 0.001, 0.025, 0.16, 0.5, 0.84, 0.975, 0.999 };
+    for (double q : qs) {
+        QuantileCalculator exact(values, weights);
+        double ref = exact.quantileAndError(q, QuantileCalculator::Simple).first;
+        double tol = 0.015 * ref + 1e-4;
+        double val = all.quantile(q), mval = merged.quantile(q);
+        printf("quantile %.3f: exact %8.5f, sketch %8.5f, merged %8.5f\n", q, ref, val, mval);
+        if (std::abs(val - ref) > tol || std::abs(mval - ref) > tol) {
+            printf("ERROR: the sketch quantile differs from the exact one by more than %g\n", tol);
+            ok = false;
+        }
+        if (copy.quantile(q) != val) {
+            printf("ERROR: the quantile changed through serialize()\n");
+            ok = false;
+        }
+    }
+    for (QuantileCalculator::Method method : { QuantileCalculator::Sectioning, QuantileCalculator::Jacknife }) {
+        QuantileCalculator exact(values, weights);
+        std::pair<double,double> ref = exact.quantileAndError(0.95, method);
+        std::pair<double,double> val = all.quantileAndError(0.95, method), mval = merged.quantileAndError(0.95, method);
+        printf("quantile 0.950 by %s: exact %8.5f +/- %7.5f, sketch %8.5f +/- %7.5f, merged %8.5f +/- %7.5f\n",
+               method == QuantileCalculator::Jacknife ? "jackknife" : "sectioning", ref.first, ref.second, val.first, val.second, mval.first, mval.second);
+        // the sections hold different entries than those of QuantileCalculator: compare within the errors
+        for (const std::pair<double,double> &v : { val, mval }) {
+            if (!(v.second > 0) || std::abs(v.first - ref.first) > 3 * std::max(v.second, ref.second) || v.second > 4 * ref.second || ref.second > 4 * v.second) {
+                printf("ERROR: the quantile and error of the sketch don't match the exact ones\n");
+                ok = false;
+            }
+        }
+    }
+
+    // version, compression, sections, next section, then sumw, min, max, number and list of centroids
+    std::vector<double> good = { 1, 100, 1, 0, 2, 1, 3, 2, 1, 1, 3, 1 };
+    QuantileSketch small(good);
+    small.add(2);
+    if (small.sumOfWeights() != 3) {
+        printf("ERROR: a valid serialized sketch was not read back\n");
+        ok = false;
+    }
+    std::vector<double> bad = good;
+    bad[2] = 0; bad[3] = 0; bad.resize(4);
+    ok = rejects(bad, "no sections") && ok;
+    bad = good; bad[3] = 1;
+    ok = rejects(bad, "the next section out of range") && ok;
+    bad = good; bad[2] = 1.5;
+    ok = rejects(bad, "a fractional number of sections") && ok;
+    bad = good; bad[1] = 0;
+    ok = rejects(bad, "a zero compression") && ok;
+    bad = good; bad[7] = 3;
+    ok = rejects(bad, "too many centroids") && ok;
+    bad = good; bad[7] = -1;
+    ok = rejects(bad, "a negative number of centroids") && ok;
+    bad = good; bad.push_back(0);
+    ok = rejects(bad, "trailing numbers") && ok;
+    return ok ? 0 : 1;
+}
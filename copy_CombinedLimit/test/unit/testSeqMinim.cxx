@@ -18,6 +18,8 @@
 #include <Math/MinimizerOptions.h>
 #include "Math/Minimizer.h"
 #include "Math/Factory.h"
+#include "Math/GenAlgoOptions.h"
+#include "Math/IFunction.h"
 
 #include "HiggsAnalysis/CombinedLimit/interface/ProfileLikelihood.h"
 #include "HiggsAnalysis/CombinedLimit/interface/RooSimultaneousOpt.h"
@@ -65,6 +67,105 @@ double testProfile(Func f, RooAbsReal *nll, RooRealVar *poi, double &xmin, doubl
 
 
 
+// A chain of parameters: each has a local term (x_i - a_i)^2 + 0.1 x_i^4, neighbours are coupled by
+// terms 0.5 (x_i - x_i+1)^2, and a last term 0.01 (sum x_i)^2 depends on all of them. The full function
+// and the SeparableFunction share the current point, as the CachingSimNLL and its terms share the RooRealVars.
+struct ChainModel {
+    std::vector<double> x, a;
+    ChainModel(unsigned int n) : x(n, 0.), a(n) { for (unsigned int i = 0; i < n; ++i) a[i] = std::sin(1.7*i) + 0.3*i; }
+    unsigned int nterms() const { return 2*x.size(); }
+    double term(unsigned int k) const {
+        unsigned int n = x.size();
+        if (k < n) return std::pow(x[k] - a[k], 2) + 0.1*std::pow(x[k], 4);
+        if (k < 2*n - 1) return 0.5*std::pow(x[k-n] - x[k-n+1], 2);
+        double sum = 0; for (double xi : x) sum += xi;
+        return 0.01*sum*sum;
+    }
+};
+
+class ChainFunction : public ROOT::Math::IMultiGenFunction {
+    public:
+        ChainFunction(ChainModel &model) : model_(model) {}
+        ROOT::Math::IMultiGenFunction * Clone() const override { return new ChainFunction(model_); }
+        unsigned int NDim() const override { return model_.x.size(); }
+    private:
+        ChainModel &model_;
+        double DoEval(const double *x) const override {
+            std::copy(x, x + model_.x.size(), model_.x.begin());
+            double ret = 0;
+            for (unsigned int k = 0; k < model_.nterms(); ++k) ret += model_.term(k);
+            return ret;
+        }
+};
+
+class ChainTerms : public cmsmath::SeparableFunction {
+    public:
+        ChainTerms(ChainModel &model) : model_(model) {}
+        bool terms(const std::vector<std::string> &params, std::vector<std::vector<unsigned int> > &terms) override {
+            unsigned int n = model_.x.size();
+            index_.clear(); terms.clear();
+            for (const std::string &name : params) {
+                unsigned int i = atoi(name.c_str() + 1);
+                index_.push_back(i);
+                terms.push_back({ i });
+                if (i > 0) terms.back().push_back(n + i - 1);
+                if (i + 1 < n) terms.back().push_back(n + i);
+                terms.back().push_back(2*n - 1);
+            }
+            return true;
+        }
+        void set(unsigned int ipar, double x) override { model_.x[index_[ipar]] = x; }
+        double evalTerms(const std::vector<unsigned int> &terms) override {
+            double ret = 0;
+            for (unsigned int k : terms) ret += model_.term(k);
+            return ret;
+        }
+    private:
+        ChainModel &model_;
+        std::vector<unsigned int> index_;
+};
+
+// minimize the chain with full evaluations, or evaluating only the terms of each parameter (passed with the options)
+double minimizeChain(unsigned int n, bool partial, std::vector<double> &xmin, unsigned int &ncalls) {
+    ChainModel model(n);
+    ChainFunction func(model);
+    ChainTerms terms(model);
+    cmsmath::SequentialMinimizer minim;
+    ROOT::Math::MinimizerOptions opts;
+    opts.SetTolerance(1e-4);
+    opts.SetMaxFunctionCalls(1000000);
+    opts.SetMaxIterations(10000);
+    if (partial) {
+        ROOT::Math::GenAlgoOptions extra;
+        extra.SetIntValue("SeparableFunction", terms.id());
+        opts.SetExtraOptions(extra);
+    }
+    minim.SetOptions(opts);
+    minim.SetFunction(func);
+    for (unsigned int i = 0; i < n; ++i) minim.SetLimitedVariable(i, Form("x%u", i), 0., 0.1, -10., 10.);
+    minim.Minimize();
+    xmin.assign(minim.X(), minim.X() + n);
+    ncalls = minim.NCalls();
+    return func(&xmin[0]);
+}
+
+bool testPartialEvaluation() {
+    const unsigned int n = 40;
+    std::vector<double> xFull, xPartial;
+    unsigned int callsFull, callsPartial;
+    double yFull = minimizeChain(n, false, xFull, callsFull);
+    double yPartial = minimizeChain(n, true, xPartial, callsPartial);
+    double maxdx = 0;
+    for (unsigned int i = 0; i < n; ++i) maxdx = std::max(maxdx, std::abs(xFull[i] - xPartial[i]));
+    printf("Full evaluation:    minimum %.8f after %u calls\n", yFull, callsFull);
+    printf("Partial evaluation: minimum %.8f after %u calls, largest difference in x %g\n", yPartial, callsPartial, maxdx);
+    if (std::abs(yFull - yPartial) > 1e-3 || maxdx > 1e-2) {
+        printf("ERROR: the partial and full evaluations reach different minima\n");
+        return false;
+    }
+    return true;
+}
+
 void runExternal(const char *file, double mh, const char *algo, double tol, const char *wsp, const char *datan, const char *mcn) {
     ProfileLikelihood::MinimizerSentry cfg(algo,tol);
     TFile *f = TFile::Open(file); if (f == 0) return;
@@ -106,6 +207,7 @@ int main(int argc, char **argv) {
     ROOT::Math::Minimizer* min = ROOT::Math::Factory::CreateMinimizer("SeqMinimizer", "");
     assert(min != 0);
     RooRandom::randomGenerator()->SetSeed(42);
+    if (!testPartialEvaluation()) return 1;
     if (argc >= 2) {
         if (strstr(argv[1],"root")) {
             runExternal(argv[1], 
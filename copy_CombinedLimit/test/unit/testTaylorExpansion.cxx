@@ -0,0 +1,97 @@
+// Value and gradient of RooTaylorExpansion, on a deep copy of the expansion.
+// Usage: testTaylorExpansion.exe
+// The value is compared with the plain loop over the terms that RooTaylorExpansion used before the
+// terms were merged in a prefix tree, after each change of the copied x (so the copy must follow its
+// own servers and not those of the original), and the gradient with central finite differences.
+#include "HiggsAnalysis/CombinedLimit/interface/RooTaylorExpansion.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include <RooArgList.h>
+#include <RooArgSet.h>
+#include <RooRealVar.h>
+
+// the evaluation of RooTaylorExpansion before the prefix tree: one product of dx per term
+double termLoop(const std::vector<double> &x, const std::vector<double> &x0, const std::vector<std::vector<int>> &trackers, const std::vector<double> &terms) {
+    double ret = 0;
+    for (unsigned int i = 0; i < terms.size(); ++i) {
+        double term = terms[i];
+        for (int j : trackers[i]) term *= x[j] - x0[j];
+        ret += term;
+    }
+    return ret;
+}
+
+int main() {
+    const int nx = 4;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> flat(-1, 1);
+
+    RooArgList xs, x0s;
+    std::vector<double> x0vals(nx);
+    for (int i = 0; i < nx; ++i) {
+        x0vals[i] = 0.5 * flat(rng);
+        RooRealVar *x = new RooRealVar(Form("x%d", i), "", 0, -10, 10);
+        RooRealVar *x0 = new RooRealVar(Form("x0_%d", i), "", x0vals[i]);
+        x0->setConstant(true);
+        xs.addOwned(*x);
+        x0s.addOwned(*x0);
+    }
+    // all the terms up to third order, with the indices in any order and some repeated index lists
+    std::vector<std::vector<int>> trackers(1);
+    std::vector<double> terms(1, flat(rng));
+    for (int i = 0; i < nx; ++i) {
+        trackers.push_back({i});
+        for (int j = 0; j < nx; ++j) {
+            trackers.push_back({i, j});
+            for (int k = 0; k < nx; ++k) trackers.push_back({k, i, j});
+        }
+    }
+    trackers.push_back({1, 0});
+    trackers.push_back({2, 3, 2});
+    while (terms.size() < trackers.size()) terms.push_back(flat(rng));
+
+    RooTaylorExpansion taylor("taylor", "", xs, x0s, trackers, terms);
+    std::unique_ptr<RooArgSet> copy((RooArgSet *) RooArgSet(taylor).snapshot(true));
+    RooTaylorExpansion *clone = dynamic_cast<RooTaylorExpansion *>(copy->find("taylor"));
+    if (clone == 0 || clone == &taylor) {
+        printf("ERROR: no deep copy of the expansion\n");
+        return 1;
+    }
+    std::vector<RooRealVar *> cloneXs(nx);
+    for (int i = 0; i < nx; ++i) cloneXs[i] = dynamic_cast<RooRealVar *>(copy->find(Form("x%d", i)));
+
+    bool ok = true;
+    double maxdiff = 0, maxgraddiff = 0;
+    std::vector<double> xvals(nx), grad;
+    for (int itry = 0; itry < 1000; ++itry) {
+        // the original is evaluated too, so that its own cache is good while the copy changes
+        taylor.getVal();
+        for (int i = 0; i < nx; ++i) cloneXs[i]->setVal(xvals[i] = flat(rng));
+        double val = clone->getVal(), ref = termLoop(xvals, x0vals, trackers, terms);
+        maxdiff = std::max(maxdiff, std::abs(val - ref) / std::max(1.0, std::abs(ref)));
+
+        clone->gradient(grad);
+        for (int i = 0; i < nx; ++i) {
+            double h = 1e-5;
+            std::vector<double> up(xvals), dn(xvals);
+            up[i] += h;
+            dn[i] -= h;
+            double fd = (termLoop(up, x0vals, trackers, terms) - termLoop(dn, x0vals, trackers, terms)) / (2 * h);
+            maxgraddiff = std::max(maxgraddiff, std::abs(grad[i] - fd) / std::max(1.0, std::abs(fd)));
+        }
+    }
+    printf("largest relative difference: value %g, gradient %g\n", maxdiff, maxgraddiff);
+    if (maxdiff > 1e-12) {
+        printf("ERROR: the value of the copy differs from the loop over the terms\n");
+        ok = false;
+    }
+    if (maxgraddiff > 1e-6) {
+        printf("ERROR: the gradient differs from the finite differences\n");
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}